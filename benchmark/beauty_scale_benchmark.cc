@@ -0,0 +1,167 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+// Frame time of the three-pass BeautyFaceFilter with its blur and high-pass
+// branches at full, half and quarter resolution, of the fused single pass and
+// of GuidedBeautyFilter, with the structural similarity (SSIM) of each output
+// to the full-resolution three-pass one. Fails when the fused output drifts
+// from the three-pass one.
+//
+//   beauty_scale_benchmark [frames] [image]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include "gpupixel/gpupixel.h"
+
+using namespace gpupixel;
+
+namespace {
+
+// The fused pass approximates the blur box with 16 taps, so it only has to
+// stay close to the three-pass output
+const double kFusedMinSsim = 0.998;
+
+double RenderFrames(std::shared_ptr<SourceRawData> source,
+                    const uint8_t* pixels,
+                    int width,
+                    int height,
+                    int frames) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < frames; i++) {
+    source->ProcessData(pixels, width, height, width * 4,
+                        GPUPIXEL_FRAME_TYPE_RGBA, i);
+  }
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+         frames;
+}
+
+std::vector<float> GetLuma(const uint8_t* rgba, int width, int height) {
+  std::vector<float> luma(width * height);
+  for (int i = 0; i < width * height; i++) {
+    luma[i] = 0.299f * rgba[i * 4] + 0.587f * rgba[i * 4 + 1] +
+              0.114f * rgba[i * 4 + 2];
+  }
+  return luma;
+}
+
+// Mean SSIM of the luma over 8x8 windows with a stride of 4
+double GetSsim(const std::vector<float>& a,
+               const std::vector<float>& b,
+               int width,
+               int height) {
+  const double c1 = (0.01 * 255) * (0.01 * 255);
+  const double c2 = (0.03 * 255) * (0.03 * 255);
+  const int window = 8;
+  double total = 0;
+  int count = 0;
+  for (int y = 0; y + window <= height; y += 4) {
+    for (int x = 0; x + window <= width; x += 4) {
+      double mean_a = 0, mean_b = 0;
+      for (int j = 0; j < window; j++) {
+        for (int i = 0; i < window; i++) {
+          mean_a += a[(y + j) * width + x + i];
+          mean_b += b[(y + j) * width + x + i];
+        }
+      }
+      mean_a /= window * window;
+      mean_b /= window * window;
+      double var_a = 0, var_b = 0, covariance = 0;
+      for (int j = 0; j < window; j++) {
+        for (int i = 0; i < window; i++) {
+          double da = a[(y + j) * width + x + i] - mean_a;
+          double db = b[(y + j) * width + x + i] - mean_b;
+          var_a += da * da;
+          var_b += db * db;
+          covariance += da * db;
+        }
+      }
+      int n = window * window - 1;
+      var_a /= n;
+      var_b /= n;
+      covariance /= n;
+      total +=
+          ((2 * mean_a * mean_b + c1) * (2 * covariance + c2)) /
+          ((mean_a * mean_a + mean_b * mean_b + c1) * (var_a + var_b + c2));
+      count++;
+    }
+  }
+  return count ? total / count : 1.0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int frames = argc > 1 ? atoi(argv[1]) : 100;
+  std::string image_path = argc > 2 ? argv[2] : GPUPIXEL_BENCHMARK_IMAGE;
+
+  GPUPixel::SetResourcePath(GPUPIXEL_BENCHMARK_RESOURCE_DIR);
+  auto image = SourceImage::Create(image_path);
+  int width = image->GetWidth();
+  int height = image->GetHeight();
+  const uint8_t* image_pixels = image->GetRgbaImageBuffer();
+  std::vector<uint8_t> pixels(image_pixels,
+                              image_pixels + width * height * 4);
+
+  auto source = SourceRawData::Create();
+  auto beauty = BeautyFaceFilter::Create();
+  auto sink = SinkRawData::Create();
+  if (!beauty) {
+    fprintf(stderr, "filter creation failed, check the resource path\n");
+    return 1;
+  }
+  beauty->SetProperty("skin_smoothing", 0.8f);
+  beauty->SetProperty("whiteness", 0.3f);
+  source->AddSink(beauty)->AddSink(sink);
+
+  printf("%dx%d\n", width, height);
+  printf("%-8s %12s %12s\n", "scale", "frame ms", "ssim");
+  // branch_scale only applies to the three-pass path
+  beauty->SetProperty("fused", 0);
+  std::vector<float> reference;
+  for (float scale : {1.0f, 0.5f, 0.25f}) {
+    beauty->SetProperty("branch_scale", scale);
+    // Settles framebuffer sizes outside the measurement
+    RenderFrames(source, pixels.data(), width, height, 2);
+    double ms = RenderFrames(source, pixels.data(), width, height, frames);
+    std::vector<float> luma = GetLuma(sink->GetRgbaBuffer(), width, height);
+    if (reference.empty()) {
+      reference = luma;
+    }
+    printf("%-8.2f %12.2f %12.4f\n", scale, ms,
+           GetSsim(reference, luma, width, height));
+  }
+
+  beauty->SetProperty("branch_scale", 1.0f);
+  beauty->SetProperty("fused", 1);
+  RenderFrames(source, pixels.data(), width, height, 2);
+  double ms = RenderFrames(source, pixels.data(), width, height, frames);
+  std::vector<float> luma = GetLuma(sink->GetRgbaBuffer(), width, height);
+  double fused_ssim = GetSsim(reference, luma, width, height);
+  printf("%-8s %12.2f %12.4f\n", "fused", ms, fused_ssim);
+
+  source->RemoveAllSinks();
+  auto guided = GuidedBeautyFilter::Create();
+  if (!guided) {
+    fprintf(stderr, "guided filter creation failed\n");
+    return 1;
+  }
+  guided->SetProperty("skin_smoothing", 0.8f);
+  guided->SetProperty("whiteness", 0.3f);
+  source->AddSink(guided)->AddSink(sink);
+  RenderFrames(source, pixels.data(), width, height, 2);
+  ms = RenderFrames(source, pixels.data(), width, height, frames);
+  luma = GetLuma(sink->GetRgbaBuffer(), width, height);
+  printf("%-8s %12.2f %12.4f\n", "guided", ms,
+         GetSsim(reference, luma, width, height));
+  return fused_ssim < kFusedMinSsim ? 1 : 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+// Frame time of BilateralFilter with its separable passes and with the
+// bilateral grid, over a range of texel spacings, and the mean channel
+// difference between the two outputs.
+//
+//   bilateral_grid_benchmark [frames] [image]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include "gpupixel/gpupixel.h"
+
+using namespace gpupixel;
+
+namespace {
+
+double RenderFrames(std::shared_ptr<SourceRawData> source,
+                    const uint8_t* pixels,
+                    int width,
+                    int height,
+                    int frames) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < frames; i++) {
+    source->ProcessData(pixels, width, height, width * 4,
+                        GPUPIXEL_FRAME_TYPE_RGBA, i);
+  }
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+         frames;
+}
+
+double GetMeanDifference(const std::vector<uint8_t>& a, const uint8_t* b) {
+  double total = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    total += abs(a[i] - b[i]);
+  }
+  return a.empty() ? 0.0 : total / a.size();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int frames = argc > 1 ? atoi(argv[1]) : 100;
+  std::string image_path = argc > 2 ? argv[2] : GPUPIXEL_BENCHMARK_IMAGE;
+
+  if (!BilateralGridFilter::Create()) {
+    fprintf(stderr, "the bilateral grid needs float framebuffers\n");
+    return 1;
+  }
+
+  auto image = SourceImage::Create(image_path);
+  int width = image->GetWidth();
+  int height = image->GetHeight();
+  const uint8_t* image_pixels = image->GetRgbaImageBuffer();
+  std::vector<uint8_t> pixels(image_pixels,
+                              image_pixels + width * height * 4);
+
+  auto source = SourceRawData::Create();
+  auto bilateral = BilateralFilter::Create();
+  auto sink = SinkRawData::Create();
+  source->AddSink(bilateral)->AddSink(sink);
+
+  printf("%dx%d\n", width, height);
+  printf("%-8s %14s %14s %12s\n", "spacing", "separable ms", "grid ms",
+         "mean diff");
+  for (float spacing : {1.0f, 2.0f, 4.0f, 8.0f, 16.0f}) {
+    bilateral->SetProperty("texelSpacingMultiplier", spacing);
+    double ms[2];
+    std::vector<uint8_t> separable;
+    for (int backend = 0; backend < 2; backend++) {
+      bilateral->SetProperty("backend", backend);
+      // Settles framebuffer sizes outside the measurement
+      RenderFrames(source, pixels.data(), width, height, 2);
+      ms[backend] =
+          RenderFrames(source, pixels.data(), width, height, frames);
+      if (backend == 0) {
+        const uint8_t* output = sink->GetRgbaBuffer();
+        separable.assign(output, output + width * height * 4);
+      }
+    }
+    printf("%-8.1f %14.2f %14.2f %12.2f\n", spacing, ms[0], ms[1],
+           GetMeanDifference(separable, sink->GetRgbaBuffer()));
+  }
+  return 0;
+}
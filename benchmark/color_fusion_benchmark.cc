@@ -0,0 +1,118 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+// Frame time of a chain of color filters rendered pass by pass, fused into a
+// single pass and baked into a lookup table, and the largest channel
+// difference to the unfused output. Exits with 1 when the fused output
+// exceeds the tolerance.
+//
+//   color_fusion_benchmark [frames] [width] [height]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "gpupixel/gpupixel.h"
+
+using namespace gpupixel;
+
+namespace {
+
+// In 8-bit steps; the unfused chain rounds after every pass
+const int kTolerance = 3;
+
+double RenderFrames(std::shared_ptr<SourceRawData> source,
+                    const std::vector<uint8_t>& pixels,
+                    int width,
+                    int height,
+                    int frames) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < frames; i++) {
+    source->ProcessData(pixels.data(), width, height, width * 4,
+                        GPUPIXEL_FRAME_TYPE_RGBA, i);
+  }
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+         frames;
+}
+
+int GetMaxDifference(const uint8_t* output,
+                     const std::vector<uint8_t>& reference) {
+  int max_difference = 0;
+  for (size_t i = 0; i < reference.size(); i++) {
+    max_difference = std::max(max_difference, abs(output[i] - reference[i]));
+  }
+  return max_difference;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int frames = argc > 1 ? atoi(argv[1]) : 100;
+  int width = argc > 2 ? atoi(argv[2]) : 1280;
+  int height = argc > 3 ? atoi(argv[3]) : 720;
+
+  std::vector<uint8_t> pixels(width * height * 4);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      uint8_t* pixel = &pixels[(y * width + x) * 4];
+      pixel[0] = x * 255 / width;
+      pixel[1] = y * 255 / height;
+      pixel[2] = (x + y) * 255 / (width + height);
+      pixel[3] = 255;
+    }
+  }
+
+  auto source = SourceRawData::Create();
+  std::vector<std::shared_ptr<Filter>> chain = {
+      BrightnessFilter::Create(), ContrastFilter::Create(),
+      SaturationFilter::Create(), ExposureFilter::Create(),
+      HueFilter::Create(),        WhiteBalanceFilter::Create(),
+      RGBFilter::Create(),
+  };
+  chain[0]->SetProperty("brightness_factor", 0.05f);
+  chain[1]->SetProperty("contrast", 1.2f);
+  chain[2]->SetProperty("saturation", 1.3f);
+  chain[3]->SetProperty("exposure", 0.2f);
+  chain[4]->SetProperty("hueAdjustment", 20.0f);
+  chain[5]->SetProperty("temperature", 5600.0f);
+  chain[6]->SetProperty("greenAdjustment", 0.9f);
+
+  auto sink = SinkRawData::Create();
+  std::shared_ptr<Source> previous = source;
+  for (auto& filter : chain) {
+    previous = previous->AddSink(filter);
+  }
+  previous->AddSink(sink);
+
+  RenderGraph::Compile(source, false, false);
+  double unfused_ms = RenderFrames(source, pixels, width, height, frames);
+  std::vector<uint8_t> unfused(sink->GetRgbaBuffer(),
+                               sink->GetRgbaBuffer() + pixels.size());
+
+  RenderGraphReport report = RenderGraph::Compile(source, false, true);
+  double fused_ms = RenderFrames(source, pixels, width, height, frames);
+  int fused_difference = GetMaxDifference(sink->GetRgbaBuffer(), unfused);
+
+  // Baking needs a few frames with unchanged parameters first
+  RenderGraph::Compile(source, false, true, true);
+  RenderFrames(source, pixels, width, height, 5);
+  double baked_ms = RenderFrames(source, pixels, width, height, frames);
+  int baked_difference = GetMaxDifference(sink->GetRgbaBuffer(), unfused);
+
+  printf("%d filters, %d fused, %dx%d\n", (int)chain.size(), report.fused_count,
+         width, height);
+  printf("%-10s %12s %12s\n", "run", "frame ms", "max diff");
+  printf("%-10s %12.2f %12s\n", "unfused", unfused_ms, "-");
+  printf("%-10s %12.2f %12d\n", "fused", fused_ms, fused_difference);
+  printf("%-10s %12.2f %12d\n", "baked", baked_ms, baked_difference);
+  // The baked table is an approximation, only fusion must match
+  return fused_difference > kTolerance ? 1 : 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+// Per-task latency of the GL dispatch queue compared with the previous
+// mutex + condition variable queue, at 1, 4 and 16 producer threads.
+// Fails when two workers flooding each other's full queues stall.
+//
+//   dispatch_queue_benchmark [tasks_per_producer]
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "utils/dispatch_queue.h"
+
+namespace {
+
+// The queue DispatchQueue replaced, kept here as the baseline
+class LockedDispatchQueue {
+ public:
+  LockedDispatchQueue() : running_(true) {
+    worker_ = std::thread([this]() {
+      worker_id_ = std::this_thread::get_id();
+      while (true) {
+        std::function<void()> task;
+        {
+          std::unique_lock<std::mutex> lk(m_);
+          cv_.wait(lk, [this]() { return !queue_.empty() || !running_; });
+          if (!running_ && queue_.empty()) {
+            return;
+          }
+          task = queue_.front();
+          queue_.pop();
+        }
+        task();
+      }
+    });
+  }
+
+  ~LockedDispatchQueue() {
+    {
+      std::unique_lock<std::mutex> lk(m_);
+      running_ = false;
+    }
+    cv_.notify_one();
+    worker_.join();
+  }
+
+  void runTask(std::function<void()> task) {
+    std::promise<void> promise;
+    std::future<void> future = promise.get_future();
+    auto wrapped_task = [task, &promise]() {
+      task();
+      promise.set_value();
+    };
+    runTaskAsync(wrapped_task);
+    future.wait();
+  }
+
+  void runTaskAsync(std::function<void()> task) {
+    {
+      std::unique_lock<std::mutex> lk(m_);
+      queue_.push(task);
+    }
+    cv_.notify_one();
+  }
+
+ private:
+  std::queue<std::function<void()>> queue_;
+  std::mutex m_;
+  std::condition_variable cv_;
+  std::thread worker_;
+  std::thread::id worker_id_;
+  bool running_;
+};
+
+struct Result {
+  double sync_ns;
+  double async_ns;
+};
+
+// sync: round trip of an empty runTask, as seen by each producer
+// async: wall time per task for all producers flooding runTaskAsync
+template <typename Queue>
+Result Measure(int producers, int tasks_per_producer) {
+  using Clock = std::chrono::steady_clock;
+  Result result;
+  Queue queue;
+  std::atomic<int> counter(0);
+
+  auto run_producers = [&](const std::function<void()>& body) {
+    std::vector<std::thread> threads;
+    auto start = Clock::now();
+    for (int i = 0; i < producers; i++) {
+      threads.emplace_back(body);
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    queue.runTask([] {});
+    return std::chrono::duration<double, std::nano>(Clock::now() - start)
+        .count();
+  };
+
+  double sync_total = run_producers([&] {
+    for (int i = 0; i < tasks_per_producer; i++) {
+      queue.runTask([&counter] { counter++; });
+    }
+  });
+  // every producer waits for each of its own tasks
+  result.sync_ns = sync_total / tasks_per_producer;
+
+  double async_total = run_producers([&] {
+    for (int i = 0; i < tasks_per_producer; i++) {
+      queue.runTaskAsync([&counter] { counter++; });
+    }
+  });
+  result.async_ns = async_total / ((double)producers * tasks_per_producer);
+
+  if (counter != 2 * producers * tasks_per_producer) {
+    fprintf(stderr, "lost tasks: %d\n", counter.load());
+    exit(1);
+  }
+  return result;
+}
+
+// Each worker floods the other queue, which is kept full, from inside a task
+void CheckCrossPost(int tasks) {
+  DispatchQueue first(4);
+  DispatchQueue second(4);
+  std::atomic<int> counter(0);
+  // Both floods are queued before either fills the other queue
+  std::atomic<bool> go(false);
+  auto flood = [&counter, &go, tasks](DispatchQueue* target) {
+    while (!go) {
+      std::this_thread::yield();
+    }
+    for (int i = 0; i < tasks; i++) {
+      target->runTaskAsync([&counter] { counter++; });
+    }
+  };
+  first.runTaskAsync([&flood, &second] { flood(&second); });
+  second.runTaskAsync([&flood, &first] { flood(&first); });
+  go = true;
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (counter < 2 * tasks) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      fprintf(stderr, "workers posting to each other's full queues stalled\n");
+      // the stalled workers can not be joined
+      _Exit(1);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int tasks_per_producer = argc > 1 ? atoi(argv[1]) : 20000;
+
+  CheckCrossPost(tasks_per_producer);
+
+  printf("%-10s %-14s %14s %14s\n", "producers", "queue", "sync ns/task",
+         "async ns/task");
+  for (int producers : {1, 4, 16}) {
+    Result locked =
+        Measure<LockedDispatchQueue>(producers, tasks_per_producer);
+    Result ring = Measure<DispatchQueue>(producers, tasks_per_producer);
+    printf("%-10d %-14s %14.0f %14.0f\n", producers, "mutex+cv",
+           locked.sync_ns, locked.async_ns);
+    printf("%-10d %-14s %14.0f %14.0f\n", producers, "mpsc ring", ring.sync_ns,
+           ring.async_ns);
+  }
+  return 0;
+}
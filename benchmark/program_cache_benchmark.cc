@@ -0,0 +1,81 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+// Time to create the shader-heavy filters without the program cache, with an
+// empty cache (cold) and with a populated one (warm).
+//
+//   program_cache_benchmark [warm_rounds] [cache_dir]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "gpupixel/gpupixel.h"
+
+using namespace gpupixel;
+
+namespace {
+
+double CreateFilters() {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::shared_ptr<Filter>> filters;
+  filters.push_back(BeautyFaceFilter::Create());
+  filters.push_back(CannyEdgeDetectionFilter::Create());
+  filters.push_back(LipstickFilter::Create());
+  filters.push_back(BlusherFilter::Create());
+  filters.push_back(FaceReshapeFilter::Create());
+  filters.push_back(SmoothToonFilter::Create());
+  double ms = std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+  for (auto& filter : filters) {
+    if (!filter) {
+      fprintf(stderr, "filter creation failed, check the resource path\n");
+      exit(1);
+    }
+  }
+  return ms;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int warm_rounds = argc > 1 ? atoi(argv[1]) : 5;
+  std::filesystem::path cache_dir =
+      argc > 2 ? std::filesystem::path(argv[2])
+               : std::filesystem::temp_directory_path() /
+                     "gpupixel_program_cache_benchmark";
+
+#if !defined(_WIN32)
+  // Keep Mesa's own shader cache out of the numbers
+  setenv("MESA_SHADER_CACHE_DISABLE", "true", 0);
+#endif
+  GPUPixel::SetResourcePath(GPUPIXEL_BENCHMARK_RESOURCE_DIR);
+
+  // Creates the GL context outside the measurement
+  BrightnessFilter::Create();
+
+  printf("%-10s %12s\n", "run", "create ms");
+  printf("%-10s %12.1f\n", "no cache", CreateFilters());
+
+  std::filesystem::remove_all(cache_dir);
+  GPUPixel::SetProgramCachePath(cache_dir.string());
+  printf("%-10s %12.1f\n", "cold", CreateFilters());
+
+  double warm_total = 0;
+  for (int i = 0; i < warm_rounds; i++) {
+    warm_total += CreateFilters();
+  }
+  printf("%-10s %12.1f\n", "warm", warm_total / warm_rounds);
+
+  GPUPixel::SetProgramCachePath("");
+  std::filesystem::remove_all(cache_dir);
+  return 0;
+}
@@ -27,6 +27,20 @@ class GPUPIXEL_API BeautyFaceFilter : public FilterGroup {
   void SetBlurAlpha(float blurAlpha);
   void SetWhite(float white);
   void SetRadius(float sigma);
+  // Runs the blur and high-pass branches at 1, 1/2 or 1/4 of the input
+  // size; the unit filter upsamples them bilinearly at full resolution.
+  // Below 1 it selects the three-pass path.
+  void SetBranchScale(float scale);
+  // Computes the mean and high-pass branches with separable box passes or
+  // with summed-area tables, whose cost does not grow with the radius.
+  // Summed-area tables select the three-pass path.
+  void SetBlurBackend(BoxBlurFilter::Backend backend);
+  // Renders in a single pass, with FusedBeautyFaceUnitFilter, where the
+  // context compiles it and the branches keep their defaults. Otherwise,
+  // or when false, the blur and high-pass branches run first.
+  void SetFused(bool fused);
+
+  bool IsIdentity() const override;
 
   virtual void SetInputFramebuffer(
       std::shared_ptr<GPUPixelFramebuffer> framebuffer,
@@ -35,9 +49,14 @@ class GPUPIXEL_API BeautyFaceFilter : public FilterGroup {
 
  private:
   BeautyFaceFilter();
+  void UpdateUnitFilter();
   std::shared_ptr<BoxBlurFilter> box_blur_filter_;
   std::shared_ptr<BoxHighPassFilter> box_high_pass_filter_;
   std::shared_ptr<BeautyFaceUnitFilter> beauty_face_filter_;
+  std::shared_ptr<FusedBeautyFaceUnitFilter> fused_filter_;
+  bool fused_ = true;
+  float branch_scale_ = 1.0;
+  BoxBlurFilter::Backend blur_backend_ = BoxBlurFilter::SEPARABLE;
 };
 
 }  // namespace gpupixel
@@ -11,14 +11,14 @@
 #include "gpupixel/gpupixel_define.h"
 
 namespace gpupixel {
-class SourceImage;
-
 class GPUPIXEL_API BeautyFaceUnitFilter : public Filter {
  public:
   static std::shared_ptr<BeautyFaceUnitFilter> Create();
   ~BeautyFaceUnitFilter();
   bool Init();
   bool DoRender(bool updateSinks = true) override;
+  // Ignores that the pass would make the output opaque
+  bool IsIdentity() const override;
 
   void SetSharpen(float sharpen);
   void SetBlurAlpha(float blurAlpha);
@@ -27,15 +27,47 @@ class GPUPIXEL_API BeautyFaceUnitFilter : public Filter {
  protected:
   BeautyFaceUnitFilter();
 
-  std::shared_ptr<SourceImage> gray_image_;
-  std::shared_ptr<SourceImage> original_image_;
-  std::shared_ptr<SourceImage> skin_image_;
-  std::shared_ptr<SourceImage> custom_image_;
+  // GLSL of the whitening stages: the lookup table samplers, the `whiten`
+  // uniform and `vec3 whitenColor(vec3 color)`. Needs a default float
+  // precision in GLES.
+  static const std::string& GetWhitenShaderString();
+  // Loads the lookup tables of the whitening stages
+  bool LoadLookupImages();
+  // Binds the lookup tables to 4 texture units from first_unit on
+  void BindLookupImages(int first_unit);
+
+  // Shared by all instances, see LookupTextureCache
+  std::shared_ptr<GPUPixelFramebuffer> gray_lookup_;
+  std::shared_ptr<GPUPixelFramebuffer> original_lookup_;
+  std::shared_ptr<GPUPixelFramebuffer> skin_lookup_;
+  std::shared_ptr<GPUPixelFramebuffer> custom_lookup_;
 
- private:
   float sharpen_factor_ = 0.0;
   float blur_alpha_ = 0.0;
   float white_balance_ = 0.0;
 };
 
+// BeautyFaceUnitFilter in a single pass over the original image alone. The
+// local mean, which BeautyFaceFilter takes from its blur branch, comes from
+// 16 taps spread over the same box instead, and the high-pass difference is
+// taken against it.
+class GPUPIXEL_API FusedBeautyFaceUnitFilter : public BeautyFaceUnitFilter {
+ public:
+  static std::shared_ptr<FusedBeautyFaceUnitFilter> Create();
+  bool Init();
+  bool DoRender(bool updateSinks = true) override;
+
+  // Half width in pixels of the box the mean is taken over
+  void SetRadius(float radius);
+  // Scales the difference to the mean, like BoxDifferenceFilter::SetDelta
+  void SetHighPassDelta(float delta);
+
+ protected:
+  FusedBeautyFaceUnitFilter();
+
+  float radius_ = 16.0;
+  // Same as the BoxDifferenceFilter of the three-pass path
+  float high_pass_delta_ = 7.07;
+};
+
 }  // namespace gpupixel
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "gpupixel/filter/bilateral_grid_filter.h"
 #include "gpupixel/filter/filter_group.h"
 #include "gpupixel/gpupixel_define.h"
 
@@ -32,6 +33,11 @@ class GPUPIXEL_API BilateralMonoFilter : public Filter {
 
 class GPUPIXEL_API BilateralFilter : public FilterGroup {
  public:
+  // How the filter is computed: two separable passes of 9 taps, whose
+  // footprint is fixed and whose cost grows with the texel spacing through
+  // cache misses, or a BilateralGridFilter whose cost barely changes with it
+  enum Backend { SEPARABLE, GRID };
+
   virtual ~BilateralFilter();
 
   static std::shared_ptr<BilateralFilter> Create();
@@ -39,14 +45,25 @@ class GPUPIXEL_API BilateralFilter : public FilterGroup {
 
   void SetTexelSpacingMultiplier(float multiplier);
   void setDistanceNormalizationFactor(float value);
+  // Falls back to SEPARABLE when the grid is unsupported
+  void SetBackend(Backend backend);
 
  protected:
   BilateralFilter();
 
  private:
+  // Grid parameters matching the separable passes
+  float GetGridSpatialSigma() const;
+  float GetGridRangeSigma() const;
+
   // friend BilateralMonoFilter;
   std::shared_ptr<BilateralMonoFilter> horizontal_blur_filter_;
   std::shared_ptr<BilateralMonoFilter> vertical_blur_filter_;
+  // Created when first selected
+  std::shared_ptr<BilateralGridFilter> grid_filter_;
+  Backend backend_;
+  float texel_spacing_multiplier_;
+  float distance_normalization_factor_;
 };
 
 }  // namespace gpupixel
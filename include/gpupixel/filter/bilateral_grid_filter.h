@@ -0,0 +1,72 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+#pragma once
+
+#include <vector>
+#include "gpupixel/filter/filter.h"
+#include "gpupixel/gpupixel_define.h"
+
+namespace gpupixel {
+// Edge-preserving blur on a bilateral grid: the input is splatted into a
+// coarse 3D grid of position and luminance, stored as a row of 2D slices in
+// a float framebuffer, the grid is blurred along its three axes, and each
+// pixel reads its result back with a trilinear lookup at its own position
+// and luminance. One grid cell spans the spatial sigma, so the cost barely
+// changes with it. Needs float framebuffers, see
+// GPUPixelContext::SupportsFloatFramebuffers; Create returns null without.
+class GPUPIXEL_API BilateralGridFilter : public Filter {
+ public:
+  // Luminance bins at most, the grid depth
+  static constexpr int kMaxBins = 16;
+  // Smallest cell in pixels, which bounds the grid memory
+  static constexpr int kMinCellSize = 4;
+
+  virtual ~BilateralGridFilter();
+
+  static std::shared_ptr<BilateralGridFilter> Create(float spatial_sigma = 8.0,
+                                                     float range_sigma = 0.125);
+  bool Init(float spatial_sigma, float range_sigma);
+
+  // Standard deviation of the blur in pixels of the output
+  void SetSpatialSigma(float sigma);
+  // Luminance difference, between 0 and 1, across which colors still mix
+  void SetRangeSigma(float sigma);
+
+  virtual bool DoRender(bool updateSinks = true) override;
+
+ protected:
+  BilateralGridFilter();
+
+  int GetCellSize() const;
+  int GetBinCount() const;
+  // Adds every sample into the grid as a point, reading it once
+  void RenderScatterSplat(const std::shared_ptr<GPUPixelFramebuffer>& source,
+                          int points_width,
+                          int points_height);
+  void RenderGridPass(GPUPixelGLProgram* program,
+                      const std::shared_ptr<GPUPixelFramebuffer>& source,
+                      const std::shared_ptr<GPUPixelFramebuffer>& target);
+
+  float spatial_sigma_;
+  float range_sigma_;
+  // Splats by scattering points where the context can, by gathering per bin
+  // otherwise; only one of them is created
+  GPUPixelGLProgram* scatter_program_;
+  GPUPixelGLProgram* splat_program_;
+  GPUPixelGLProgram* blur_program_;
+  // Vertex buffer of the scattered sample indices, and its size in samples
+  uint32_t splat_points_;
+  int splat_points_width_;
+  int splat_points_height_;
+  // Ping-pong targets, the blurred grid ending up in the second one
+  std::shared_ptr<GPUPixelFramebuffer> grids_[2];
+  // Input version and grid shape the grid was last built from
+  std::vector<uint64_t> grid_signature_;
+};
+
+}  // namespace gpupixel
@@ -11,9 +11,15 @@
 
 #include "gpupixel/filter/box_mono_blur_filter.h"
 #include "gpupixel/filter/filter_group.h"
+#include "gpupixel/filter/summed_area_table_blur_filter.h"
 namespace gpupixel {
 class GPUPIXEL_API BoxBlurFilter : public FilterGroup {
  public:
+  // How the blur is computed: two separable passes whose cost grows with the
+  // radius, or a SummedAreaTableBlurFilter whose cost does not, for large
+  // boxes on devices with float framebuffers
+  enum Backend { SEPARABLE, SUMMED_AREA_TABLE };
+
   virtual ~BoxBlurFilter();
 
   static std::shared_ptr<BoxBlurFilter> Create(int radius = 4,
@@ -22,13 +28,27 @@ class GPUPIXEL_API BoxBlurFilter : public FilterGroup {
   void SetRadius(int radius);
   void setSigma(float sigma);
   void SetTexelSpacingMultiplier(float value);
+  // Blurs at a fraction of the input size, over the same extent of the image.
+  // The output has the reduced size.
+  void SetProcessingScale(float scale);
+  // Falls back to SEPARABLE when the summed-area table is unsupported
+  void SetBackend(Backend backend);
 
  protected:
   BoxBlurFilter();
 
  private:
+  // Half width of the box in output pixels, for the summed-area table
+  float GetTableRadius() const;
+
+  int radius_;
+  float texel_spacing_;
+  float processing_scale_;
   std::shared_ptr<BoxMonoBlurFilter> horizontal_blur_filter_;
   std::shared_ptr<BoxMonoBlurFilter> vertical_blur_filter_;
+  // Created when first selected
+  std::shared_ptr<SummedAreaTableBlurFilter> table_blur_filter_;
+  Backend backend_;
 };
 
 }  // namespace gpupixel
@@ -21,6 +21,9 @@ class GPUPIXEL_API BoxHighPassFilter : public FilterGroup {
 
   void SetRadius(float radius);
   void SetDelta(float delta);
+  // Runs the blur and the difference at a fraction of the input size
+  void SetProcessingScale(float scale);
+  void SetBlurBackend(BoxBlurFilter::Backend backend);
 
   virtual void SetInputFramebuffer(
       std::shared_ptr<GPUPixelFramebuffer> framebuffer,
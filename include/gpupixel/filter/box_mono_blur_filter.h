@@ -28,6 +28,12 @@ class GPUPIXEL_API BoxMonoBlurFilter : public GaussianBlurMonoFilter {
                                                   float sigma) override;
   std::string GenerateOptimizedFragmentShaderString(int radius,
                                                     float sigma) override;
+  // Equal weights over the box, sigma does not apply
+  void GetSampleWeights(int radius,
+                        float sigma,
+                        float& center_weight,
+                        std::vector<float>& offsets,
+                        std::vector<float>& weights) override;
 };
 
 }  // namespace gpupixel
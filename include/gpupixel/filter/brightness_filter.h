@@ -16,6 +16,9 @@ class GPUPIXEL_API BrightnessFilter : public Filter {
   static std::shared_ptr<BrightnessFilter> Create(float brightness = 0.0);
   bool Init(float brightness);
   virtual bool DoRender(bool updateSinks = true) override;
+  virtual bool GetColorStage(ColorStage& stage) const override;
+  virtual void SetColorStageUniforms(GPUPixelGLProgram* program,
+                                     const std::string& prefix) override;
 
   void setBrightness(float brightness);
 
@@ -17,6 +17,9 @@ class GPUPIXEL_API ColorMatrixFilter : public Filter {
   bool Init();
 
   virtual bool DoRender(bool updateSinks = true) override;
+  virtual bool GetColorStage(ColorStage& stage) const override;
+  virtual void SetColorStageUniforms(GPUPixelGLProgram* program,
+                                     const std::string& prefix) override;
 
   void setIntensity(float intensity) { intensity_factor_ = intensity; }
   void setColorMatrix(Matrix4 color_matrix) { color_matrix_ = color_matrix; }
@@ -0,0 +1,54 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+#pragma once
+
+#include <vector>
+#include "gpupixel/filter/filter.h"
+#include "gpupixel/gpupixel_define.h"
+
+namespace gpupixel {
+// Approximates a Gaussian blur by repeatedly halving the image with a 5-tap
+// kernel and doubling it back with an 8-tap one (the dual filter variant of
+// the Kawase blur). Each level doubles the radius, so the cost grows with the
+// logarithm of sigma, and the passes below full size are cheap.
+class GPUPIXEL_API DualKawaseBlurFilter : public Filter {
+ public:
+  static const int kMaxLevels = 8;
+
+  virtual ~DualKawaseBlurFilter();
+
+  static std::shared_ptr<DualKawaseBlurFilter> Create(float sigma = 2.0);
+  bool Init(float sigma);
+
+  // Standard deviation, in pixels of the input, of the Gaussian blur to
+  // approximate. At most 0 leaves the input unchanged.
+  void SetSigma(float sigma);
+
+  virtual bool IsIdentity() const override { return sigma_ <= 0.0; }
+  virtual bool DoRender(bool updateSinks = true) override;
+
+ protected:
+  DualKawaseBlurFilter();
+
+  void RenderLevel(GPUPixelGLProgram* program,
+                   const std::shared_ptr<GPUPixelFramebuffer>& source,
+                   RotationMode rotation,
+                   const std::shared_ptr<GPUPixelFramebuffer>& target,
+                   float offset);
+
+  float sigma_;
+  GPUPixelGLProgram* down_program_;
+  GPUPixelGLProgram* up_program_;
+  // Levels from half the output size down, the first one holding the result
+  // of the upsampling passes once the pyramid is built
+  std::vector<std::shared_ptr<GPUPixelFramebuffer>> levels_;
+  // Input version and pyramid shape the pyramid was last built from
+  std::vector<uint64_t> pyramid_signature_;
+};
+
+}  // namespace gpupixel
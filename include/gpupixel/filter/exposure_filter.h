@@ -15,6 +15,9 @@ class GPUPIXEL_API ExposureFilter : public Filter {
   static std::shared_ptr<ExposureFilter> Create();
   bool Init();
   virtual bool DoRender(bool updateSinks = true) override;
+  virtual bool GetColorStage(ColorStage& stage) const override;
+  virtual void SetColorStageUniforms(GPUPixelGLProgram* program,
+                                     const std::string& prefix) override;
 
   void SetExposure(float exposure);
 
@@ -18,6 +18,7 @@ class GPUPIXEL_API FaceReshapeFilter : public Filter {
 
   bool Init();
   bool DoRender(bool updateSinks = true) override;
+  bool IsIdentity() const override;
 
   void SetFaceSlimLevel(float level);
   void SetEyeZoomLevel(float level);
@@ -73,8 +73,52 @@ class GPUPIXEL_API Filter : public Source, public Sink {
 
   virtual bool DoRender(bool update_sinks = true) override;
 
+  virtual void SetInputTimestamp(int64_t timestamp) override;
+  virtual void DoUpdateSinks() override;
+
   GPUPixelGLProgram* GetGlProgram() const { return filter_program_; };
 
+  // A per-pixel color filter can be fused with the ones after it into a
+  // single pass. Its stage is GLSL that maps the vec4 `color` in place, with
+  // `$` standing for a per-stage prefix in the uniform names.
+  struct ColorStage {
+    std::string uniforms;
+    std::string code;
+    // False when the stage reads or writes alpha, which a lookup table
+    // cannot represent
+    bool bakeable = true;
+  };
+  virtual bool GetColorStage(ColorStage& /*stage*/) const { return false; }
+  // Sets the stage uniforms, named with `prefix` in place of `$`
+  virtual void SetColorStageUniforms(GPUPixelGLProgram* /*program*/,
+                                     const std::string& /*prefix*/) {}
+
+  // Renders this filter and the given chain of sinks with one program and
+  // publishes the result as the output of the last one. Each filter must be
+  // the only sink of the previous one. With bake_lut, once the parameters
+  // have stayed the same for a few frames, the chain is rendered into a
+  // 512x512 lookup table in the LookupFilter layout and frames take a single
+  // lookup until a parameter changes. An empty chain without bake_lut stops
+  // fusing.
+  bool SetFusedStages(const std::vector<std::shared_ptr<Filter>>& stages,
+                      bool bake_lut = false);
+  bool IsFused() const { return !fused_stages_.empty(); }
+  bool IsColorLutBaked() const { return bake_program_ != 0; }
+
+  using Source::GetContext;
+
+  // True when the current parameters leave the input unchanged. The input
+  // frame is then handed to the sinks as it is, with no draw and no target.
+  virtual bool IsIdentity() const { return false; }
+
+  // With dirty tracking (the default), a pass whose input frames, rotation,
+  // properties and uniforms are all unchanged since it last drew is skipped,
+  // and its last output is handed to the sinks again. Filters that draw
+  // state of their own outside these should call MarkDirty when it changes.
+  void SetDirtyTracking(bool enabled);
+  bool IsDirtyTracking() const { return dirty_tracking_; }
+  void MarkDirty() { property_version_++; }
+
   // property setters & getters
   bool RegisterProperty(const std::string& name,
                         int default_value,
@@ -121,6 +165,7 @@ class GPUPIXEL_API Filter : public Source, public Sink {
   bool GetPropertyType(const std::string& name, std::string& ret_type);
 
  protected:
+  using Source::context_;
   GPUPixelGLProgram* filter_program_;
   uint32_t filter_position_attribute_;
   std::string filter_class_name_;
@@ -137,6 +182,35 @@ class GPUPIXEL_API Filter : public Source, public Sink {
 
   const float* GetTextureCoordinate(const RotationMode& rotation_mode) const;
 
+  // Publishes the first input as the output when it can stand in for this
+  // filter's own, which needs a single unrotated input at the same size
+  bool Bypass();
+
+  // Limits the next pass of DoRender to the pixels inside x1, y1, x2, y2, in
+  // normalized device coordinates. The rest of the output keeps the cleared
+  // background, so this suits filters that shade nothing else.
+  void SetRenderBounds(float x1, float y1, float x2, float y2);
+
+  // For passes that change only the pixels inside x1, y1, x2, y2 of their
+  // first input. When no other sink holds that input, it becomes the output
+  // and is activated, and only the region is copied aside to sample the
+  // unchanged input from; the texture of that copy is returned. Returns 0
+  // when the pass must draw into its own framebuffer instead.
+  uint32_t ActivateInPlace(float x1, float y1, float x2, float y2);
+  // The same for the bounding box of x, y pairs
+  uint32_t ActivateInPlace(const std::vector<float>& points);
+
+  // What a pass depends on, compared to decide whether it can be skipped
+  std::vector<uint64_t> GetRenderSignature() const;
+
+  // Last filter of the fused chain, this one when only baking, or null when
+  // not fused or when the chain has been relinked since
+  Filter* GetFusedTail();
+  void SetFusedStageUniforms(GPUPixelGLProgram* program);
+  // Whether the baked lookup table is up to date, baking it once the
+  // parameters have settled
+  bool UpdateColorLut();
+
   // properties
   struct Property {
     std::string type;
@@ -170,6 +244,30 @@ class GPUPIXEL_API Filter : public Source, public Sink {
   std::map<std::string, StringProperty> string_properties_;
 
  private:
+  friend class FilterGroup;
+
+  // The output is the input of the last frame, not a target of its own
+  bool bypassed_;
+  bool dirty_tracking_;
+  uint64_t property_version_;
+  // Signature of the last draw, empty when the output cannot be reused
+  std::vector<uint64_t> rendered_signature_;
+
+  bool has_render_bounds_;
+  float render_bounds_[4];
+  std::shared_ptr<GPUPixelFramebuffer> in_place_copy_;
+
+  std::vector<std::weak_ptr<Filter>> fused_stages_;
+  // Uniform prefix of every stage, this filter's first
+  std::vector<std::string> fused_prefixes_;
+  GPUPixelGLProgram* fused_program_;
+  // Renders the chain over an identity lookup table, and applies the result
+  GPUPixelGLProgram* bake_program_;
+  GPUPixelGLProgram* lut_program_;
+  std::shared_ptr<GPUPixelFramebuffer> color_lut_;
+  uint64_t color_lut_version_;
+  int stable_frames_;
+
   static std::map<std::string, std::function<std::shared_ptr<Filter>()>>
       filter_factories_;
 };
@@ -28,6 +28,9 @@ class GPUPIXEL_API FilterGroup : public Filter {
   void AddFilter(std::shared_ptr<Filter> filter);
   void RemoveFilter(std::shared_ptr<Filter> filter);
   void RemoveAllFilters();
+  const std::vector<std::shared_ptr<Filter>>& GetFilters() const {
+    return filters_;
+  }
 
   // Manually specify the terminal filter, which is the final output filter of
   // sequence Most often, it's not necessary to specify the terminal filter
@@ -55,6 +58,7 @@ class GPUPIXEL_API FilterGroup : public Filter {
       std::shared_ptr<GPUPixelFramebuffer> framebuffer,
       RotationMode rotation_mode = NoRotation,
       int texIdx = 0) override;
+  virtual void SetInputTimestamp(int64_t timestamp) override;
 
   virtual bool IsReady() const override;
   virtual void ResetAndClean() override;
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "gpupixel/filter/dual_kawase_blur_filter.h"
 #include "gpupixel/filter/filter_group.h"
 #include "gpupixel/filter/gaussian_blur_mono_filter.h"
 #include "gpupixel/gpupixel_define.h"
@@ -14,6 +15,11 @@
 namespace gpupixel {
 class GPUPIXEL_API GaussianBlurFilter : public FilterGroup {
  public:
+  // How the blur is computed: two separable passes of the exact kernel, or
+  // a DualKawaseBlurFilter pyramid whose cost grows with the logarithm of
+  // the radius, for large blurs
+  enum Backend { SEPARABLE, PYRAMID };
+
   virtual ~GaussianBlurFilter();
 
   static std::shared_ptr<GaussianBlurFilter> Create(int radius = 4,
@@ -21,6 +27,7 @@ class GPUPIXEL_API GaussianBlurFilter : public FilterGroup {
   bool Init(int radius, float sigma);
   void SetRadius(int radius);
   void setSigma(float sigma);
+  void SetBackend(Backend backend);
 
  protected:
   GaussianBlurFilter();
@@ -28,6 +35,11 @@ class GPUPIXEL_API GaussianBlurFilter : public FilterGroup {
  private:
   std::shared_ptr<GaussianBlurMonoFilter> horizontal_blur_filter_;
   std::shared_ptr<GaussianBlurMonoFilter> vertical_blur_filter_;
+  // Created when first selected
+  std::shared_ptr<DualKawaseBlurFilter> pyramid_blur_filter_;
+  Backend backend_;
+  float sigma_;
+  float pyramid_sigma_;
 };
 
 }  // namespace gpupixel
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <vector>
 #include "gpupixel/filter/filter_group.h"
 #include "gpupixel/gpupixel_define.h"
 
@@ -20,6 +21,12 @@ class GPUPIXEL_API GaussianBlurMonoFilter : public Filter {
                                                         float sigma = 2.0);
   bool Init(int radius, float sigma);
 
+  // Up to this radius, a new radius or sigma takes effect right away through
+  // a shader that reads its sample offsets and weights from uniforms. A
+  // shader specialized for the radius is compiled once it has been rendered
+  // unchanged for a while, and the context keeps the recently used ones.
+  static const int kMaxParametricRadius = 32;
+
   void SetRadius(int radius);
   void setSigma(float sigma);
 
@@ -40,9 +47,32 @@ class GPUPIXEL_API GaussianBlurMonoFilter : public Filter {
   virtual std::string GenerateOptimizedFragmentShaderString(int radius,
                                                             float sigma);
 
+  // Weight of the center sample, and offsets and weights of the linearly
+  // interpolated samples taken in pairs on either side of it
+  virtual void GetSampleWeights(int radius,
+                                float sigma,
+                                float& center_weight,
+                                std::vector<float>& offsets,
+                                std::vector<float>& weights);
+  virtual std::string GenerateParametricFragmentShaderString();
+
+  // Switches to the program for the current radius and sigma
+  void UpdateProgram();
+
  private:
   virtual std::string GenerateVertexShaderString(int radius, float sigma);
   virtual std::string GenerateFragmentShaderString(int radius, float sigma);
+
+  void SwitchProgram(const std::string& vertex_shader,
+                     const std::string& fragment_shader);
+
+  // Whether the parametric shader is in use, and for how many frames the
+  // radius and sigma have stayed the same
+  bool parametric_;
+  int settled_frames_;
+  float center_weight_;
+  std::vector<float> sample_offsets_;
+  std::vector<float> sample_weights_;
 };
 
 }  // namespace gpupixel
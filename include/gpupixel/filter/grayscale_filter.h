@@ -17,6 +17,7 @@ class GPUPIXEL_API GrayscaleFilter : public Filter {
   bool Init();
 
   virtual bool DoRender(bool updateSinks = true) override;
+  virtual bool GetColorStage(ColorStage& stage) const override;
 
  protected:
   GrayscaleFilter() {};
@@ -0,0 +1,110 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+#pragma once
+
+#include "gpupixel/filter/beauty_face_unit_filter.h"
+#include "gpupixel/filter/box_blur_filter.h"
+#include "gpupixel/filter/filter_group.h"
+#include "gpupixel/gpupixel_define.h"
+
+namespace gpupixel {
+// Halves the size of its input, averaging 2x2 pixels. Outputs the mean color
+// in rgb and the luminance variance within the 2x2 pixels in alpha, scaled
+// by kVarianceScale. With carry_variance, the input is the output of
+// another downsampling pass and its variances are added to the new ones.
+class GPUPIXEL_API GuidedFilterDownsampleFilter : public Filter {
+ public:
+  static std::shared_ptr<GuidedFilterDownsampleFilter> Create(
+      bool carry_variance);
+  bool Init(bool carry_variance);
+
+  virtual bool DoRender(bool updateSinks = true) override;
+
+  // Scale of the variances in alpha, which keeps small ones distinct in
+  // 8-bit framebuffers
+  static constexpr float kVarianceScale = 16.0;
+
+ protected:
+  GuidedFilterDownsampleFilter();
+
+  bool carry_variance_;
+};
+
+// Per-pixel coefficients of a guided filter that uses the image as its own
+// guide: the local luminance variance sets how much of the pixel to keep, a,
+// and the local mean fills in the rest, b. Outputs b in rgb and a in alpha.
+// The input is the output of GuidedFilterDownsampleFilter, and the mean and
+// variance are taken over 5x5 taps of it.
+class GPUPIXEL_API GuidedFilterCoefficientFilter : public Filter {
+ public:
+  static std::shared_ptr<GuidedFilterCoefficientFilter> Create();
+  bool Init();
+
+  virtual bool DoRender(bool updateSinks = true) override;
+
+  // Distance between the taps in texels of the input
+  void SetTapSpacing(float spacing);
+  // Luminance variance at which half of the pixel is kept. Smaller values
+  // preserve more detail.
+  void SetEpsilon(float epsilon);
+
+ protected:
+  GuidedFilterCoefficientFilter();
+
+  float tap_spacing_;
+  float epsilon_;
+};
+
+// Applies the smoothed guided filter coefficients, from the second input,
+// to the first input, then the whitening stages of BeautyFaceUnitFilter
+class GPUPIXEL_API GuidedBeautyUnitFilter : public BeautyFaceUnitFilter {
+ public:
+  static std::shared_ptr<GuidedBeautyUnitFilter> Create();
+  bool Init();
+
+  bool DoRender(bool updateSinks = true) override;
+
+ protected:
+  GuidedBeautyUnitFilter();
+};
+
+// Skin smoothing with a guided filter, as a cheaper alternative to
+// BeautyFaceFilter. The coefficients are computed at a quarter of the input
+// size, from means and variances over a 2x2 downsampling pyramid, and only
+// the last pass runs at full resolution, where BeautyFaceFilter runs six.
+class GPUPIXEL_API GuidedBeautyFilter : public FilterGroup {
+ public:
+  static std::shared_ptr<GuidedBeautyFilter> Create();
+
+  ~GuidedBeautyFilter();
+
+  bool Init();
+
+  void SetBlurAlpha(float blurAlpha);
+  void SetWhite(float white);
+  // Half width in pixels of the input of the window the mean and variance
+  // are taken over
+  void SetRadius(float radius);
+
+  bool IsIdentity() const override;
+
+  virtual void SetInputFramebuffer(
+      std::shared_ptr<GPUPixelFramebuffer> framebuffer,
+      RotationMode rotation_mode = NoRotation,
+      int texIdx = 0) override;
+
+ private:
+  GuidedBeautyFilter();
+  std::shared_ptr<GuidedFilterDownsampleFilter> half_filter_;
+  std::shared_ptr<GuidedFilterDownsampleFilter> quarter_filter_;
+  std::shared_ptr<GuidedFilterCoefficientFilter> coefficient_filter_;
+  std::shared_ptr<BoxBlurFilter> coefficient_blur_filter_;
+  std::shared_ptr<GuidedBeautyUnitFilter> unit_filter_;
+};
+
+}  // namespace gpupixel
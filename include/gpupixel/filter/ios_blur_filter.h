@@ -25,6 +25,7 @@ class GPUPIXEL_API IOSBlurFilter : public FilterGroup {
   void setSaturation(float saturation);
   void setRangeReductionFactor(float range_reduction_factor);
   void setDownSampling(float down_sampling);
+  void SetBlurBackend(GaussianBlurFilter::Backend backend);
 
  protected:
   IOSBlurFilter();
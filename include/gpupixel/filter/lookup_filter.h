@@ -18,6 +18,7 @@ class GPUPIXEL_API LookupFilter : public Filter {
   ~LookupFilter();
   virtual bool Init();
   virtual bool DoRender(bool updateSinks = true) override;
+  virtual bool IsIdentity() const override;
 
   void SetLookupImagePath(const std::string& lookupImagePath);
   void SetIntensity(float intensity);
@@ -27,11 +28,14 @@ class GPUPIXEL_API LookupFilter : public Filter {
 
  private:
   void LoadLookupTexture();
+  void UpdateLookupTexture();
 
   std::string lookup_image_path_;
   float intensity_;
-  uint32_t lookup_texture_;
-  bool lookup_texture_loaded_;
+  // Shared with the other users of the same table, see LookupTextureCache
+  std::shared_ptr<GPUPixelFramebuffer> lookup_texture_;
+  // Whether lookup_image_path_ is still to be swapped in
+  bool lookup_texture_pending_;
 };
 
 }  // namespace gpupixel
@@ -16,6 +16,9 @@ class GPUPIXEL_API PosterizeFilter : public Filter {
   static std::shared_ptr<PosterizeFilter> Create();
   bool Init();
   virtual bool DoRender(bool updateSinks = true) override;
+  virtual bool GetColorStage(ColorStage& stage) const override;
+  virtual void SetColorStageUniforms(GPUPixelGLProgram* program,
+                                     const std::string& prefix) override;
 
   void setColorLevels(int color_levels);
 
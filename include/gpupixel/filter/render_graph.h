@@ -0,0 +1,55 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+#pragma once
+
+#include <memory>
+#include "gpupixel/gpupixel_define.h"
+#include "gpupixel/source/source.h"
+
+namespace gpupixel {
+
+struct GPUPIXEL_API RenderGraphReport {
+  // Filters reached from the source, those whose output is transient, those
+  // folded into the pass of an earlier color filter, and those rendered
+  // through a baked lookup table
+  int filter_count;
+  int transient_count;
+  int fused_count;
+  int baked_count;
+  // Output memory when every filter keeps its framebuffer, and the estimated
+  // peak when transient outputs share framebuffers. Both are 0 until the
+  // source has a frame, since sizes follow the source
+  size_t peak_bytes_before;
+  size_t peak_bytes_after;
+};
+
+// Lifetime analysis of the filter graph below a source. Every filter with at
+// least one sink gets a transient output: it lives only until its sinks have
+// drawn from it and then returns to the framebuffer cache, where a later pass
+// of the same size picks it up again. So a chain of any length needs only a
+// few targets. Filters without sinks keep their output.
+//
+// Chains of per-pixel color filters, such as brightness, contrast and
+// saturation, where each is the only sink of the one before, are also fused
+// into a single pass that renders the chain with one generated program. With
+// bake, color chains and single color filters whose parameters stay the same
+// are rendered once into a lookup table, and frames take a single lookup.
+// The table has 64 levels per channel, so results are close to, not equal
+// to, the direct computation; stages that touch alpha are never baked.
+class GPUPIXEL_API RenderGraph {
+ public:
+  // Compile again after changing the graph. With alias false every output
+  // is kept, and with fuse and bake false every filter renders its own pass,
+  // as without compiling
+  static RenderGraphReport Compile(std::shared_ptr<Source> source,
+                                   bool alias = true,
+                                   bool fuse = true,
+                                   bool bake = false);
+};
+
+}  // namespace gpupixel
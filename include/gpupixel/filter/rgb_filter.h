@@ -16,6 +16,9 @@ class GPUPIXEL_API RGBFilter : public Filter {
   static std::shared_ptr<RGBFilter> Create();
   bool Init();
   virtual bool DoRender(bool updateSinks = true) override;
+  virtual bool GetColorStage(ColorStage& stage) const override;
+  virtual void SetColorStageUniforms(GPUPixelGLProgram* program,
+                                     const std::string& prefix) override;
 
   void setRedAdjustment(float red_adjustment);
   void setGreenAdjustment(float green_adjustment);
@@ -25,6 +25,7 @@ class GPUPIXEL_API SingleComponentGaussianBlurMonoFilter
                                                   float sigma) override;
   std::string GenerateOptimizedFragmentShaderString(int radius,
                                                     float sigma) override;
+  std::string GenerateParametricFragmentShaderString() override;
 };
 
 }  // namespace gpupixel
@@ -23,6 +23,7 @@ class GPUPIXEL_API SmoothToonFilter : public FilterGroup {
   void setBlurRadius(int blur_radius);
   void setToonThreshold(float toon_threshold);
   void setToonQuantizationLevels(float toon_quantization_levels);
+  void SetBlurBackend(GaussianBlurFilter::Backend backend);
 
  protected:
   SmoothToonFilter();
@@ -23,7 +23,7 @@ class GPUPIXEL_API SphereRefractionFilter : public Filter {
   void setRefractiveIndex(float refractive_index);
 
  protected:
-  SphereRefractionFilter() {};
+  SphereRefractionFilter();
 
   // The position about which to apply the distortion, with a default of (0.5,
   // 0.5)
@@ -0,0 +1,56 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+#pragma once
+
+#include <vector>
+#include "gpupixel/filter/filter.h"
+#include "gpupixel/gpupixel_define.h"
+
+namespace gpupixel {
+// Box blur that builds a summed-area table of the input in float
+// framebuffers, then averages any box with 4 fetches. Building the table
+// takes about log4 of the width plus log4 of the height passes, so the cost
+// per pixel does not depend on the radius. Needs float framebuffers, see
+// GPUPixelContext::SupportsFloatFramebuffers; Create returns null without.
+class GPUPIXEL_API SummedAreaTableBlurFilter : public Filter {
+ public:
+  virtual ~SummedAreaTableBlurFilter();
+
+  static std::shared_ptr<SummedAreaTableBlurFilter> Create(float radius = 4.0);
+  bool Init(float radius);
+
+  // Half width, in pixels of the output, of the box to average, rounded to
+  // the nearest pixel. Below half a pixel the input is left unchanged.
+  void SetRadius(float radius);
+
+  virtual bool IsIdentity() const override { return radius_ < 0.5; }
+  virtual bool DoRender(bool updateSinks = true) override;
+
+ protected:
+  SummedAreaTableBlurFilter();
+
+  // Adds to each texel the 3 at stride, 2 * stride and 3 * stride before it
+  // along the axis, so that log4 passes with growing strides sum the whole
+  // row or column up to it
+  void RenderPrefixPass(const std::shared_ptr<GPUPixelFramebuffer>& source,
+                        RotationMode rotation,
+                        const std::shared_ptr<GPUPixelFramebuffer>& target,
+                        bool vertical,
+                        int stride,
+                        float bias);
+
+  float radius_;
+  GPUPixelGLProgram* prefix_program_;
+  // Ping-pong targets, table_index_ telling which one holds the table
+  std::shared_ptr<GPUPixelFramebuffer> tables_[2];
+  int table_index_;
+  // Input the table was last built from
+  std::vector<uint64_t> table_signature_;
+};
+
+}  // namespace gpupixel
@@ -30,12 +30,14 @@
 // base filters
 #include "gpupixel/filter/filter.h"
 #include "gpupixel/filter/filter_group.h"
+#include "gpupixel/filter/render_graph.h"
 
 // face filters
 #include "gpupixel/filter/beauty_face_filter.h"
 #include "gpupixel/filter/blusher_filter.h"
 #include "gpupixel/filter/face_makeup_filter.h"
 #include "gpupixel/filter/face_reshape_filter.h"
+#include "gpupixel/filter/guided_beauty_filter.h"
 #include "gpupixel/filter/image_overlay_filter.h"
 #include "gpupixel/filter/mask_overlay_filter.h"
 #include "gpupixel/filter/nose_dero_filter.h"
@@ -45,6 +47,7 @@
 
 // general filters
 #include "gpupixel/filter/bilateral_filter.h"
+#include "gpupixel/filter/bilateral_grid_filter.h"
 #include "gpupixel/filter/box_blur_filter.h"
 #include "gpupixel/filter/box_high_pass_filter.h"
 #include "gpupixel/filter/brightness_filter.h"
@@ -56,6 +59,7 @@
 #include "gpupixel/filter/crosshatch_filter.h"
 #include "gpupixel/filter/directional_non_maximum_suppression_filter.h"
 #include "gpupixel/filter/directional_sobel_edge_detection_filter.h"
+#include "gpupixel/filter/dual_kawase_blur_filter.h"
 #include "gpupixel/filter/emboss_filter.h"
 #include "gpupixel/filter/exposure_filter.h"
 #include "gpupixel/filter/gaussian_blur_filter.h"
@@ -80,12 +84,15 @@
 #include "gpupixel/filter/smooth_toon_filter.h"
 #include "gpupixel/filter/sobel_edge_detection_filter.h"
 #include "gpupixel/filter/sphere_refraction_filter.h"
+#include "gpupixel/filter/summed_area_table_blur_filter.h"
 #include "gpupixel/filter/toon_filter.h"
 #include "gpupixel/filter/weak_pixel_inclusion_filter.h"
 #include "gpupixel/filter/white_balance_filter.h"
 
 namespace gpupixel {
 
+class GPUPixelContext;
+
 /**
  * GPUPixel Utility Class: Provides resource path management functionality
  */
@@ -96,6 +103,75 @@ class GPUPIXEL_API GPUPixel {
    * @param root Root directory path
    */
   static void SetResourcePath(const std::string& path);
+
+  /**
+   * Persist compiled shader programs in a directory, so later runs skip
+   * compiling and linking them. Entries from another driver or library
+   * version are ignored and replaced. Only available where the driver
+   * supports program binaries
+   * @param path Cache directory, created if missing; empty disables the cache
+   */
+  static void SetProgramCachePath(const std::string& path);
+
+  /**
+   * Create an independent processing context with its own GL thread,
+   * framebuffer cache and shader programs
+   * @param share_context Context whose textures are shared, or nullptr
+   * @return The new context; it must outlive every object created on it
+   */
+  static std::shared_ptr<GPUPixelContext> CreateContext(
+      std::shared_ptr<GPUPixelContext> share_context = nullptr);
+
+  /**
+   * Limit the memory of idle framebuffers a context keeps for reuse.
+   * Framebuffers return to the cache when no source or sink uses them any
+   * more; beyond the budget the least recently used ones are deleted
+   * @param bytes Budget in bytes, 0 disables reuse. The default is 128 MB
+   * @param context Context to configure, or nullptr for the current one
+   */
+  static void SetFramebufferCacheBudget(
+      size_t bytes,
+      std::shared_ptr<GPUPixelContext> context = nullptr);
+
+  /**
+   * Get the hit, miss and eviction counts of a context's framebuffer cache
+   * @param context Context to query, or nullptr for the current one
+   */
+  static GPUPIXEL_FRAMEBUFFER_CACHE_STATS GetFramebufferCacheStats(
+      std::shared_ptr<GPUPixelContext> context = nullptr);
+
+  /**
+   * Get the number of filter passes a context has drawn, and of those it
+   * skipped because nothing they depend on changed since their last draw
+   * @param context Context to query, or nullptr for the current one
+   */
+  static GPUPIXEL_RENDER_STATS GetRenderStats(
+      std::shared_ptr<GPUPixelContext> context = nullptr);
+
+  /**
+   * Reset the pass counts of a context to zero
+   * @param context Context to reset, or nullptr for the current one
+   */
+  static void ResetRenderStats(
+      std::shared_ptr<GPUPixelContext> context = nullptr);
+};
+
+/**
+ * Binds a context to the calling thread for the lifetime of the scope.
+ * Sources, sinks and filters created inside the scope render on that context;
+ * outside any scope the default context is used.
+ */
+class GPUPIXEL_API GPUPixelContextScope {
+ public:
+  explicit GPUPixelContextScope(std::shared_ptr<GPUPixelContext> context);
+  ~GPUPixelContextScope();
+
+  GPUPixelContextScope(const GPUPixelContextScope&) = delete;
+  GPUPixelContextScope& operator=(const GPUPixelContextScope&) = delete;
+
+ private:
+  std::shared_ptr<GPUPixelContext> context_;
+  GPUPixelContext* previous_context_;
 };
 
 }  // namespace gpupixel
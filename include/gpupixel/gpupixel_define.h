@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
@@ -84,4 +86,41 @@ typedef enum GPUPIXEL_API {
   GPUPIXEL_MODE_FMT_PICTURE,
 } GPUPIXEL_MODE_FMT;
 
+// What SourceRawData does with a new frame when its pipeline is full
+typedef enum GPUPIXEL_API {
+  // wait until a queued frame has been rendered
+  GPUPIXEL_FRAME_POLICY_BLOCK,
+  // replace the oldest frame that has not started rendering
+  GPUPIXEL_FRAME_POLICY_DROP_OLDEST,
+  // replace every frame that has not started rendering, even when the
+  // pipeline is not full, so only the newest frame waits
+  GPUPIXEL_FRAME_POLICY_LATEST_WINS,
+} GPUPIXEL_FRAME_POLICY;
+
+// Reuse statistics of a context's framebuffer cache
+typedef struct GPUPIXEL_API {
+  // requests served from the cache, and those that allocated
+  uint64_t hits;
+  uint64_t misses;
+  // idle framebuffers deleted to stay within the byte budget
+  uint64_t evictions;
+  // idle framebuffers currently held for reuse
+  size_t cached_count;
+  size_t cached_bytes;
+  size_t budget_bytes;
+  // framebuffers in use by sources and sinks, now and at most so far
+  size_t live_bytes;
+  size_t peak_live_bytes;
+} GPUPIXEL_FRAMEBUFFER_CACHE_STATS;
+
+// Filter passes of a context
+typedef struct GPUPIXEL_API {
+  // passes drawn, and those skipped because neither their inputs nor their
+  // properties changed since they last drew
+  uint64_t rendered_passes;
+  uint64_t skipped_passes;
+  // passes left out because the filter's parameters leave its input unchanged
+  uint64_t bypassed_passes;
+} GPUPIXEL_RENDER_STATS;
+
 }  // namespace gpupixel
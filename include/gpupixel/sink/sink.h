@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <map>
 #include "gpupixel/gpupixel_define.h"
@@ -24,6 +25,7 @@ enum GPUPIXEL_API RotationMode {
 
 // Forward declaration
 class GPUPixelFramebuffer;
+class GPUPixelContext;
 
 class GPUPIXEL_API Sink {
  public:
@@ -34,10 +36,17 @@ class GPUPIXEL_API Sink {
       RotationMode rotation_mode = NoRotation,
       int tex_idx = 0);
 
+  // Timestamp of the frame the inputs belong to, forwarded by the source
+  virtual void SetInputTimestamp(int64_t timestamp) {
+    input_timestamp_ = timestamp;
+  }
+
   virtual bool IsReady() const;
   virtual void ResetAndClean();
   virtual void Render() {};
   virtual int NextAvailableTextureIndex() const;
+  // Context the sink renders on, bound at construction
+  GPUPixelContext* GetContext() const { return context_; }
   // virtual void SetInputSizeWithIdx(int width, int height, int texture_idx)
   // {};
  protected:
@@ -50,6 +59,8 @@ class GPUPIXEL_API Sink {
 
   std::map<int, InputFrameBufferInfo> input_framebuffers_;
   int input_count_;
+  int64_t input_timestamp_;
+  GPUPixelContext* context_;
 };
 
 }  // namespace gpupixel
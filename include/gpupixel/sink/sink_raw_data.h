@@ -13,6 +13,7 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include "gpupixel/sink/sink.h"
 
@@ -25,6 +26,11 @@ namespace gpupixel {
 class GPUPixelGLProgram;
 class GPUPIXEL_API SinkRawData : public Sink {
  public:
+  // Receives each rendered frame on the GL thread with the timestamp passed to
+  // SourceRawData::ProcessData. data is only valid during the call.
+  using FrameCallback = std::function<
+      void(const uint8_t* data, int width, int height, int64_t timestamp)>;
+
   static std::shared_ptr<SinkRawData> Create();
   virtual ~SinkRawData();
   void Render() override;
@@ -34,8 +40,24 @@ class GPUPIXEL_API SinkRawData : public Sink {
   int GetWidth() const { return width_; }
   int GetHeight() const { return height_; }
 
+  void SetRgbaCallback(FrameCallback callback);
+  void SetI420Callback(FrameCallback callback);
+
+  // Number of frames whose readback may be outstanding. With 2 or 3, and
+  // where pixel buffer objects and fences are available (desktop GL 3.2+),
+  // frame N is read back asynchronously and delivered while frame N+1
+  // renders. Otherwise callbacks run right after each frame is rendered.
+  void SetPipelineDepth(int depth);
+
+  // Delivers every outstanding readback
+  void Flush();
+
  private:
   int RenderToOutput();
+  void ReadbackFrame();
+  void DeliverFrame(const uint8_t* rgba, int64_t timestamp);
+  void DeliverReadbacks(bool wait);
+  void ReleaseReadbacks();
   bool InitWithShaderString(const std::string& vertex_shader_source,
                             const std::string& fragment_shader_source);
   void InitTextureCache(int width, int height);
@@ -60,6 +82,19 @@ class GPUPIXEL_API SinkRawData : public Sink {
   // Frame buffers for pixel data
   uint8_t* rgba_buffer_ = nullptr;  // RGBA buffer
   uint8_t* yuv_buffer_ = nullptr;   // YUV buffer
+
+  FrameCallback rgba_callback_;
+  FrameCallback i420_callback_;
+
+  // Pixel pack buffers of the asynchronous readback, oldest at next_readback_
+  struct Readback {
+    uint32_t pbo = 0;
+    void* fence = nullptr;
+    int64_t timestamp = 0;
+  };
+  std::vector<Readback> readbacks_;
+  int pipeline_depth_ = 1;
+  int next_readback_ = 0;
 };
 
 }  // namespace gpupixel
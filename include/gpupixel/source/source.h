@@ -31,20 +31,34 @@ class GPUPIXEL_API Source {
   virtual std::shared_ptr<GPUPixelFramebuffer> GetFramebuffer() const;
   virtual void ReleaseFramebuffer(bool returnToCache = true);
 
+  // A transient output is only kept until every sink has drawn from it, then
+  // its framebuffer returns to the context's cache for later passes to reuse.
+  // Set by RenderGraph::Compile; GetFramebuffer() is empty after a render
+  void SetTransientOutput(bool transient) { transient_output_ = transient; }
+  bool IsTransientOutput() const { return transient_output_; }
+
   void SetFramebufferScale(float framebufferScale) {
     framebuffer_scale_ = framebufferScale;
   }
+  float GetFramebufferScale() const { return framebuffer_scale_; }
   int GetRotatedFramebufferWidth() const;
   int GetRotatedFramebufferHeight() const;
 
   virtual bool DoRender(bool updateSinks = true);
   virtual void DoUpdateSinks();
 
+  // Context the source renders on, bound at construction
+  GPUPixelContext* GetContext() const { return context_; }
+
  protected:
   std::shared_ptr<GPUPixelFramebuffer> framebuffer_;
   RotationMode output_rotation_;
   std::map<std::shared_ptr<Sink>, int> sinks_;
   float framebuffer_scale_;
+  bool transient_output_;
+  // Timestamp of the frame in framebuffer_, passed on to the sinks
+  int64_t timestamp_;
+  GPUPixelContext* context_;
 };
 
 }  // namespace gpupixel
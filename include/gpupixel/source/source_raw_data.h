@@ -7,24 +7,64 @@
 
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include "gpupixel/filter/filter.h"
 #include "gpupixel/source/source.h"
 
 namespace gpupixel {
 class GPUPixelGLProgram;
-class GPUPIXEL_API SourceRawData : public Filter {
+class GPUPIXEL_API SourceRawData
+    : public Filter,
+      public std::enable_shared_from_this<SourceRawData> {
  public:
+  // Called on the GL thread with the timestamp of a frame whose latency, from
+  // ProcessData to the end of rendering, exceeded the frame budget
+  using FrameBudgetCallback =
+      std::function<void(int64_t timestamp, int64_t latency_us)>;
+
   static std::shared_ptr<SourceRawData> Create();
 
   ~SourceRawData() override;
 
+  // timestamp is handed to the sinks with the frame, e.g. to tag the
+  // SinkRawData callbacks
   void ProcessData(const uint8_t* data,
                    int width,
                    int height,
                    int stride,
-                   GPUPIXEL_FRAME_TYPE type);
+                   GPUPIXEL_FRAME_TYPE type,
+                   int64_t timestamp = 0);
+
+  // Number of frames that may be in flight. With 1 (default) ProcessData
+  // returns once the frame is rendered. With 2 or 3 the frame is copied and
+  // queued, so the caller can prepare the next frame while the GL thread
+  // renders this one. When `depth` frames are in flight, the frame policy
+  // decides whether ProcessData blocks or drops a queued frame.
+  void SetPipelineDepth(int depth);
+  int GetPipelineDepth() const { return pipeline_depth_; }
+
+  // Waits until all queued frames have been rendered
+  void Flush();
+
+  // Decides what a pipelined ProcessData does when the GL thread falls
+  // behind. GPUPIXEL_FRAME_POLICY_BLOCK (default) applies backpressure to the
+  // caller, the others drop frames to keep latency bounded.
+  void SetFramePolicy(GPUPIXEL_FRAME_POLICY policy);
+
+  // budget_us <= 0 disables the check
+  void SetFrameBudget(int64_t budget_us, FrameBudgetCallback callback);
+
+  // Frames discarded by the frame policy since the pipeline was configured
+  uint64_t GetDroppedFrameCount() const;
+  // Frames waiting to be rendered, excluding the one rendering now
+  int GetQueuedFrameCount() const;
 
   void SetRotation(RotationMode rotation);
 
@@ -37,7 +77,8 @@ class GPUPIXEL_API SourceRawData : public Filter {
                                 int width,
                                 int height,
                                 int stride,
-                                GPUPIXEL_FRAME_TYPE type);
+                                GPUPIXEL_FRAME_TYPE type,
+                                int64_t timestamp);
 
  private:
   GPUPixelGLProgram* filter_program_;
@@ -47,6 +88,36 @@ class GPUPIXEL_API SourceRawData : public Filter {
   uint32_t texture_ = 0;
   RotationMode rotation_ = NoRotation;
   std::shared_ptr<GPUPixelFramebuffer> framebuffer_;
+
+  // Copies of the frames in flight. A slot is free, being filled by
+  // ProcessData, queued, or rendering on the GL thread. Every queued slot has
+  // a render task on the context queue; tasks whose frame was dropped find
+  // the queue empty and return.
+  struct PendingFrame {
+    std::vector<uint8_t> pixels;
+    int width;
+    int height;
+    int stride;
+    GPUPIXEL_FRAME_TYPE type;
+    int64_t timestamp;
+    std::chrono::steady_clock::time_point submit_time;
+  };
+  void RenderQueuedFrame();
+  void DropQueuedFrames(size_t count);
+  void CheckFrameBudget(int64_t timestamp,
+                        std::chrono::steady_clock::time_point submit_time);
+
+  std::vector<PendingFrame> pending_frames_;
+  std::vector<int> free_frames_;
+  std::deque<int> queued_frames_;
+  int pipeline_depth_ = 1;
+  int frames_in_flight_ = 0;
+  GPUPIXEL_FRAME_POLICY frame_policy_ = GPUPIXEL_FRAME_POLICY_BLOCK;
+  uint64_t dropped_frames_ = 0;
+  int64_t frame_budget_us_ = 0;
+  FrameBudgetCallback frame_budget_callback_;
+  mutable std::mutex pipeline_mutex_;
+  std::condition_variable pipeline_cv_;
 };
 
 }  // namespace gpupixel
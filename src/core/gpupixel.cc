@@ -1,4 +1,6 @@
 #include "gpupixel/gpupixel.h"
+#include "core/gpupixel_context.h"
+#include "core/gpupixel_program_cache.h"
 #include "utils/util.h"
 
 namespace gpupixel {
@@ -6,4 +8,52 @@ namespace gpupixel {
 void GPUPixel::SetResourcePath(const std::string& path) {
   Util::SetResourcePath(fs::path(path));
 }
+
+void GPUPixel::SetProgramCachePath(const std::string& path) {
+  ProgramBinaryCache::SetDirectory(path);
+}
+
+std::shared_ptr<GPUPixelContext> GPUPixel::CreateContext(
+    std::shared_ptr<GPUPixelContext> share_context /* = nullptr*/) {
+  return GPUPixelContext::Create(share_context.get());
+}
+
+void GPUPixel::SetFramebufferCacheBudget(
+    size_t bytes,
+    std::shared_ptr<GPUPixelContext> context /* = nullptr*/) {
+  GPUPixelContext* target =
+      context ? context.get() : GPUPixelContext::GetInstance();
+  target->GetFramebufferFactory()->SetBudget(bytes);
+}
+
+GPUPIXEL_FRAMEBUFFER_CACHE_STATS GPUPixel::GetFramebufferCacheStats(
+    std::shared_ptr<GPUPixelContext> context /* = nullptr*/) {
+  GPUPixelContext* target =
+      context ? context.get() : GPUPixelContext::GetInstance();
+  return target->GetFramebufferFactory()->GetStats();
+}
+
+GPUPIXEL_RENDER_STATS GPUPixel::GetRenderStats(
+    std::shared_ptr<GPUPixelContext> context /* = nullptr*/) {
+  GPUPixelContext* target =
+      context ? context.get() : GPUPixelContext::GetInstance();
+  return target->GetRenderStats();
+}
+
+void GPUPixel::ResetRenderStats(
+    std::shared_ptr<GPUPixelContext> context /* = nullptr*/) {
+  GPUPixelContext* target =
+      context ? context.get() : GPUPixelContext::GetInstance();
+  target->ResetRenderStats();
+}
+
+GPUPixelContextScope::GPUPixelContextScope(
+    std::shared_ptr<GPUPixelContext> context)
+    : context_(context) {
+  previous_context_ = GPUPixelContext::SetThreadContext(context_.get());
+}
+
+GPUPixelContextScope::~GPUPixelContextScope() {
+  GPUPixelContext::SetThreadContext(previous_context_);
+}
 }  // namespace gpupixel
@@ -6,36 +6,190 @@
  */
 
 #include "core/gpupixel_context.h"
+#include <map>
+#include "core/gpupixel_lookup_texture_cache.h"
 #include "utils/dispatch_queue.h"
 #include "utils/logging.h"
 #include "utils/util.h"
 #if defined(GPUPIXEL_WASM)
 #include <emscripten.h>
 #include <emscripten/html5.h>
+#elif defined(GPUPIXEL_LINUX_EGL)
+#include <cstdlib>
+#include <cstring>
 #endif
 
 namespace gpupixel {
 
+namespace {
+
+// Context bound to the calling thread, either because the thread is the
+// worker of that context or because a GPUPixelContextScope is alive on it.
+thread_local GPUPixelContext* current_context = nullptr;
+
+// Specialized programs a context keeps linked beyond the filters using them
+const size_t kProgramVariantCapacity = 8;
+
+// More than the distinct error flags an implementation records at once
+const int kMaxPendingGlErrors = 32;
+
+// Window system objects shared by all contexts (GLFW library state, EGL
+// display) are only torn down together with the last context. Contexts are
+// created and released under live_context_mutex, as GLFW is not thread-safe
+// and the count must not change while the last one tears them down.
+std::mutex live_context_mutex;
+int live_context_count = 0;
+
+// The context each context thread is blocked on in SyncRunWithFence
+std::mutex fence_wait_mutex;
+std::map<GPUPixelContext*, GPUPixelContext*> fence_waits;
+
+// Fences order the work of contexts in one share group. Contexts without
+// sync objects fall back to finishing the producer's command queue.
+void* InsertFence() {
+#if defined(GPUPIXEL_WIN) || defined(GPUPIXEL_LINUX)
+  if (GLAD_GL_VERSION_3_2) {
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    return fence;
+  }
+#endif
+  glFinish();
+  return nullptr;
+}
+
+void WaitFence(void* fence) {
+#if defined(GPUPIXEL_WIN) || defined(GPUPIXEL_LINUX)
+  if (fence) {
+    glWaitSync((GLsync)fence, 0, GL_TIMEOUT_IGNORED);
+    glDeleteSync((GLsync)fence);
+  }
+#endif
+}
+
+}  // namespace
+
+#if defined(GPUPIXEL_LINUX_EGL)
+namespace {
+
+bool HasEglExtension(const char* extensions, const char* name) {
+  if (!extensions) {
+    return false;
+  }
+  const size_t name_length = strlen(name);
+  for (const char* p = strstr(extensions, name); p;
+       p = strstr(p + name_length, name)) {
+    bool starts_token = (p == extensions || p[-1] == ' ');
+    bool ends_token = (p[name_length] == ' ' || p[name_length] == '\0');
+    if (starts_token && ends_token) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool EnvEquals(const char* name, const char* value) {
+  const char* env = getenv(name);
+  return env && strcmp(env, value) == 0;
+}
+
+bool EnvUnsetOrEquals(const char* name, const char* value) {
+  const char* env = getenv(name);
+  return !env || !*env || strcmp(env, value) == 0;
+}
+
+// Opens a display that does not need a window system. The platform can be
+// forced with GPUPIXEL_EGL_PLATFORM=surfaceless|device|default, otherwise
+// Mesa's surfaceless platform is tried first, then the first EGL device.
+EGLDisplay GetHeadlessEglDisplay() {
+  const char* client_extensions =
+      eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  auto get_platform_display =
+      (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+          "eglGetPlatformDisplayEXT");
+
+  if (get_platform_display &&
+      EnvUnsetOrEquals("GPUPIXEL_EGL_PLATFORM", "surfaceless") &&
+      HasEglExtension(client_extensions, "EGL_MESA_platform_surfaceless")) {
+    EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                              EGL_DEFAULT_DISPLAY, nullptr);
+    if (display != EGL_NO_DISPLAY) {
+      LOG_DEBUG("Using EGL surfaceless platform");
+      return display;
+    }
+  }
+
+  if (get_platform_display &&
+      EnvUnsetOrEquals("GPUPIXEL_EGL_PLATFORM", "device") &&
+      HasEglExtension(client_extensions, "EGL_EXT_platform_device")) {
+    auto query_devices =
+        (PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+    EGLDeviceEXT device;
+    EGLint num_devices = 0;
+    if (query_devices && query_devices(1, &device, &num_devices) &&
+        num_devices > 0) {
+      EGLDisplay display =
+          get_platform_display(EGL_PLATFORM_DEVICE_EXT, device, nullptr);
+      if (display != EGL_NO_DISPLAY) {
+        LOG_DEBUG("Using EGL device platform");
+        return display;
+      }
+    }
+  }
+
+  LOG_DEBUG("Using default EGL display");
+  return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+}  // namespace
+#endif
+
 GPUPixelContext* GPUPixelContext::instance_ = 0;
 std::mutex GPUPixelContext::mutex_;
 
-GPUPixelContext::GPUPixelContext() : current_shader_program_(0) {
+GPUPixelContext::GPUPixelContext(GPUPixelContext* share_context)
+    : current_shader_program_(0),
+      float_framebuffer_support_(-1),
+      share_context_(share_context),
+      rendered_passes_(0),
+      skipped_passes_(0),
+      bypassed_passes_(0) {
   LOG_DEBUG("Creating GPUPixelContext");
 #if !defined(GPUPIXEL_WASM)
   task_queue_ = std::make_shared<DispatchQueue>();
 #endif
   framebuffer_factory_ = new FramebufferFactory();
+  gl_state_cache_ = new GLStateCache();
+  program_variant_cache_ = new ProgramVariantCache(kProgramVariantCapacity);
   Init();
 }
 
 GPUPixelContext::~GPUPixelContext() {
   LOG_DEBUG("Destroying GPUPixelContext");
-  ReleaseContext();
+  LookupTextureCache::ReleaseContext(this);
+  // cached framebuffers release their GL objects on this context's thread
   delete framebuffer_factory_;
+  delete program_variant_cache_;
+#if defined(GPUPIXEL_WASM)
+  ReleaseContext();
+#else
+  task_queue_->runTask([=] { ReleaseContext(); });
   task_queue_->stop();
+#endif
+  delete gl_state_cache_;
+}
+
+std::shared_ptr<GPUPixelContext> GPUPixelContext::Create(
+    GPUPixelContext* share_context /* = nullptr*/) {
+  return std::shared_ptr<GPUPixelContext>(
+      new GPUPixelContext(share_context),
+      [](GPUPixelContext* context) { delete context; });
 }
 
 GPUPixelContext* GPUPixelContext::GetInstance() {
+  if (current_context) {
+    return current_context;
+  }
   if (!instance_) {
     std::unique_lock<std::mutex> lock(mutex_);
     if (!instance_) {
@@ -52,6 +206,12 @@ void GPUPixelContext::Destroy() {
   }
 }
 
+GPUPixelContext* GPUPixelContext::SetThreadContext(GPUPixelContext* context) {
+  GPUPixelContext* previous = current_context;
+  current_context = context;
+  return previous;
+}
+
 void GPUPixelContext::Init() {
   SyncRunWithContext([=] {
     LOG_INFO("Initializing GPUPixelContext");
@@ -63,11 +223,43 @@ FramebufferFactory* GPUPixelContext::GetFramebufferFactory() const {
   return framebuffer_factory_;
 }
 
-void GPUPixelContext::SetActiveGlProgram(GPUPixelGLProgram* shaderProgram) {
-  if (current_shader_program_ != shaderProgram) {
-    current_shader_program_ = shaderProgram;
-    shaderProgram->UseProgram();
+GLStateCache* GPUPixelContext::GetGlStateCache() const {
+  return gl_state_cache_;
+}
+
+ProgramVariantCache* GPUPixelContext::GetProgramVariantCache() const {
+  return program_variant_cache_;
+}
+
+bool GPUPixelContext::SupportsFloatFramebuffers() {
+  if (float_framebuffer_support_ < 0) {
+    SyncRunWithContext([=] {
+      // Float color attachments are core in desktop GL 3.0 but an extension
+      // in GLES and WebGL, so completeness is the only portable test
+      // A lost context keeps reporting an error, so the errors left over
+      // from earlier calls are only drained up to a limit
+      for (int i = 0; i < kMaxPendingGlErrors; i++) {
+        if (glGetError() == GL_NO_ERROR) {
+          break;
+        }
+      }
+      GPUPixelFramebuffer probe(
+          1, 1, false, GPUPixelFramebuffer::float_texture_attributes);
+      probe.Activate();
+      GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+      probe.Deactivate();
+      float_framebuffer_support_ =
+          glGetError() == GL_NO_ERROR && status == GL_FRAMEBUFFER_COMPLETE;
+      LOG_DEBUG("Float framebuffers {}",
+                float_framebuffer_support_ ? "supported" : "unsupported");
+    });
   }
+  return float_framebuffer_support_ == 1;
+}
+
+void GPUPixelContext::SetActiveGlProgram(GPUPixelGLProgram* shaderProgram) {
+  current_shader_program_ = shaderProgram;
+  shaderProgram->UseProgram();
 }
 
 void GPUPixelContext::Clean() {
@@ -75,10 +267,41 @@ void GPUPixelContext::Clean() {
   framebuffer_factory_->Clean();
 }
 
+void GPUPixelContext::CountPass(bool skipped) {
+  if (skipped) {
+    skipped_passes_++;
+  } else {
+    rendered_passes_++;
+  }
+}
+
+GPUPIXEL_RENDER_STATS GPUPixelContext::GetRenderStats() const {
+  GPUPIXEL_RENDER_STATS stats;
+  stats.rendered_passes = rendered_passes_;
+  stats.skipped_passes = skipped_passes_;
+  stats.bypassed_passes = bypassed_passes_;
+  return stats;
+}
+
+void GPUPixelContext::ResetRenderStats() {
+  rendered_passes_ = 0;
+  skipped_passes_ = 0;
+  bypassed_passes_ = 0;
+}
+
 void GPUPixelContext::CreateContext() {
+  std::unique_lock<std::mutex> lock(live_context_mutex);
+  live_context_count++;
 #if defined(GPUPIXEL_IOS)
   LOG_DEBUG("Creating iOS OpenGL ES 2.0 context");
-  egl_context_ = [[EAGLContext alloc] initWithAPI:kEAGLRenderingAPIOpenGLES2];
+  if (share_context_) {
+    egl_context_ = [[EAGLContext alloc]
+          initWithAPI:kEAGLRenderingAPIOpenGLES2
+           sharegroup:[share_context_->GetEglContext() sharegroup]];
+  } else {
+    egl_context_ =
+        [[EAGLContext alloc] initWithAPI:kEAGLRenderingAPIOpenGLES2];
+  }
   if (!egl_context_) {
     LOG_ERROR("Failed to create iOS OpenGL ES 2.0 context");
     return;
@@ -108,8 +331,10 @@ void GPUPixelContext::CreateContext() {
     return;
   }
 
-  image_processing_context_ =
-      [[NSOpenGLContext alloc] initWithFormat:pixel_format_ shareContext:nil];
+  image_processing_context_ = [[NSOpenGLContext alloc]
+      initWithFormat:pixel_format_
+        shareContext:share_context_ ? share_context_->GetOpenGLContext()
+                                    : nil];
   if (!image_processing_context_) {
     LOG_ERROR("Failed to create NSOpenGLContext");
     return;
@@ -165,8 +390,10 @@ void GPUPixelContext::CreateContext() {
   // Create EGL context
   const EGLint contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE};
 
-  egl_context_ = eglCreateContext(egl_display_, egl_config_, EGL_NO_CONTEXT,
-                                  contextAttribs);
+  egl_context_ = eglCreateContext(
+      egl_display_, egl_config_,
+      share_context_ ? share_context_->GetEglContext() : EGL_NO_CONTEXT,
+      contextAttribs);
   if (egl_context_ == EGL_NO_CONTEXT) {
     LOG_ERROR("Failed to create EGL context");
     return;
@@ -188,6 +415,95 @@ void GPUPixelContext::CreateContext() {
     return;
   }
   LOG_INFO("Android EGL context created successfully");
+#elif defined(GPUPIXEL_LINUX_EGL)
+  LOG_DEBUG("Creating Linux headless EGL context");
+  egl_surface_ = EGL_NO_SURFACE;
+  egl_context_ = EGL_NO_CONTEXT;
+  egl_display_ = GetHeadlessEglDisplay();
+  if (egl_display_ == EGL_NO_DISPLAY) {
+    LOG_ERROR("Failed to get EGL display");
+    return;
+  }
+
+  EGLint major, minor;
+  if (!eglInitialize(egl_display_, &major, &minor)) {
+    LOG_ERROR("Failed to initialize EGL");
+    egl_display_ = EGL_NO_DISPLAY;
+    return;
+  }
+  LOG_DEBUG("EGL initialized: version major:{} minor:{}", major, minor);
+
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    LOG_ERROR("Failed to bind EGL OpenGL API");
+    // The display stays initialized while other contexts use it
+    ReleaseEglObjects(live_context_count == 1);
+    return;
+  }
+
+  // Render without any surface when the driver allows it, a 1x1 pbuffer can
+  // be forced with GPUPIXEL_EGL_SURFACE=pbuffer
+  const char* display_extensions = eglQueryString(egl_display_, EGL_EXTENSIONS);
+  bool use_pbuffer =
+      EnvEquals("GPUPIXEL_EGL_SURFACE", "pbuffer") ||
+      !HasEglExtension(display_extensions, "EGL_KHR_surfaceless_context");
+
+  const EGLint configAttribs[] = {EGL_RED_SIZE,
+                                  8,
+                                  EGL_GREEN_SIZE,
+                                  8,
+                                  EGL_BLUE_SIZE,
+                                  8,
+                                  EGL_ALPHA_SIZE,
+                                  8,
+                                  EGL_SURFACE_TYPE,
+                                  use_pbuffer ? EGL_PBUFFER_BIT : 0,
+                                  EGL_RENDERABLE_TYPE,
+                                  EGL_OPENGL_BIT,
+                                  EGL_NONE};
+
+  EGLint numConfigs = 0;
+  if (!eglChooseConfig(egl_display_, configAttribs, &egl_config_, 1,
+                       &numConfigs) ||
+      numConfigs < 1) {
+    LOG_ERROR("Failed to choose EGL config");
+    ReleaseEglObjects(live_context_count == 1);
+    return;
+  }
+
+  egl_context_ = eglCreateContext(
+      egl_display_, egl_config_,
+      share_context_ ? share_context_->GetEglContext() : EGL_NO_CONTEXT,
+      nullptr);
+  if (egl_context_ == EGL_NO_CONTEXT) {
+    LOG_ERROR("Failed to create EGL context");
+    ReleaseEglObjects(live_context_count == 1);
+    return;
+  }
+
+  if (use_pbuffer) {
+    const EGLint pbufferAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    egl_surface_ =
+        eglCreatePbufferSurface(egl_display_, egl_config_, pbufferAttribs);
+    if (egl_surface_ == EGL_NO_SURFACE) {
+      LOG_ERROR("Failed to create EGL surface");
+      ReleaseEglObjects(live_context_count == 1);
+      return;
+    }
+  }
+
+  if (!eglMakeCurrent(egl_display_, egl_surface_, egl_surface_, egl_context_)) {
+    LOG_ERROR("Failed to make EGL context current");
+    ReleaseEglObjects(live_context_count == 1);
+    return;
+  }
+
+  if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+    LOG_ERROR("Failed to initialize GLAD");
+    ReleaseEglObjects(live_context_count == 1);
+    return;
+  }
+  LOG_INFO("Linux headless EGL context created successfully, {}",
+           (const char*)glGetString(GL_RENDERER));
 #elif defined(GPUPIXEL_WIN) || defined(GPUPIXEL_LINUX)
   LOG_DEBUG("Creating Windows/Linux OpenGL context");
   int ret = glfwInit();
@@ -201,10 +517,12 @@ void GPUPixelContext::CreateContext() {
     LOG_ERROR("Failed to initialize GLFW");
     return;
   }
-  gl_context_ = glfwCreateWindow(1, 1, "gpupixel opengl context", NULL, NULL);
+  gl_context_ = glfwCreateWindow(
+      1, 1, "gpupixel opengl context", NULL,
+      share_context_ ? share_context_->GetGLContext() : NULL);
   if (!gl_context_) {
+    // GLFW is terminated with the last context, others may still use it
     LOG_ERROR("Failed to create GLFW window");
-    glfwTerminate();
     return;
   }
   glfwMakeContextCurrent(gl_context_);
@@ -241,7 +559,7 @@ void GPUPixelContext::UseAsCurrent() {
     LOG_TRACE("Setting current NSOpenGLContext");
     [image_processing_context_ makeCurrentContext];
   }
-#elif defined(GPUPIXEL_ANDROID)
+#elif defined(GPUPIXEL_ANDROID) || defined(GPUPIXEL_LINUX_EGL)
   if (eglGetCurrentContext() != egl_context_) {
     LOG_TRACE("Setting current EGL context");
     eglMakeCurrent(egl_display_, egl_surface_, egl_surface_, egl_context_);
@@ -271,34 +589,19 @@ void GPUPixelContext::PresentBufferForDisplay() {
 
 void GPUPixelContext::ReleaseContext() {
   LOG_DEBUG("Releasing OpenGL context");
-#if defined(GPUPIXEL_ANDROID)
-  if (egl_display_ != EGL_NO_DISPLAY) {
-    eglMakeCurrent(egl_display_, EGL_NO_SURFACE, EGL_NO_SURFACE,
-                   EGL_NO_CONTEXT);
-
-    if (egl_surface_ != EGL_NO_SURFACE) {
-      LOG_TRACE("Destroying EGL surface");
-      eglDestroySurface(egl_display_, egl_surface_);
-      egl_surface_ = EGL_NO_SURFACE;
-    }
-
-    if (egl_context_ != EGL_NO_CONTEXT) {
-      LOG_TRACE("Destroying EGL context");
-      eglDestroyContext(egl_display_, egl_context_);
-      egl_context_ = EGL_NO_CONTEXT;
-    }
-
-    LOG_TRACE("Terminating EGL display");
-    eglTerminate(egl_display_);
-    egl_display_ = EGL_NO_DISPLAY;
-  }
+  std::unique_lock<std::mutex> lock(live_context_mutex);
+  bool is_last_context = (--live_context_count == 0);
+#if defined(GPUPIXEL_ANDROID) || defined(GPUPIXEL_LINUX_EGL)
+  ReleaseEglObjects(is_last_context);
 #elif defined(GPUPIXEL_WIN) || defined(GPUPIXEL_LINUX)
   if (gl_context_) {
     LOG_TRACE("Destroying GLFW window");
     glfwDestroyWindow(gl_context_);
   }
-  LOG_TRACE("Terminating GLFW");
-  glfwTerminate();
+  if (is_last_context) {
+    LOG_TRACE("Terminating GLFW");
+    glfwTerminate();
+  }
 #elif defined(GPUPIXEL_WASM)
   LOG_TRACE("Destroying WebGL context");
   emscripten_webgl_destroy_context(wasm_context_);
@@ -306,6 +609,34 @@ void GPUPixelContext::ReleaseContext() {
   LOG_INFO("OpenGL context released successfully");
 }
 
+#if defined(GPUPIXEL_ANDROID) || defined(GPUPIXEL_LINUX_EGL)
+void GPUPixelContext::ReleaseEglObjects(bool is_last_context) {
+  if (egl_display_ == EGL_NO_DISPLAY) {
+    return;
+  }
+  eglMakeCurrent(egl_display_, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                 EGL_NO_CONTEXT);
+
+  if (egl_surface_ != EGL_NO_SURFACE) {
+    LOG_TRACE("Destroying EGL surface");
+    eglDestroySurface(egl_display_, egl_surface_);
+    egl_surface_ = EGL_NO_SURFACE;
+  }
+
+  if (egl_context_ != EGL_NO_CONTEXT) {
+    LOG_TRACE("Destroying EGL context");
+    eglDestroyContext(egl_display_, egl_context_);
+    egl_context_ = EGL_NO_CONTEXT;
+  }
+
+  if (is_last_context) {
+    LOG_TRACE("Terminating EGL display");
+    eglTerminate(egl_display_);
+  }
+  egl_display_ = EGL_NO_DISPLAY;
+}
+#endif
+
 void GPUPixelContext::SyncRunWithContext(std::function<void(void)> task) {
 #if defined(GPUPIXEL_IOS) || defined(GPUPIXEL_MAC)
   if (!Util::IsAppleAppActive()) {
@@ -315,14 +646,96 @@ void GPUPixelContext::SyncRunWithContext(std::function<void(void)> task) {
 
 #if defined(GPUPIXEL_WASM)
   LOG_TRACE("Running task synchronously (WebGL)");
+  GPUPixelContext* previous_context = SetThreadContext(this);
   UseAsCurrent();
   task();
+  SetThreadContext(previous_context);
 #else
   LOG_TRACE("Running task on task queue");
-  task_queue_->runTask([=]() {
+  task_queue_->runTask([&]() {
+    current_context = this;
+    UseAsCurrent();
+    task();
+  });
+#endif
+}
+
+void GPUPixelContext::AsyncRunWithContext(std::function<void(void)> task) {
+#if defined(GPUPIXEL_IOS) || defined(GPUPIXEL_MAC)
+  if (!Util::IsAppleAppActive()) {
+    return;
+  }
+#endif
+
+#if defined(GPUPIXEL_WASM)
+  SyncRunWithContext(task);
+#else
+  LOG_TRACE("Queueing task on task queue");
+  task_queue_->runTaskAsync([this, task = std::move(task)]() {
+    current_context = this;
     UseAsCurrent();
     task();
   });
 #endif
 }
+
+std::future<void> GPUPixelContext::SubmitWithContext(
+    std::function<void(void)> task) {
+#if defined(GPUPIXEL_IOS) || defined(GPUPIXEL_MAC)
+  if (!Util::IsAppleAppActive()) {
+    std::promise<void> skipped;
+    skipped.set_value();
+    return skipped.get_future();
+  }
+#endif
+
+#if defined(GPUPIXEL_WASM)
+  std::packaged_task<void()> packaged(
+      [this, &task]() { SyncRunWithContext(task); });
+  std::future<void> future = packaged.get_future();
+  packaged();
+  return future;
+#else
+  LOG_TRACE("Submitting task on task queue");
+  return task_queue_->submitTask([this, task = std::move(task)]() {
+    current_context = this;
+    UseAsCurrent();
+    task();
+  });
+#endif
+}
+
+void GPUPixelContext::SyncRunWithFence(std::function<void(void)> task) {
+  void* fence = InsertFence();
+  auto fenced_task = [this, fence, task]() {
+    WaitFence(fence);
+    // the other context may have deleted textures this one still caches
+    gl_state_cache_->Invalidate();
+    task();
+  };
+
+  // Two contexts feeding each other would each wait for the other's thread,
+  // so the one closing the cycle queues its task instead
+  GPUPixelContext* waiting_context = current_context;
+  if (waiting_context) {
+    std::unique_lock<std::mutex> lock(fence_wait_mutex);
+    for (GPUPixelContext* context = this; context;) {
+      if (context == waiting_context) {
+        lock.unlock();
+        AsyncRunWithContext(fenced_task);
+        return;
+      }
+      auto it = fence_waits.find(context);
+      context = it != fence_waits.end() ? it->second : nullptr;
+    }
+    fence_waits[waiting_context] = this;
+  }
+
+  SyncRunWithContext(fenced_task);
+
+  if (waiting_context) {
+    std::unique_lock<std::mutex> lock(fence_wait_mutex);
+    fence_waits.erase(waiting_context);
+  }
+}
 }  // namespace gpupixel
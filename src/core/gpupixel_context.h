@@ -7,13 +7,17 @@
 
 #pragma once
 
+#include <atomic>
+#include <future>
 #include <mutex>
 #include "core/gpupixel_framebuffer_factory.h"
+#include "core/gpupixel_gl_state_cache.h"
 #include "gpupixel/filter/filter.h"
 #include "gpupixel/gpupixel_define.h"
 
 #include "core/gpupixel_gl_include.h"
 #include "core/gpupixel_program.h"
+#include "core/gpupixel_program_cache.h"
 
 class DispatchQueue;
 
@@ -21,14 +25,52 @@ namespace gpupixel {
 
 class GPUPIXEL_API GPUPixelContext {
  public:
+  // Creates an independent context with its own GL thread, framebuffer cache
+  // and programs. Textures are shared with share_context when given.
+  static std::shared_ptr<GPUPixelContext> Create(
+      GPUPixelContext* share_context = nullptr);
+
+  // Returns the context bound to the calling thread, or the default context
   static GPUPixelContext* GetInstance();
   static void Destroy();
 
+  // Binds context to the calling thread and returns the previous binding
+  static GPUPixelContext* SetThreadContext(GPUPixelContext* context);
+
   FramebufferFactory* GetFramebufferFactory() const;
+  // GL state calls of this context go through the cache, see GLStateCache
+  GLStateCache* GetGlStateCache() const;
+
+  // Recently used specialized programs, kept linked for filters that switch
+  // between variants, see ProgramVariantCache
+  ProgramVariantCache* GetProgramVariantCache() const;
+
+  // Whether framebuffers with GPUPixelFramebuffer::float_texture_attributes
+  // can be rendered to, probed once per context
+  bool SupportsFloatFramebuffers();
   void SetActiveGlProgram(GPUPixelGLProgram* shaderProgram);
   void Clean();
 
+  // Counts a filter pass that was drawn, or skipped as unchanged
+  void CountPass(bool skipped);
+  // Counts a pass left out because it would not change its input
+  void CountBypassedPass() { bypassed_passes_++; }
+  GPUPIXEL_RENDER_STATS GetRenderStats() const;
+  void ResetRenderStats();
+
   void SyncRunWithContext(std::function<void(void)> func);
+  // Like SyncRunWithContext, but first fences the GL work already issued on
+  // the calling thread's context, so its textures can be sampled here. When
+  // this context is itself waiting on the caller's, func is queued like in
+  // AsyncRunWithContext instead, so it must not refer to the caller's stack
+  void SyncRunWithFence(std::function<void(void)> func);
+  // Queues func on the context thread and returns immediately. Tasks run in
+  // submission order, interleaved with synchronous ones; the caller blocks
+  // only while the queue is full
+  void AsyncRunWithContext(std::function<void(void)> func);
+  // Like AsyncRunWithContext, but the returned future becomes ready when func
+  // has run and rethrows its exception, if any
+  std::future<void> SubmitWithContext(std::function<void(void)> func);
   void UseAsCurrent(void);
   void PresentBufferForDisplay();
 
@@ -38,7 +80,7 @@ class GPUPIXEL_API GPUPixelContext {
   NSOpenGLContext* GetOpenGLContext() const {
     return image_processing_context_;
   };
-#elif defined(GPUPIXEL_ANDROID)
+#elif defined(GPUPIXEL_ANDROID) || defined(GPUPIXEL_LINUX_EGL)
   EGLContext GetEglContext() const { return egl_context_; };
   EGLDisplay GetEglDisplay() const { return egl_display_; };
   EGLSurface GetEglSurface() const { return egl_surface_; };
@@ -47,27 +89,40 @@ class GPUPIXEL_API GPUPixelContext {
 #endif
 
  private:
-  GPUPixelContext();
+  GPUPixelContext(GPUPixelContext* share_context = nullptr);
   ~GPUPixelContext();
 
   void Init();
 
   void CreateContext();
   void ReleaseContext();
+#if defined(GPUPIXEL_ANDROID) || defined(GPUPIXEL_LINUX_EGL)
+  // Destroys the EGL surface and context, and terminates the display when
+  // no other context uses it. Needs live_context_mutex.
+  void ReleaseEglObjects(bool is_last_context);
+#endif
 
  private:
   static GPUPixelContext* instance_;
   static std::mutex mutex_;
   FramebufferFactory* framebuffer_factory_;
+  GLStateCache* gl_state_cache_;
+  ProgramVariantCache* program_variant_cache_;
   GPUPixelGLProgram* current_shader_program_;
+  // -1 until probed, read from any thread
+  std::atomic<int> float_framebuffer_support_;
+  GPUPixelContext* share_context_;
   std::shared_ptr<DispatchQueue> task_queue_;
+  std::atomic<uint64_t> rendered_passes_;
+  std::atomic<uint64_t> skipped_passes_;
+  std::atomic<uint64_t> bypassed_passes_;
 
 #if defined(GPUPIXEL_IOS)
   EAGLContext* egl_context_;
 #elif defined(GPUPIXEL_MAC)
   NSOpenGLPixelFormat* pixel_format_;
   NSOpenGLContext* image_processing_context_;
-#elif defined(GPUPIXEL_ANDROID)
+#elif defined(GPUPIXEL_ANDROID) || defined(GPUPIXEL_LINUX_EGL)
   EGLDisplay egl_display_;
   EGLConfig egl_config_;
   EGLSurface egl_surface_;
@@ -8,11 +8,21 @@
 #include "core/gpupixel_framebuffer.h"
 #include <assert.h>
 #include <algorithm>
+#include <atomic>
 #include "core/gpupixel_context.h"
 #include "utils/util.h"
 
 namespace gpupixel {
 
+namespace {
+std::atomic<uint64_t> content_version_counter(0);
+}  // namespace
+
+// Not in the legacy desktop headers of macOS
+#ifndef GL_RGBA32F
+#define GL_RGBA32F 0x8814
+#endif
+
 // std::vector<std::shared_ptr<GPUPixelFramebuffer>>
 // GPUPixelFramebuffer::framebuffers_;
 #ifndef GPUPIXEL_WIN
@@ -24,10 +34,21 @@ TextureAttributes GPUPixelFramebuffer::default_texture_attributes = {
     .internalFormat = GL_RGBA,
     .format = GL_RGBA,
     .type = GL_UNSIGNED_BYTE};
+TextureAttributes GPUPixelFramebuffer::float_texture_attributes = {
+    .minFilter = GL_NEAREST,
+    .magFilter = GL_NEAREST,
+    .wrapS = GL_CLAMP_TO_EDGE,
+    .wrapT = GL_CLAMP_TO_EDGE,
+    .internalFormat = GL_RGBA32F,
+    .format = GL_RGBA,
+    .type = GL_FLOAT};
 #else
 TextureAttributes GPUPixelFramebuffer::default_texture_attributes = {
     GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE,
     GL_RGBA,   GL_RGBA,   GL_UNSIGNED_BYTE};
+TextureAttributes GPUPixelFramebuffer::float_texture_attributes = {
+    GL_NEAREST, GL_NEAREST, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE,
+    GL_RGBA32F, GL_RGBA,    GL_FLOAT};
 #endif
 GPUPixelFramebuffer::GPUPixelFramebuffer(
     int width,
@@ -35,7 +56,10 @@ GPUPixelFramebuffer::GPUPixelFramebuffer(
     bool only_generate_texture /* = false*/,
     const TextureAttributes
         texture_attributes /* = default_texture_attributes*/)
-    : texture_(-1), framebuffer_(-1) {
+    : texture_(-1),
+      framebuffer_(-1),
+      content_version_(++content_version_counter),
+      context_(GPUPixelContext::GetInstance()) {
   width_ = width;
   height_ = height;
   texture_attributes_ = texture_attributes;
@@ -49,15 +73,20 @@ GPUPixelFramebuffer::GPUPixelFramebuffer(
 }
 
 GPUPixelFramebuffer::~GPUPixelFramebuffer() {
-  gpupixel::GPUPixelContext::GetInstance()->SyncRunWithContext([&] {
+  if (texture_ == (uint32_t)-1 && framebuffer_ == (uint32_t)-1) {
+    return;
+  }
+  context_->SyncRunWithContext([&] {
     bool should_delete_texture = (texture_ != -1);
     bool should_delete_framebuffer = (framebuffer_ != -1);
 
     if (should_delete_texture) {
+      context_->GetGlStateCache()->OnTextureDeleted(texture_);
       GL_CALL(glDeleteTextures(1, &texture_));
       texture_ = -1;
     }
     if (should_delete_framebuffer) {
+      context_->GetGlStateCache()->OnFramebufferDeleted(framebuffer_);
       GL_CALL(glDeleteFramebuffers(1, &framebuffer_));
       framebuffer_ = -1;
     }
@@ -65,17 +94,29 @@ GPUPixelFramebuffer::~GPUPixelFramebuffer() {
 }
 
 void GPUPixelFramebuffer::Activate() {
-  GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_));
-  GL_CALL(glViewport(0, 0, width_, height_));
+  GLStateCache* gl_state = context_->GetGlStateCache();
+  gl_state->BindFramebuffer(framebuffer_);
+  gl_state->Viewport(0, 0, width_, height_);
+  MarkModified();
+}
+
+void GPUPixelFramebuffer::MarkModified() {
+  content_version_ = ++content_version_counter;
+}
+
+void GPUPixelFramebuffer::Abandon() {
+  texture_ = -1;
+  framebuffer_ = -1;
 }
 
 void GPUPixelFramebuffer::Deactivate() {
-  GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+  context_->GetGlStateCache()->BindFramebuffer(0);
 }
 
 void GPUPixelFramebuffer::GenerateTexture() {
+  GLStateCache* gl_state = context_->GetGlStateCache();
   GL_CALL(glGenTextures(1, &texture_));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D, texture_));
+  gl_state->BindTexture(texture_);
   GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
                           texture_attributes_.minFilter));
   GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
@@ -86,21 +127,22 @@ void GPUPixelFramebuffer::GenerateTexture() {
                           texture_attributes_.wrapT));
 
   // TODO: Handle mipmaps
-  GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+  gl_state->BindTexture(0);
 }
 
 void GPUPixelFramebuffer::GenerateFramebuffer() {
+  GLStateCache* gl_state = context_->GetGlStateCache();
   GL_CALL(glGenFramebuffers(1, &framebuffer_));
-  GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_));
+  gl_state->BindFramebuffer(framebuffer_);
   GenerateTexture();
-  GL_CALL(glBindTexture(GL_TEXTURE_2D, texture_));
+  gl_state->BindTexture(texture_);
   GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, texture_attributes_.internalFormat,
                        width_, height_, 0, texture_attributes_.format,
                        texture_attributes_.type, 0));
   GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
                                  GL_TEXTURE_2D, texture_, 0));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
-  GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+  gl_state->BindTexture(0);
+  gl_state->BindFramebuffer(0);
 }
 
 }  // namespace gpupixel
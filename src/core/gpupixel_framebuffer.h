@@ -12,6 +12,8 @@
 #include <vector>
 
 namespace gpupixel {
+class GPUPixelContext;
+
 typedef struct GPUPIXEL_API {
   GLenum minFilter;
   GLenum magFilter;
@@ -45,7 +47,22 @@ class GPUPIXEL_API GPUPixelFramebuffer {
   void Activate();
   void Deactivate();
 
+  // Changes whenever the contents may have changed: on every Activate, and
+  // on MarkModified for writes that bypass the framebuffer, such as texture
+  // uploads. Unique across framebuffers, so a recycled one never repeats a
+  // version it had before.
+  uint64_t GetContentVersion() const { return content_version_; }
+  void MarkModified();
+
+  // Forgets the GL objects, once their context is gone, so that deleting
+  // the framebuffer does not touch the context
+  void Abandon();
+
   static TextureAttributes default_texture_attributes;
+  // 32-bit float channels, sampled with nearest filtering, for intermediate
+  // results that do not fit in 8 bits. Check
+  // GPUPixelContext::SupportsFloatFramebuffers before rendering to them.
+  static TextureAttributes float_texture_attributes;
 
  private:
   int width_;
@@ -54,6 +71,8 @@ class GPUPIXEL_API GPUPixelFramebuffer {
   bool has_framebuffer_;
   uint32_t texture_;
   uint32_t framebuffer_;
+  uint64_t content_version_;
+  GPUPixelContext* context_;
 
   void GenerateTexture();
   void GenerateFramebuffer();
@@ -6,11 +6,120 @@
  */
 
 #include "core/gpupixel_framebuffer_factory.h"
-#include "utils/util.h"
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace gpupixel {
 
-FramebufferFactory::FramebufferFactory() {}
+namespace {
+const size_t kDefaultBudget = 128 * 1024 * 1024;
+
+size_t GetFramebufferBytes(const FramebufferKey& key) {
+  size_t channels = 4;
+  switch (key.texture_attributes.format) {
+    case GL_RGB:
+      channels = 3;
+      break;
+    case GL_LUMINANCE:
+    case GL_ALPHA:
+      channels = 1;
+      break;
+  }
+  size_t channel_bytes = key.texture_attributes.type == GL_FLOAT ? 4 : 1;
+  return (size_t)key.width * key.height * channels * channel_bytes;
+}
+}  // namespace
+
+bool FramebufferKey::operator==(const FramebufferKey& other) const {
+  const TextureAttributes& a = texture_attributes;
+  const TextureAttributes& b = other.texture_attributes;
+  return width == other.width && height == other.height &&
+         only_texture == other.only_texture && a.minFilter == b.minFilter &&
+         a.magFilter == b.magFilter && a.wrapS == b.wrapS &&
+         a.wrapT == b.wrapT && a.internalFormat == b.internalFormat &&
+         a.format == b.format && a.type == b.type;
+}
+
+size_t FramebufferKeyHash::operator()(const FramebufferKey& key) const {
+  const TextureAttributes& a = key.texture_attributes;
+  size_t hash = std::hash<int>()(key.width);
+  for (size_t value :
+       {(size_t)key.height, (size_t)key.only_texture, (size_t)a.minFilter,
+        (size_t)a.magFilter, (size_t)a.wrapS, (size_t)a.wrapT,
+        (size_t)a.internalFormat, (size_t)a.format, (size_t)a.type}) {
+    hash = hash * 31 + value;
+  }
+  return hash;
+}
+
+struct FramebufferFactory::Pool {
+  struct IdleFramebuffer {
+    FramebufferKey key;
+    GPUPixelFramebuffer* framebuffer;
+    size_t bytes;
+  };
+  typedef std::list<IdleFramebuffer>::iterator IdleIterator;
+
+  // Front is the most recently returned
+  std::list<IdleFramebuffer> lru;
+  std::unordered_multimap<FramebufferKey, IdleIterator, FramebufferKeyHash>
+      idle;
+  std::mutex mutex;
+  size_t budget = kDefaultBudget;
+  size_t cached_bytes = 0;
+  size_t live_bytes = 0;
+  size_t peak_live_bytes = 0;
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+
+  void Remove(IdleIterator entry) {
+    auto range = idle.equal_range(entry->key);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == entry) {
+        idle.erase(it);
+        break;
+      }
+    }
+    cached_bytes -= entry->bytes;
+    lru.erase(entry);
+  }
+
+  // Takes idle framebuffers off the pool until it fits the budget. They are
+  // deleted by the caller once the mutex is released, since deleting blocks
+  // on the context thread
+  void Trim(std::vector<GPUPixelFramebuffer*>& evicted) {
+    while (cached_bytes > budget && !lru.empty()) {
+      IdleIterator oldest = std::prev(lru.end());
+      evicted.push_back(oldest->framebuffer);
+      Remove(oldest);
+      evictions++;
+    }
+  }
+
+  void Return(const FramebufferKey& key, GPUPixelFramebuffer* framebuffer) {
+    std::vector<GPUPixelFramebuffer*> evicted;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      size_t bytes = GetFramebufferBytes(key);
+      live_bytes -= bytes;
+      lru.push_front({key, framebuffer, bytes});
+      idle.emplace(key, lru.begin());
+      cached_bytes += bytes;
+      Trim(evicted);
+    }
+    for (auto evicted_framebuffer : evicted) {
+      delete evicted_framebuffer;
+    }
+  }
+};
+
+FramebufferFactory::FramebufferFactory() : pool_(std::make_shared<Pool>()) {}
 
 FramebufferFactory::~FramebufferFactory() {
   Clean();
@@ -21,74 +130,83 @@ std::shared_ptr<GPUPixelFramebuffer> FramebufferFactory::CreateFramebuffer(
     int height,
     bool only_texture /* = false*/,
     const TextureAttributes texture_attributes /* = defaultTextureAttribure*/) {
-  std::shared_ptr<GPUPixelFramebuffer> framebuffer_from_cache;
-  std::string lookup_hash =
-      GenerateUuid(width, height, only_texture, texture_attributes);
-  int number_of_matching_framebuffers = 0;
-  if (framebuffer_type_counts_.find(lookup_hash) !=
-      framebuffer_type_counts_.end()) {
-    number_of_matching_framebuffers = framebuffer_type_counts_[lookup_hash];
-  }
-  if (number_of_matching_framebuffers < 1) {
-    framebuffer_from_cache =
-        std::shared_ptr<GPUPixelFramebuffer>(new GPUPixelFramebuffer(
-            width, height, only_texture, texture_attributes));
-  } else {
-    int cur_framebuffer_id = number_of_matching_framebuffers - 1;
-    while (!framebuffer_from_cache && cur_framebuffer_id >= 0) {
-      std::string framebuffer_hash =
-          Util::StringFormat("%s-%ld", lookup_hash.c_str(), cur_framebuffer_id);
-      if (framebuffers_.find(framebuffer_hash) != framebuffers_.end()) {
-        framebuffer_from_cache = framebuffers_[framebuffer_hash];
-        framebuffers_.erase(framebuffer_hash);
-      } else {
-        framebuffer_from_cache = 0;
-      }
-      cur_framebuffer_id--;
+  FramebufferKey key = {width, height, only_texture, texture_attributes};
+  GPUPixelFramebuffer* framebuffer = nullptr;
+  {
+    std::unique_lock<std::mutex> lock(pool_->mutex);
+    auto it = pool_->idle.find(key);
+    if (it != pool_->idle.end()) {
+      framebuffer = it->second->framebuffer;
+      pool_->Remove(it->second);
+      pool_->hits++;
+    } else {
+      pool_->misses++;
     }
-    cur_framebuffer_id++;
-    framebuffer_type_counts_[lookup_hash] = cur_framebuffer_id;
+    pool_->live_bytes += GetFramebufferBytes(key);
+    pool_->peak_live_bytes =
+        std::max(pool_->peak_live_bytes, pool_->live_bytes);
+  }
 
-    if (!framebuffer_from_cache) {
-      framebuffer_from_cache =
-          std::shared_ptr<GPUPixelFramebuffer>(new GPUPixelFramebuffer(
-              width, height, only_texture, texture_attributes));
-    }
+  if (!framebuffer) {
+    framebuffer = new GPUPixelFramebuffer(width, height, only_texture,
+                                          texture_attributes);
   }
 
-  return framebuffer_from_cache;
+  // The pool may be gone by the time the last reference drops, and with it
+  // the context, whose GL objects went along
+  std::weak_ptr<Pool> weak_pool = pool_;
+  return std::shared_ptr<GPUPixelFramebuffer>(
+      framebuffer, [weak_pool, key](GPUPixelFramebuffer* returned) {
+        std::shared_ptr<Pool> pool = weak_pool.lock();
+        if (pool) {
+          pool->Return(key, returned);
+        } else {
+          returned->Abandon();
+          delete returned;
+        }
+      });
 }
 
-std::string FramebufferFactory::GenerateUuid(
-    int width,
-    int height,
-    bool only_texture,
-    const TextureAttributes texture_attributes) const {
-  if (only_texture) {
-    return Util::StringFormat(
-        "%.1dx%.1d-%d:%d:%d:%d:%d:%d:%d-NOFB", width, height,
-        texture_attributes.minFilter, texture_attributes.magFilter,
-        texture_attributes.wrapS, texture_attributes.wrapT,
-        texture_attributes.internalFormat, texture_attributes.format,
-        texture_attributes.type);
-  } else {
-    return Util::StringFormat(
-        "%.1dx%.1d-%d:%d:%d:%d:%d:%d:%d", width, height,
-        texture_attributes.minFilter, texture_attributes.magFilter,
-        texture_attributes.wrapS, texture_attributes.wrapT,
-        texture_attributes.internalFormat, texture_attributes.format,
-        texture_attributes.type);
+void FramebufferFactory::SetBudget(size_t bytes) {
+  std::vector<GPUPixelFramebuffer*> evicted;
+  {
+    std::unique_lock<std::mutex> lock(pool_->mutex);
+    pool_->budget = bytes;
+    pool_->Trim(evicted);
+  }
+  for (auto framebuffer : evicted) {
+    delete framebuffer;
   }
 }
 
-std::shared_ptr<GPUPixelFramebuffer> FramebufferFactory::GetFramebufferByUuid(
-    const std::string& hash) {
-  return framebuffers_[hash];
+GPUPIXEL_FRAMEBUFFER_CACHE_STATS FramebufferFactory::GetStats() const {
+  std::unique_lock<std::mutex> lock(pool_->mutex);
+  GPUPIXEL_FRAMEBUFFER_CACHE_STATS stats;
+  stats.hits = pool_->hits;
+  stats.misses = pool_->misses;
+  stats.evictions = pool_->evictions;
+  stats.cached_count = pool_->lru.size();
+  stats.cached_bytes = pool_->cached_bytes;
+  stats.budget_bytes = pool_->budget;
+  stats.live_bytes = pool_->live_bytes;
+  stats.peak_live_bytes = pool_->peak_live_bytes;
+  return stats;
 }
 
 void FramebufferFactory::Clean() {
-  framebuffers_.clear();
-  framebuffer_type_counts_.clear();
+  std::vector<GPUPixelFramebuffer*> idle_framebuffers;
+  {
+    std::unique_lock<std::mutex> lock(pool_->mutex);
+    for (auto& entry : pool_->lru) {
+      idle_framebuffers.push_back(entry.framebuffer);
+    }
+    pool_->lru.clear();
+    pool_->idle.clear();
+    pool_->cached_bytes = 0;
+  }
+  for (auto framebuffer : idle_framebuffers) {
+    delete framebuffer;
+  }
 }
 
 }  // namespace gpupixel
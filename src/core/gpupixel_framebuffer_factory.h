@@ -7,12 +7,29 @@
 
 #pragma once
 
-#include <map>
-#include <string>
+#include <memory>
 #include "core/gpupixel_framebuffer.h"
 #include "gpupixel/gpupixel_define.h"
 
 namespace gpupixel {
+
+struct FramebufferKey {
+  int width;
+  int height;
+  bool only_texture;
+  TextureAttributes texture_attributes;
+
+  bool operator==(const FramebufferKey& other) const;
+};
+
+struct FramebufferKeyHash {
+  size_t operator()(const FramebufferKey& key) const;
+};
+
+// Pool of framebuffers. A framebuffer returns to the pool when the last
+// shared_ptr to it is dropped, on any thread, and is handed out again for
+// the same size and attributes. Idle framebuffers beyond the byte budget
+// are deleted, least recently returned first.
 class GPUPIXEL_API FramebufferFactory {
  public:
   FramebufferFactory();
@@ -24,18 +41,16 @@ class GPUPIXEL_API FramebufferFactory {
       const TextureAttributes texture_attributes =
           GPUPixelFramebuffer::default_texture_attributes);
 
+  // Bytes of idle framebuffers kept for reuse, 0 disables reuse
+  void SetBudget(size_t bytes);
+  GPUPIXEL_FRAMEBUFFER_CACHE_STATS GetStats() const;
+
+  // Deletes all idle framebuffers
   void Clean();
 
  private:
-  std::string GenerateUuid(int width,
-                           int height,
-                           bool only_texture,
-                           const TextureAttributes texture_attributes) const;
-  std::shared_ptr<GPUPixelFramebuffer> GetFramebufferByUuid(
-      const std::string& hash);
-
-  std::map<std::string, std::shared_ptr<GPUPixelFramebuffer>> framebuffers_;
-  std::map<std::string, int> framebuffer_type_counts_;
+  struct Pool;
+  std::shared_ptr<Pool> pool_;
 };
 
 }  // namespace gpupixel
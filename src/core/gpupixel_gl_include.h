@@ -24,6 +24,14 @@
 #include <GLES3/gl3ext.h>
 #include <android/log.h>
 #include <jni.h>
+#elif defined(GPUPIXEL_LINUX_EGL)
+// clang-format off
+#include <glad/glad.h>
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+// clang-format on
 #elif defined(GPUPIXEL_WIN) || defined(GPUPIXEL_LINUX)
 // clang-format off
 #include <glad/glad.h>
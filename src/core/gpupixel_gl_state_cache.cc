@@ -0,0 +1,154 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+#include "core/gpupixel_gl_state_cache.h"
+
+namespace gpupixel {
+
+namespace {
+// Never returned by glGen*, so the first call after Invalidate always goes
+// through
+const GLuint kUnknownName = 0xFFFFFFFF;
+const GLenum kUnknownUnit = 0;
+}  // namespace
+
+GLStateCache::GLStateCache() : issued_count_(0), skipped_count_(0) {
+  Invalidate();
+}
+
+void GLStateCache::Invalidate() {
+  program_ = kUnknownName;
+  framebuffer_ = kUnknownName;
+  viewport_valid_ = false;
+  clear_color_valid_ = false;
+  enabled_vertex_attribs_ = 0;
+  active_texture_ = kUnknownUnit;
+  for (int i = 0; i < kMaxTextureUnits; i++) {
+    textures_[i] = kUnknownName;
+  }
+}
+
+void GLStateCache::ResetCounters() {
+  issued_count_ = 0;
+  skipped_count_ = 0;
+}
+
+bool GLStateCache::Changed(bool changed) {
+  if (changed) {
+    issued_count_++;
+  } else {
+    skipped_count_++;
+  }
+  return changed;
+}
+
+void GLStateCache::UseProgram(GLuint program) {
+  if (Changed(program_ != program)) {
+    program_ = program;
+    GL_CALL(glUseProgram(program));
+  }
+}
+
+void GLStateCache::BindFramebuffer(GLuint framebuffer) {
+  if (Changed(framebuffer_ != framebuffer)) {
+    framebuffer_ = framebuffer;
+    GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+  }
+}
+
+void GLStateCache::Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  if (Changed(!viewport_valid_ || viewport_[0] != x || viewport_[1] != y ||
+              viewport_[2] != width || viewport_[3] != height)) {
+    viewport_valid_ = true;
+    viewport_[0] = x;
+    viewport_[1] = y;
+    viewport_[2] = width;
+    viewport_[3] = height;
+    GL_CALL(glViewport(x, y, width, height));
+  }
+}
+
+void GLStateCache::ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {
+  if (Changed(!clear_color_valid_ || clear_color_[0] != r ||
+              clear_color_[1] != g || clear_color_[2] != b ||
+              clear_color_[3] != a)) {
+    clear_color_valid_ = true;
+    clear_color_[0] = r;
+    clear_color_[1] = g;
+    clear_color_[2] = b;
+    clear_color_[3] = a;
+    GL_CALL(glClearColor(r, g, b, a));
+  }
+}
+
+void GLStateCache::EnableVertexAttribArray(GLuint index) {
+  if (index >= kMaxVertexAttribs) {
+    // includes the -1 location of attributes the shader optimized away
+    Changed(true);
+    GL_CALL(glEnableVertexAttribArray(index));
+    return;
+  }
+  uint32_t bit = 1u << index;
+  if (Changed(!(enabled_vertex_attribs_ & bit))) {
+    enabled_vertex_attribs_ |= bit;
+    GL_CALL(glEnableVertexAttribArray(index));
+  }
+}
+
+void GLStateCache::ActiveTexture(GLenum unit) {
+  if (Changed(active_texture_ != unit)) {
+    active_texture_ = unit;
+    GL_CALL(glActiveTexture(unit));
+  }
+}
+
+void GLStateCache::BindTexture(GLuint texture) {
+  int index = (int)active_texture_ - GL_TEXTURE0;
+  if (active_texture_ == kUnknownUnit || index >= kMaxTextureUnits) {
+    Changed(true);
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, texture));
+    return;
+  }
+  if (Changed(textures_[index] != texture)) {
+    textures_[index] = texture;
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, texture));
+  }
+}
+
+void GLStateCache::BindTexture(GLenum unit, GLuint texture) {
+  int index = (int)unit - GL_TEXTURE0;
+  if (index >= 0 && index < kMaxTextureUnits && textures_[index] == texture) {
+    Changed(false);
+    return;
+  }
+  ActiveTexture(unit);
+  BindTexture(texture);
+}
+
+void GLStateCache::OnTextureDeleted(GLuint texture) {
+  for (int i = 0; i < kMaxTextureUnits; i++) {
+    if (textures_[i] == texture) {
+      textures_[i] = 0;
+    }
+  }
+}
+
+void GLStateCache::OnFramebufferDeleted(GLuint framebuffer) {
+  if (framebuffer_ == framebuffer) {
+    framebuffer_ = 0;
+  }
+}
+
+void GLStateCache::OnProgramDeleted(GLuint program) {
+  // a deleted program stays in use until another one is installed, but its
+  // name may be reused afterwards
+  if (program_ == program) {
+    program_ = kUnknownName;
+  }
+}
+
+}  // namespace gpupixel
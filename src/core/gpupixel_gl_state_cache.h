@@ -0,0 +1,69 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "core/gpupixel_gl_include.h"
+
+namespace gpupixel {
+
+// Shadow copy of the GL state that the render passes touch. Every call is
+// forwarded to GL only when it changes the cached value. Owned by a
+// GPUPixelContext and only used on its thread.
+class GPUPIXEL_API GLStateCache {
+ public:
+  GLStateCache();
+
+  void UseProgram(GLuint program);
+  void BindFramebuffer(GLuint framebuffer);
+  void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+  void ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+  void EnableVertexAttribArray(GLuint index);
+
+  // unit is GL_TEXTURE0 + n, as for glActiveTexture
+  void ActiveTexture(GLenum unit);
+  // Binds texture to GL_TEXTURE_2D of the active unit
+  void BindTexture(GLuint texture);
+  // Binds texture to GL_TEXTURE_2D of unit, switching the active unit only
+  // when the binding changes
+  void BindTexture(GLenum unit, GLuint texture);
+
+  // Must be called when an object is deleted, since GL resets the bindings
+  // of deleted objects and may hand their names out again
+  void OnTextureDeleted(GLuint texture);
+  void OnFramebufferDeleted(GLuint framebuffer);
+  void OnProgramDeleted(GLuint program);
+
+  // Forgets everything, for when GL state was changed behind the cache
+  void Invalidate();
+
+  uint64_t GetIssuedCount() const { return issued_count_; }
+  uint64_t GetSkippedCount() const { return skipped_count_; }
+  void ResetCounters();
+
+ private:
+  static const int kMaxTextureUnits = 32;
+  static const int kMaxVertexAttribs = 32;
+
+  bool Changed(bool changed);
+
+  GLuint program_;
+  GLuint framebuffer_;
+  bool viewport_valid_;
+  GLint viewport_[4];
+  bool clear_color_valid_;
+  GLfloat clear_color_[4];
+  uint32_t enabled_vertex_attribs_;
+  GLenum active_texture_;
+  GLuint textures_[kMaxTextureUnits];
+
+  uint64_t issued_count_;
+  uint64_t skipped_count_;
+};
+
+}  // namespace gpupixel
@@ -0,0 +1,164 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+#include "core/gpupixel_lookup_texture_cache.h"
+#include <chrono>
+#include <future>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "core/gpupixel_context.h"
+#include "core/gpupixel_framebuffer.h"
+#include "stb/stb_image.h"
+#include "utils/dispatch_queue.h"
+#include "utils/logging.h"
+
+namespace gpupixel {
+
+namespace {
+
+struct LookupImage {
+  int width;
+  int height;
+  std::vector<unsigned char> pixels;
+};
+
+using LookupImageFuture = std::shared_future<std::shared_ptr<LookupImage>>;
+
+struct Entry {
+  // Invalid once the decoded image has been used, so the pixels are freed
+  LookupImageFuture image;
+  std::map<GPUPixelContext*, std::weak_ptr<GPUPixelFramebuffer>> textures;
+};
+
+std::mutex entries_mutex;
+std::map<std::string, Entry> entries;
+
+// Null when path cannot be decoded
+std::shared_ptr<LookupImage> DecodeLookupImage(const std::string& path) {
+  int width, height, channel_count;
+  unsigned char* data =
+      stbi_load(path.c_str(), &width, &height, &channel_count, 4);
+  if (data == nullptr) {
+    LOG_ERROR("LookupTextureCache: failed to decode {}", path);
+    return nullptr;
+  }
+  auto image = std::make_shared<LookupImage>();
+  image->width = width;
+  image->height = height;
+  image->pixels.assign(data, data + width * height * 4);
+  stbi_image_free(data);
+  return image;
+}
+
+LookupImageFuture StartDecoding(const std::string& path) {
+#if defined(GPUPIXEL_WASM)
+  std::promise<std::shared_ptr<LookupImage>> decoded;
+  decoded.set_value(DecodeLookupImage(path));
+  return decoded.get_future().share();
+#else
+  // One thread for the whole process, tables are decoded in request order.
+  // Joined at exit once the pending decodes have run.
+  static DispatchQueue decode_queue;
+  return decode_queue.submitTask([path] { return DecodeLookupImage(path); })
+      .share();
+#endif
+}
+
+// Drops the textures whose last user is gone, and the entries left with
+// neither textures nor a decoding. Needs entries_mutex.
+void PruneEntries() {
+  for (auto entry = entries.begin(); entry != entries.end();) {
+    auto& textures = entry->second.textures;
+    for (auto it = textures.begin(); it != textures.end();) {
+      it = it->second.expired() ? textures.erase(it) : std::next(it);
+    }
+    if (textures.empty() && !entry->second.image.valid()) {
+      entry = entries.erase(entry);
+    } else {
+      ++entry;
+    }
+  }
+}
+
+// Entry of path with the decoding started, unless it is uploaded to
+// context. Needs entries_mutex.
+Entry& GetEntry(const std::string& path, GPUPixelContext* context) {
+  PruneEntries();
+  Entry& entry = entries[path];
+  auto it = entry.textures.find(context);
+  if (it == entry.textures.end() && !entry.image.valid()) {
+    entry.image = StartDecoding(path);
+  }
+  return entry;
+}
+
+}  // namespace
+
+void LookupTextureCache::Prefetch(const std::string& path) {
+  std::unique_lock<std::mutex> lock(entries_mutex);
+  GetEntry(path, GPUPixelContext::GetInstance());
+}
+
+bool LookupTextureCache::Acquire(
+    const std::string& path,
+    bool wait,
+    std::shared_ptr<GPUPixelFramebuffer>& texture) {
+  GPUPixelContext* context = GPUPixelContext::GetInstance();
+  LookupImageFuture image;
+  {
+    std::unique_lock<std::mutex> lock(entries_mutex);
+    Entry& entry = GetEntry(path, context);
+    auto it = entry.textures.find(context);
+    if (it != entry.textures.end()) {
+      texture = it->second.lock();
+      return true;
+    }
+    image = entry.image;
+  }
+
+  if (!wait &&
+      image.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    return false;
+  }
+  std::shared_ptr<LookupImage> decoded = image.get();
+  texture.reset();
+  if (decoded) {
+    texture = std::make_shared<GPUPixelFramebuffer>(decoded->width,
+                                                    decoded->height, true);
+    GLStateCache* gl_state = context->GetGlStateCache();
+    gl_state->BindTexture(texture->GetTexture());
+    GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, decoded->width,
+                         decoded->height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                         decoded->pixels.data()));
+    gl_state->BindTexture(0);
+    texture->MarkModified();
+  }
+
+  std::unique_lock<std::mutex> lock(entries_mutex);
+  Entry& entry = entries[path];
+  if (texture) {
+    entry.textures[context] = texture;
+  }
+  // Frees the pixels, or lets a failed path be decoded again
+  if (entry.image.valid() && entry.image.wait_for(std::chrono::seconds(0)) ==
+                                 std::future_status::ready) {
+    entry.image = LookupImageFuture();
+  }
+  return true;
+}
+
+void LookupTextureCache::ReleaseContext(GPUPixelContext* context) {
+  std::unique_lock<std::mutex> lock(entries_mutex);
+  for (auto& entry : entries) {
+    entry.second.textures.erase(context);
+  }
+  PruneEntries();
+}
+
+}  // namespace gpupixel
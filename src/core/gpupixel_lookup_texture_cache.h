@@ -0,0 +1,41 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include "gpupixel/gpupixel_define.h"
+
+namespace gpupixel {
+class GPUPixelContext;
+class GPUPixelFramebuffer;
+
+// Lookup table images shared by all the filters of the process that use
+// them, keyed by path. An image is decoded once on a background thread and
+// uploaded once per context; the texture is deleted with its last user, and
+// its entry with the context. Thread-safe.
+class GPUPIXEL_API LookupTextureCache {
+ public:
+  // Starts decoding path in the background, so that acquiring it later does
+  // not wait. Does nothing when path is decoded or uploaded already.
+  static void Prefetch(const std::string& path);
+
+  // Gets the texture of path in the calling thread's context, uploading it
+  // there the first time. Returns false while path is still decoding, unless
+  // wait is set. Otherwise texture is the table, or null when path could not
+  // be decoded. Call on the context's thread.
+  static bool Acquire(const std::string& path,
+                      bool wait,
+                      std::shared_ptr<GPUPixelFramebuffer>& texture);
+
+  // Forgets the textures of context, called as it is destroyed, so that a
+  // later context at the same address does not find them
+  static void ReleaseContext(GPUPixelContext* context);
+};
+
+}  // namespace gpupixel
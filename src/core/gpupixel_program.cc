@@ -7,40 +7,48 @@
 
 #include "core/gpupixel_program.h"
 #include <algorithm>
+#include <functional>
+#include <iterator>
 #include "core/gpupixel_context.h"
+#include "core/gpupixel_program_cache.h"
 #include "utils/util.h"
 
 namespace gpupixel {
 
-std::vector<GPUPixelGLProgram*> GPUPixelGLProgram::programs_;
+std::unordered_multimap<uint64_t,
+                        std::weak_ptr<GPUPixelGLProgram::SharedProgram>>
+    GPUPixelGLProgram::shared_programs_;
+std::mutex GPUPixelGLProgram::programs_mutex_;
 
-GPUPixelGLProgram::GPUPixelGLProgram() : program_(-1) {
-  programs_.push_back(this);
-}
+GPUPixelGLProgram::GPUPixelGLProgram()
+    : program_(-1),
+      context_(GPUPixelContext::GetInstance()),
+      uniform_version_(0) {}
 
 GPUPixelGLProgram::~GPUPixelGLProgram() {
-  GPUPixelContext::GetInstance()->SyncRunWithContext([=] {
-    std::vector<GPUPixelGLProgram*>::iterator itr =
-        std::find(programs_.begin(), programs_.end(), this);
-    if (itr != programs_.end()) {
-      programs_.erase(itr);
+  context_->SyncRunWithContext([=] {
+    std::unique_lock<std::mutex> lock(programs_mutex_);
+    if (!shared_) {
+      return;
     }
-
-    bool should_delete_program = (program_ != -1);
-
-    for (auto const& program : programs_) {
-      if (should_delete_program) {
-        if (program_ == program->GetProgram()) {
-          should_delete_program = false;
-          break;
-        }
-      }
+    if (shared_->uniform_owner == this) {
+      shared_->uniform_owner = nullptr;
     }
-
-    if (should_delete_program) {
-      glDeleteProgram(program_);
-      program_ = -1;
+    // References are only taken under programs_mutex_, so this is the last
+    if (shared_.use_count() == 1) {
+      auto range = shared_programs_.equal_range(shared_->key);
+      for (auto it = range.first; it != range.second;) {
+        it = it->second.lock() == shared_ || it->second.expired()
+                 ? shared_programs_.erase(it)
+                 : std::next(it);
+      }
+      if (shared_->program != (uint32_t)-1) {
+        context_->GetGlStateCache()->OnProgramDeleted(shared_->program);
+        glDeleteProgram(shared_->program);
+      }
     }
+    shared_.reset();
+    program_ = -1;
   });
 }
 
@@ -61,12 +69,54 @@ GPUPixelGLProgram* GPUPixelGLProgram::CreateWithShaderString(
 bool GPUPixelGLProgram::InitWithShaderString(
     const std::string& vertex_shader_source,
     const std::string& fragment_shader_source) {
-  if (program_ != -1) {
-    GL_CALL(glDeleteProgram(program_));
-    program_ = -1;
+  uint64_t key = std::hash<std::string>()(vertex_shader_source) * 31 +
+                 std::hash<std::string>()(fragment_shader_source);
+
+  std::unique_lock<std::mutex> lock(programs_mutex_);
+  auto range = shared_programs_.equal_range(key);
+  for (auto it = range.first; it != range.second; ++it) {
+    std::shared_ptr<SharedProgram> shared = it->second.lock();
+    if (shared && shared->context == context_ &&
+        shared->vertex_shader_source == vertex_shader_source &&
+        shared->fragment_shader_source == fragment_shader_source) {
+      shared_ = shared;
+      program_ = shared_->program;
+      return true;
+    }
   }
+
+  lock.unlock();
+
+  // Programs are created on their context's thread, so no other instance
+  // can register the same sources for this context meanwhile
+  shared_ = std::make_shared<SharedProgram>();
+  shared_->context = context_;
+  shared_->key = key;
+  shared_->vertex_shader_source = vertex_shader_source;
+  shared_->fragment_shader_source = fragment_shader_source;
+  shared_->uniform_owner = nullptr;
+  if (!Link(vertex_shader_source, fragment_shader_source)) {
+    // Not shared, so the next instance with these sources compiles again
+    shared_.reset();
+    return false;
+  }
+  shared_->program = program_;
+  ReflectLocations();
+
+  lock.lock();
+  shared_programs_.emplace(key, shared_);
+  return true;
+}
+
+bool GPUPixelGLProgram::Link(const std::string& vertex_shader_source,
+                             const std::string& fragment_shader_source) {
   GL_CALL(program_ = glCreateProgram());
 
+  if (ProgramBinaryCache::Load(program_, vertex_shader_source,
+                               fragment_shader_source)) {
+    return true;
+  }
+
   uint32_t vert_shader;
   GL_CALL(vert_shader = glCreateShader(GL_VERTEX_SHADER));
   const char* vertex_shader_source_str = vertex_shader_source.c_str();
@@ -88,7 +138,9 @@ bool GPUPixelGLProgram::InitWithShaderString(
     LOG_ERROR(
         "GL ERROR GPUPixelGLProgram::InitWithShaderString vertex shader {}",
         messages);
-    return -1;
+    GL_CALL(glDeleteShader(vert_shader));
+    DeleteProgram();
+    return false;
   }
 
   uint32_t frag_shader;
@@ -109,31 +161,199 @@ bool GPUPixelGLProgram::InitWithShaderString(
 #endif
     LOG_ERROR("GL ERROR GPUPixelGLProgram::InitWithShaderString frag shader {}",
               messages);
-    return -1;
+    GL_CALL(glDeleteShader(vert_shader));
+    GL_CALL(glDeleteShader(frag_shader));
+    DeleteProgram();
+    return false;
   }
 
   GL_CALL(glAttachShader(program_, vert_shader));
   GL_CALL(glAttachShader(program_, frag_shader));
 
+  ProgramBinaryCache::PrepareForLink(program_);
   GL_CALL(glLinkProgram(program_));
 
   GL_CALL(glDeleteShader(vert_shader));
   GL_CALL(glDeleteShader(frag_shader));
 
+  GLint link_success;
+  GL_CALL(glGetProgramiv(program_, GL_LINK_STATUS, &link_success));
+  if (link_success == GL_FALSE) {
+    GLchar messages[256];
+    glGetProgramInfoLog(program_, sizeof(messages), 0, &messages[0]);
+    LOG_ERROR("GL ERROR GPUPixelGLProgram::InitWithShaderString link {}",
+              messages);
+    DeleteProgram();
+    return false;
+  }
+
+  ProgramBinaryCache::Store(program_, vertex_shader_source,
+                            fragment_shader_source);
   return true;
 }
 
+void GPUPixelGLProgram::DeleteProgram() {
+  context_->GetGlStateCache()->OnProgramDeleted(program_);
+  GL_CALL(glDeleteProgram(program_));
+  program_ = -1;
+}
+
+void GPUPixelGLProgram::ReflectLocations() {
+  GLint count = 0;
+  GLint max_length = 0;
+  GLint size = 0;
+  GLenum type = 0;
+
+  GL_CALL(glGetProgramiv(program_, GL_ACTIVE_UNIFORMS, &count));
+  GL_CALL(glGetProgramiv(program_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length));
+  std::vector<GLchar> name(std::max(max_length, 1));
+  for (GLint i = 0; i < count; ++i) {
+    GL_CALL(glGetActiveUniform(program_, i, name.size(), nullptr, &size,
+                               &type, name.data()));
+    std::string uniform_name(name.data());
+    uint32_t location;
+    GL_CALL(location = glGetUniformLocation(program_, uniform_name.c_str()));
+    shared_->uniform_locations[uniform_name] = location;
+    // Arrays are reported as "name[0]" but usually set by their base name
+    size_t bracket = uniform_name.find('[');
+    if (bracket != std::string::npos) {
+      shared_->uniform_locations[uniform_name.substr(0, bracket)] = location;
+    }
+  }
+
+  GL_CALL(glGetProgramiv(program_, GL_ACTIVE_ATTRIBUTES, &count));
+  GL_CALL(
+      glGetProgramiv(program_, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_length));
+  name.resize(std::max(max_length, 1));
+  for (GLint i = 0; i < count; ++i) {
+    GL_CALL(glGetActiveAttrib(program_, i, name.size(), nullptr, &size, &type,
+                              name.data()));
+    uint32_t location;
+    GL_CALL(location = glGetAttribLocation(program_, name.data()));
+    shared_->attrib_locations[name.data()] = location;
+  }
+}
+
+void GPUPixelGLProgram::ResolveInputLocations(int index) {
+  for (int i = shared_->input_texture_uniforms.size(); i <= index; ++i) {
+    shared_->input_texture_uniforms.push_back(GetUniformLocation(
+        i == 0 ? "inputImageTexture"
+               : Util::StringFormat("inputImageTexture%d", i)));
+    shared_->input_tex_coord_attributes.push_back(GetAttribLocation(
+        i == 0 ? "inputTextureCoordinate"
+               : Util::StringFormat("inputTextureCoordinate%d", i)));
+  }
+}
+
 void GPUPixelGLProgram::UseProgram() {
-  GL_CALL(glUseProgram(program_));
+  context_->GetGlStateCache()->UseProgram(program_);
+  if (shared_ && shared_->uniform_owner != this) {
+    RestoreUniforms();
+  }
+}
+
+void GPUPixelGLProgram::StoreUniform(int uniform_location,
+                                     UniformValue::Type type,
+                                     const float* values,
+                                     int count,
+                                     int int_value /* = 0*/) {
+  if (uniform_location == -1) {
+    return;
+  }
+  auto it = uniform_values_.find(uniform_location);
+  if (it != uniform_values_.end() && it->second.type == type &&
+      it->second.int_value == int_value &&
+      std::equal(it->second.float_values.begin(),
+                 it->second.float_values.end(), values,
+                 values + count)) {
+    return;
+  }
+  UniformValue& uniform = uniform_values_[uniform_location];
+  uniform.type = type;
+  uniform.int_value = int_value;
+  uniform.float_values.assign(values, values + count);
+  uniform_version_++;
+
+  // Kept zeroed for the instances that never set it
+  UniformValue& written = shared_->written_uniforms[uniform_location];
+  written.type = type;
+  written.int_value = 0;
+  written.float_values.assign(count, 0.0f);
+}
+
+void GPUPixelGLProgram::RestoreUniforms() {
+  // Must run with the program in use, uniforms are program state
+  shared_->uniform_owner = this;
+  // Uniforms set by other instances only go back to their initial zero,
+  // so every instance sees the program as if it were its own
+  for (const auto& it : shared_->written_uniforms) {
+    if (uniform_values_.find(it.first) == uniform_values_.end()) {
+      ApplyUniform(it.first, it.second);
+    }
+  }
+  for (const auto& it : uniform_values_) {
+    ApplyUniform(it.first, it.second);
+  }
+}
+
+void GPUPixelGLProgram::ApplyUniform(int location,
+                                     const UniformValue& uniform) {
+  const float* values = uniform.float_values.data();
+  switch (uniform.type) {
+    case UniformValue::kInt:
+      GL_CALL(glUniform1i(location, uniform.int_value));
+      break;
+    case UniformValue::kFloat:
+      GL_CALL(glUniform1f(location, values[0]));
+      break;
+    case UniformValue::kVector2:
+      GL_CALL(glUniform2f(location, values[0], values[1]));
+      break;
+    case UniformValue::kMatrix3:
+      GL_CALL(glUniformMatrix3fv(location, 1, GL_FALSE, values));
+      break;
+    case UniformValue::kMatrix4:
+      GL_CALL(glUniformMatrix4fv(location, 1, GL_FALSE, values));
+      break;
+    case UniformValue::kFloatArray:
+      GL_CALL(glUniform1fv(location, uniform.float_values.size(), values));
+      break;
+  }
 }
 
 uint32_t GPUPixelGLProgram::GetAttribLocation(const std::string& attribute) {
-  return glGetAttribLocation(program_, attribute.c_str());
+  auto it = shared_->attrib_locations.find(attribute);
+  if (it != shared_->attrib_locations.end()) {
+    return it->second;
+  }
+  uint32_t location = glGetAttribLocation(program_, attribute.c_str());
+  shared_->attrib_locations[attribute] = location;
+  return location;
 }
 
 uint32_t GPUPixelGLProgram::GetUniformLocation(
     const std::string& uniform_name) {
-  return glGetUniformLocation(program_, uniform_name.c_str());
+  auto it = shared_->uniform_locations.find(uniform_name);
+  if (it != shared_->uniform_locations.end()) {
+    return it->second;
+  }
+  uint32_t location = glGetUniformLocation(program_, uniform_name.c_str());
+  shared_->uniform_locations[uniform_name] = location;
+  return location;
+}
+
+uint32_t GPUPixelGLProgram::GetInputTextureUniform(int index) {
+  if (index >= (int)shared_->input_texture_uniforms.size()) {
+    ResolveInputLocations(index);
+  }
+  return shared_->input_texture_uniforms[index];
+}
+
+uint32_t GPUPixelGLProgram::GetInputTexCoordAttribute(int index) {
+  if (index >= (int)shared_->input_tex_coord_attributes.size()) {
+    ResolveInputLocations(index);
+  }
+  return shared_->input_tex_coord_attributes[index];
 }
 
 void GPUPixelGLProgram::SetUniformValue(const std::string& uniform_name,
@@ -175,26 +395,31 @@ void GPUPixelGLProgram::SetUniformValue(const std::string& uniform_name,
 
 void GPUPixelGLProgram::SetUniformValue(int uniform_location, int value) {
   GPUPixelContext::GetInstance()->SetActiveGlProgram(this);
+  StoreUniform(uniform_location, UniformValue::kInt, nullptr, 0, value);
   GL_CALL(glUniform1i(uniform_location, value));
 }
 
 void GPUPixelGLProgram::SetUniformValue(int uniform_location, float value) {
   GPUPixelContext::GetInstance()->SetActiveGlProgram(this);
+  StoreUniform(uniform_location, UniformValue::kFloat, &value, 1);
   GL_CALL(glUniform1f(uniform_location, value));
 }
 
 void GPUPixelGLProgram::SetUniformValue(int uniform_location, Matrix4 value) {
   GPUPixelContext::GetInstance()->SetActiveGlProgram(this);
+  StoreUniform(uniform_location, UniformValue::kMatrix4, (float*)&value, 16);
   GL_CALL(glUniformMatrix4fv(uniform_location, 1, GL_FALSE, (float*)&value));
 }
 
 void GPUPixelGLProgram::SetUniformValue(int uniform_location, Vector2 value) {
   GPUPixelContext::GetInstance()->SetActiveGlProgram(this);
+  StoreUniform(uniform_location, UniformValue::kVector2, (float*)&value, 2);
   GL_CALL(glUniform2f(uniform_location, value.x, value.y));
 }
 
 void GPUPixelGLProgram::SetUniformValue(int uniform_location, Matrix3 value) {
   GPUPixelContext::GetInstance()->SetActiveGlProgram(this);
+  StoreUniform(uniform_location, UniformValue::kMatrix3, (float*)&value, 9);
   GL_CALL(glUniformMatrix3fv(uniform_location, 1, GL_FALSE, (float*)&value));
 }
 
@@ -202,6 +427,8 @@ void GPUPixelGLProgram::SetUniformValue(int uniform_location,
                                         const void* value,
                                         int length) {
   GPUPixelContext::GetInstance()->SetActiveGlProgram(this);
+  StoreUniform(uniform_location, UniformValue::kFloatArray, (float*)value,
+               length);
   GL_CALL(glUniform1fv(uniform_location, length, (float*)value));
 }
 
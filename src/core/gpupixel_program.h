@@ -7,26 +7,41 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "core/gpupixel_gl_include.h"
 #include "gpupixel/utils/math_toolbox.h"
 
 namespace gpupixel {
+class GPUPixelContext;
+
 class GPUPIXEL_API GPUPixelGLProgram {
  public:
   GPUPixelGLProgram();
   ~GPUPixelGLProgram();
 
+  // Instances created from the same sources on the same context share one GL
+  // program; uniform values stay per instance
   static GPUPixelGLProgram* CreateWithShaderString(
       const std::string& vertex_shader_source,
       const std::string& fragment_shader_source);
   void UseProgram();
   uint32_t GetProgram() const { return program_; }
 
+  // Locations are reflected once at link time and served from a hash table;
+  // names the driver did not report, such as array elements, are queried
+  // once and then cached too
   uint32_t GetAttribLocation(const std::string& attribute);
   uint32_t GetUniformLocation(const std::string& uniform_name);
 
+  // Pre-resolved locations of "inputImageTexture[N]" and
+  // "inputTextureCoordinate[N]" for input index N, as used by Filter
+  uint32_t GetInputTextureUniform(int index);
+  uint32_t GetInputTexCoordAttribute(int index);
+
   void SetUniformValue(const std::string& uniform_name, int value);
   void SetUniformValue(const std::string& uniform_name, float value);
   void SetUniformValue(const std::string& uniform_name, Vector2 value);
@@ -44,11 +59,61 @@ class GPUPIXEL_API GPUPixelGLProgram {
   void SetUniformValue(int uniform_location, Matrix4 value);
   void SetUniformValue(int uniform_location, const void* array, int length);
 
+  // Incremented whenever a uniform is set to a value that differs from the
+  // one this instance set before
+  uint64_t GetUniformVersion() const { return uniform_version_; }
+
  private:
-  static std::vector<GPUPixelGLProgram*> programs_;
-  uint32_t program_;
+  // Last value this instance set for a uniform, re-applied when another
+  // instance sharing the GL program has changed it since
+  struct UniformValue {
+    enum Type { kInt, kFloat, kVector2, kMatrix3, kMatrix4, kFloatArray };
+    Type type;
+    int int_value;
+    std::vector<float> float_values;
+  };
+
+  // A linked GL program with its reflected locations. Programs created from
+  // the same sources on the same context share one, compiled only once.
+  struct SharedProgram {
+    uint32_t program;
+    GPUPixelContext* context;
+    uint64_t key;
+    std::string vertex_shader_source;
+    std::string fragment_shader_source;
+    std::unordered_map<std::string, uint32_t> uniform_locations;
+    std::unordered_map<std::string, uint32_t> attrib_locations;
+    std::vector<uint32_t> input_texture_uniforms;
+    std::vector<uint32_t> input_tex_coord_attributes;
+    // Instance whose uniform values the GL program currently holds
+    const GPUPixelGLProgram* uniform_owner;
+    // Every uniform an instance has set, with a zero value of its type
+    std::unordered_map<int, UniformValue> written_uniforms;
+  };
+
   bool InitWithShaderString(const std::string& vertex_shader_source,
                             const std::string& fragment_shader_source);
+  bool Link(const std::string& vertex_shader_source,
+            const std::string& fragment_shader_source);
+  void DeleteProgram();
+  void ReflectLocations();
+  void ResolveInputLocations(int index);
+  void StoreUniform(int uniform_location,
+                    UniformValue::Type type,
+                    const float* values,
+                    int count,
+                    int int_value = 0);
+  void RestoreUniforms();
+  void ApplyUniform(int location, const UniformValue& uniform);
+
+  static std::unordered_multimap<uint64_t, std::weak_ptr<SharedProgram>>
+      shared_programs_;
+  static std::mutex programs_mutex_;
+  uint32_t program_;
+  GPUPixelContext* context_;
+  std::shared_ptr<SharedProgram> shared_;
+  std::unordered_map<int, UniformValue> uniform_values_;
+  uint64_t uniform_version_;
 };
 
 }  // namespace gpupixel
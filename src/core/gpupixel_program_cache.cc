@@ -0,0 +1,349 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+#include "core/gpupixel_program_cache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "core/gpupixel_program.h"
+#include "utils/filesystem.h"
+#include "utils/util.h"
+#if defined(GPUPIXEL_WIN)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+// Program binaries are core in GLES 3.0. Desktop GL has them from 4.1 (or
+// ARB_get_program_binary), above the 3.2 glad is generated for, so the entry
+// points are loaded at runtime there. The legacy macOS context and WebGL
+// have no program binaries.
+#if defined(GPUPIXEL_ANDROID) || defined(GPUPIXEL_IOS)
+#define GPUPIXEL_PROGRAM_BINARY 1
+#elif defined(GPUPIXEL_WIN) || defined(GPUPIXEL_LINUX) || \
+    defined(GPUPIXEL_LINUX_EGL)
+#define GPUPIXEL_PROGRAM_BINARY 1
+#define GPUPIXEL_PROGRAM_BINARY_LOADER 1
+#endif
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+namespace gpupixel {
+
+namespace {
+// Bump when the entry layout changes; older entries are then rejected
+const uint32_t kEntryVersion = 1;
+const char kEntryMagic[4] = {'G', 'P', 'X', 'B'};
+// Guards against allocating a corrupted length
+const uint32_t kMaxBinaryLength = 64 * 1024 * 1024;
+
+struct EntryHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t key;
+  uint32_t format;
+  uint32_t length;
+  uint64_t checksum;
+};
+
+std::mutex cache_mutex;
+
+#if defined(GPUPIXEL_PROGRAM_BINARY)
+int GetProcessId() {
+#if defined(GPUPIXEL_WIN)
+  return _getpid();
+#else
+  return getpid();
+#endif
+}
+#endif
+fs::path cache_directory;
+
+#if defined(GPUPIXEL_PROGRAM_BINARY_LOADER)
+typedef void(APIENTRYP GetProgramBinaryProc)(GLuint program,
+                                             GLsizei buf_size,
+                                             GLsizei* length,
+                                             GLenum* binary_format,
+                                             void* binary);
+typedef void(APIENTRYP ProgramBinaryProc)(GLuint program,
+                                          GLenum binary_format,
+                                          const void* binary,
+                                          GLsizei length);
+typedef void(APIENTRYP ProgramParameteriProc)(GLuint program,
+                                              GLenum pname,
+                                              GLint value);
+
+GetProgramBinaryProc get_program_binary = nullptr;
+ProgramBinaryProc program_binary = nullptr;
+ProgramParameteriProc program_parameteri = nullptr;
+
+void* LoadGLProc(const char* name) {
+#if defined(GPUPIXEL_LINUX_EGL)
+  return (void*)eglGetProcAddress(name);
+#else
+  return (void*)glfwGetProcAddress(name);
+#endif
+}
+#elif defined(GPUPIXEL_PROGRAM_BINARY)
+#define get_program_binary glGetProgramBinary
+#define program_binary glProgramBinary
+#define program_parameteri glProgramParameteri
+#endif
+
+// 0 until probed, then 1 if the driver offers at least one binary format
+int binary_support = 0;
+
+uint64_t Fnv1a(const void* data, size_t size, uint64_t hash) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+uint64_t Fnv1a(const std::string& str, uint64_t hash) {
+  // The terminator separates adjacent strings
+  return Fnv1a(str.c_str(), str.size() + 1, hash);
+}
+
+const uint64_t kFnvOffset = 0xcbf29ce484222325ULL;
+
+std::string GetGLString(GLenum name) {
+  const GLubyte* str = glGetString(name);
+  return str ? std::string((const char*)str) : std::string();
+}
+}  // namespace
+
+void ProgramBinaryCache::SetDirectory(const std::string& path) {
+  std::unique_lock<std::mutex> lock(cache_mutex);
+  cache_directory = fs::path(path);
+  if (cache_directory.empty()) {
+    return;
+  }
+  std::error_code ec;
+  fs::create_directories(cache_directory, ec);
+  if (ec) {
+    LOG_WARN("ProgramBinaryCache: can not create {}, cache disabled", path);
+    cache_directory.clear();
+  }
+}
+
+bool ProgramBinaryCache::IsAvailable() {
+#if defined(GPUPIXEL_PROGRAM_BINARY)
+  std::unique_lock<std::mutex> lock(cache_mutex);
+  if (cache_directory.empty()) {
+    return false;
+  }
+  if (binary_support == 0) {
+#if defined(GPUPIXEL_PROGRAM_BINARY_LOADER)
+    get_program_binary =
+        (GetProgramBinaryProc)LoadGLProc("glGetProgramBinary");
+    program_binary = (ProgramBinaryProc)LoadGLProc("glProgramBinary");
+    program_parameteri =
+        (ProgramParameteriProc)LoadGLProc("glProgramParameteri");
+    if (!get_program_binary || !program_binary || !program_parameteri) {
+      binary_support = -1;
+      return false;
+    }
+#endif
+    GLint format_count = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    // Older drivers report GL_INVALID_ENUM here instead of 0 formats
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    binary_support = format_count > 0 ? 1 : -1;
+    if (binary_support < 0) {
+      LOG_INFO("ProgramBinaryCache: driver has no program binary formats");
+    }
+  }
+  return binary_support > 0;
+#else
+  return false;
+#endif
+}
+
+std::string ProgramBinaryCache::GetEntryPath(
+    const std::string& vertex_shader_source,
+    const std::string& fragment_shader_source,
+    uint64_t& key) {
+  key = kFnvOffset;
+  key = Fnv1a(vertex_shader_source, key);
+  key = Fnv1a(fragment_shader_source, key);
+  key = Fnv1a(GetGLString(GL_VENDOR), key);
+  key = Fnv1a(GetGLString(GL_RENDERER), key);
+  key = Fnv1a(GetGLString(GL_VERSION), key);
+
+  std::unique_lock<std::mutex> lock(cache_mutex);
+  return (cache_directory /
+          Util::StringFormat("%016llx.bin", (unsigned long long)key))
+      .string();
+}
+
+void ProgramBinaryCache::PrepareForLink(GLuint program) {
+#if defined(GPUPIXEL_PROGRAM_BINARY)
+  if (IsAvailable()) {
+    GL_CALL(program_parameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                               GL_TRUE));
+  }
+#endif
+}
+
+bool ProgramBinaryCache::Load(GLuint program,
+                              const std::string& vertex_shader_source,
+                              const std::string& fragment_shader_source) {
+#if defined(GPUPIXEL_PROGRAM_BINARY)
+  if (!IsAvailable()) {
+    return false;
+  }
+
+  uint64_t key;
+  std::string path =
+      GetEntryPath(vertex_shader_source, fragment_shader_source, key);
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  EntryHeader header;
+  std::vector<char> binary;
+  bool valid = false;
+  if (file.read((char*)&header, sizeof(header)) &&
+      memcmp(header.magic, kEntryMagic, sizeof(kEntryMagic)) == 0 &&
+      header.version == kEntryVersion && header.key == key &&
+      header.length > 0 && header.length <= kMaxBinaryLength) {
+    binary.resize(header.length);
+    valid = file.read(binary.data(), binary.size()) &&
+            Fnv1a(binary.data(), binary.size(), kFnvOffset) == header.checksum;
+  }
+  file.close();
+
+  if (valid) {
+    program_binary(program, header.format, binary.data(), header.length);
+    GLint link_success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &link_success);
+    // A rejected binary is not an error, it is compiled from source instead
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    valid = link_success == GL_TRUE;
+  }
+
+  if (!valid) {
+    LOG_INFO("ProgramBinaryCache: dropping invalid entry {}", path);
+    std::error_code ec;
+    fs::remove(fs::path(path), ec);
+  }
+  return valid;
+#else
+  return false;
+#endif
+}
+
+void ProgramBinaryCache::Store(GLuint program,
+                               const std::string& vertex_shader_source,
+                               const std::string& fragment_shader_source) {
+#if defined(GPUPIXEL_PROGRAM_BINARY)
+  if (!IsAvailable()) {
+    return;
+  }
+
+  GLint length = 0;
+  GL_CALL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+  if (length <= 0) {
+    return;
+  }
+
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  GLsizei written = 0;
+  GL_CALL(
+      get_program_binary(program, length, &written, &format, binary.data()));
+  if (written <= 0) {
+    return;
+  }
+
+  EntryHeader header;
+  memcpy(header.magic, kEntryMagic, sizeof(kEntryMagic));
+  header.version = kEntryVersion;
+  header.format = format;
+  header.length = written;
+  header.checksum = Fnv1a(binary.data(), written, kFnvOffset);
+  std::string path =
+      GetEntryPath(vertex_shader_source, fragment_shader_source, header.key);
+
+  // Written to a file private to the process and thread, and renamed, so
+  // readers in this or another process never see a partial entry
+  std::string temp_path = Util::StringFormat(
+      "%s.%d.%zx.tmp", path.c_str(), GetProcessId(),
+      std::hash<std::thread::id>()(std::this_thread::get_id()));
+  std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+  bool ok = file.write((const char*)&header, sizeof(header)) &&
+            file.write(binary.data(), written);
+  file.close();
+
+  std::error_code ec;
+  if (ok && !file.fail()) {
+    fs::rename(fs::path(temp_path), fs::path(path), ec);
+  }
+  if (!ok || file.fail() || ec) {
+    LOG_WARN("ProgramBinaryCache: failed to write {}", path);
+    fs::remove(fs::path(temp_path), ec);
+  }
+#endif
+}
+
+ProgramVariantCache::ProgramVariantCache(size_t capacity)
+    : capacity_(capacity) {}
+
+ProgramVariantCache::~ProgramVariantCache() {
+  for (Entry& entry : entries_) {
+    delete entry.program;
+  }
+}
+
+bool ProgramVariantCache::Contains(const std::string& vertex_shader_source,
+                                   const std::string& fragment_shader_source) {
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->vertex_shader_source == vertex_shader_source &&
+        it->fragment_shader_source == fragment_shader_source) {
+      entries_.splice(entries_.begin(), entries_, it);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ProgramVariantCache::Retain(const std::string& vertex_shader_source,
+                                 const std::string& fragment_shader_source) {
+  if (Contains(vertex_shader_source, fragment_shader_source)) {
+    return;
+  }
+  GPUPixelGLProgram* program = GPUPixelGLProgram::CreateWithShaderString(
+      vertex_shader_source, fragment_shader_source);
+  if (!program) {
+    return;
+  }
+  entries_.push_front({vertex_shader_source, fragment_shader_source, program});
+  while (entries_.size() > capacity_) {
+    delete entries_.back().program;
+    entries_.pop_back();
+  }
+}
+
+}  // namespace gpupixel
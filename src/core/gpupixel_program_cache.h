@@ -0,0 +1,78 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include "core/gpupixel_gl_include.h"
+
+namespace gpupixel {
+class GPUPixelGLProgram;
+
+// Persists linked program binaries on disk so later runs can skip compiling
+// and linking. Entries are keyed by a hash of both shader sources and the
+// driver strings; a stale, truncated or rejected entry is deleted and the
+// program is compiled again. Disabled until a directory is set, and on
+// platforms without program binary support. Must be called on a GL thread.
+class GPUPIXEL_API ProgramBinaryCache {
+ public:
+  // An empty path disables the cache
+  static void SetDirectory(const std::string& path);
+
+  // Asks the driver to keep the binary retrievable; call before linking
+  static void PrepareForLink(GLuint program);
+
+  // Loads a cached binary into program. Returns true if program is linked
+  static bool Load(GLuint program,
+                   const std::string& vertex_shader_source,
+                   const std::string& fragment_shader_source);
+
+  // Stores the binary of the linked program
+  static void Store(GLuint program,
+                    const std::string& vertex_shader_source,
+                    const std::string& fragment_shader_source);
+
+ private:
+  static bool IsAvailable();
+  static std::string GetEntryPath(const std::string& vertex_shader_source,
+                                  const std::string& fragment_shader_source,
+                                  uint64_t& key);
+};
+
+// Keeps the most recently used specialized programs of a context linked
+// after the filters using them have switched to other variants. Programs
+// from the same sources share one GL program, so creating a cached variant
+// again does not compile. Used on the context's thread only.
+class GPUPIXEL_API ProgramVariantCache {
+ public:
+  explicit ProgramVariantCache(size_t capacity);
+  ~ProgramVariantCache();
+
+  // Whether the variant is cached, marking it as the most recently used
+  bool Contains(const std::string& vertex_shader_source,
+                const std::string& fragment_shader_source);
+
+  // Keeps the variant linked, evicting the least recently used beyond the
+  // capacity
+  void Retain(const std::string& vertex_shader_source,
+              const std::string& fragment_shader_source);
+
+ private:
+  struct Entry {
+    std::string vertex_shader_source;
+    std::string fragment_shader_source;
+    GPUPixelGLProgram* program;
+  };
+
+  size_t capacity_;
+  // Most recently used first
+  std::list<Entry> entries_;
+};
+
+}  // namespace gpupixel
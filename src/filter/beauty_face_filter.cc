@@ -9,6 +9,11 @@
 #include "core/gpupixel_context.h"
 namespace gpupixel {
 
+namespace {
+// The blur and high-pass branches sample every 4th texel
+const int kBranchTexelSpacing = 4;
+}  // namespace
+
 BeautyFaceFilter::BeautyFaceFilter() {}
 
 BeautyFaceFilter::~BeautyFaceFilter() {}
@@ -42,8 +47,11 @@ bool BeautyFaceFilter::Init() {
 
   SetTerminalFilter(beauty_face_filter_);
 
-  box_blur_filter_->SetTexelSpacingMultiplier(4);
+  box_blur_filter_->SetTexelSpacingMultiplier(kBranchTexelSpacing);
+  // Null where the single-pass shader fails to compile
+  fused_filter_ = FusedBeautyFaceUnitFilter::Create();
   SetRadius(4);
+  SetFused(fused_);
 
   RegisterProperty("whiteness", 0,
                    "The whiteness of filter with range between -1 and 1.",
@@ -52,6 +60,22 @@ bool BeautyFaceFilter::Init() {
   RegisterProperty("skin_smoothing", 0,
                    "The smoothing of filter with range between -1 and 1.",
                    [this](float& val) { SetBlurAlpha(val); });
+
+  RegisterProperty("branch_scale", 1.0,
+                   "The scale of the blur and high-pass branches, 1, 0.5 or "
+                   "0.25 of the input size.",
+                   [this](float& val) { SetBranchScale(val); });
+
+  RegisterProperty("blur_backend", (int)BoxBlurFilter::SEPARABLE,
+                   "0 for separable box blurs, 1 for summed-area tables.",
+                   [this](int& val) {
+                     SetBlurBackend((BoxBlurFilter::Backend)val);
+                   });
+
+  RegisterProperty("fused", 1,
+                   "1 to render in a single pass where supported, 0 for the "
+                   "blur and high-pass branches.",
+                   [this](int& val) { SetFused(val != 0); });
   return true;
 }
 
@@ -66,22 +90,95 @@ void BeautyFaceFilter::SetInputFramebuffer(
 
 void BeautyFaceFilter::SetHighPassDelta(float highPassDelta) {
   box_high_pass_filter_->SetDelta(highPassDelta);
+  if (fused_filter_) {
+    fused_filter_->SetHighPassDelta(highPassDelta);
+  }
 }
 
 void BeautyFaceFilter::SetSharpen(float sharpen) {
   beauty_face_filter_->SetSharpen(sharpen);
+  if (fused_filter_) {
+    fused_filter_->SetSharpen(sharpen);
+  }
 }
 
 void BeautyFaceFilter::SetBlurAlpha(float blurAlpha) {
   beauty_face_filter_->SetBlurAlpha(blurAlpha);
+  if (fused_filter_) {
+    fused_filter_->SetBlurAlpha(blurAlpha);
+  }
 }
 
 void BeautyFaceFilter::SetWhite(float white) {
   beauty_face_filter_->SetWhite(white);
+  if (fused_filter_) {
+    fused_filter_->SetWhite(white);
+  }
+}
+
+void BeautyFaceFilter::SetBranchScale(float scale) {
+  if (scale >= 1.0) {
+    scale = 1.0;
+  } else if (scale >= 0.5) {
+    scale = 0.5;
+  } else {
+    scale = 0.25;
+  }
+  branch_scale_ = scale;
+  box_blur_filter_->SetProcessingScale(scale);
+  box_high_pass_filter_->SetProcessingScale(scale);
+  UpdateUnitFilter();
+}
+
+void BeautyFaceFilter::SetBlurBackend(BoxBlurFilter::Backend backend) {
+  box_blur_filter_->SetBackend(backend);
+  box_high_pass_filter_->SetBlurBackend(backend);
+  blur_backend_ = backend;
+  UpdateUnitFilter();
+}
+
+void BeautyFaceFilter::SetFused(bool fused) {
+  fused_ = fused;
+  UpdateUnitFilter();
+}
+
+void BeautyFaceFilter::UpdateUnitFilter() {
+  // The fused pass has no branches, so a branch scale or blur backend
+  // other than the default selects the three-pass path
+  std::shared_ptr<Filter> unit_filter = beauty_face_filter_;
+  if (fused_ && fused_filter_ && branch_scale_ == 1.0 &&
+      blur_backend_ == BoxBlurFilter::SEPARABLE) {
+    unit_filter = fused_filter_;
+  }
+  if (unit_filter == terminal_filter_) {
+    return;
+  }
+
+  // The sinks move over to the new terminal filter
+  std::map<std::shared_ptr<Sink>, int> sinks = terminal_filter_->GetSinks();
+  terminal_filter_->RemoveAllSinks();
+  RemoveAllFilters();
+  if (unit_filter == fused_filter_) {
+    AddFilter(fused_filter_);
+  } else {
+    AddFilter(box_blur_filter_);
+    AddFilter(box_high_pass_filter_);
+    AddFilter(beauty_face_filter_);
+  }
+  for (auto& sink : sinks) {
+    terminal_filter_->AddSink(sink.first, sink.second);
+  }
+}
+
+bool BeautyFaceFilter::IsIdentity() const {
+  return beauty_face_filter_->IsIdentity();
 }
 
 void BeautyFaceFilter::SetRadius(float radius) {
   box_blur_filter_->SetRadius(radius);
   box_high_pass_filter_->SetRadius(radius);
+  if (fused_filter_) {
+    fused_filter_->SetRadius(radius * kBranchTexelSpacing);
+  }
 }
 }  // namespace gpupixel
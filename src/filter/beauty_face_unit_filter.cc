@@ -7,7 +7,7 @@
 
 #include "gpupixel/filter/beauty_face_unit_filter.h"
 #include "core/gpupixel_context.h"
-#include "gpupixel/source/source_image.h"
+#include "core/gpupixel_lookup_texture_cache.h"
 #include "utils/util.h"
 
 namespace gpupixel {
@@ -37,6 +37,86 @@ const std::string kGPUImageBaseBeautyFaceVertexShaderString = R"(
                inputTextureCoordinate + vec2(widthOffset, -heightOffset));
     })";
 #if defined(GPUPIXEL_GLES_SHADER)
+// The whitening stages, shared with the other beauty filters. Included
+// after the default float precision.
+const std::string kBeautyWhitenShaderString = R"(
+    uniform sampler2D lookUpGray;
+    uniform sampler2D lookUpOrigin;
+    uniform sampler2D lookUpSkin;
+    uniform sampler2D lookUpCustom;
+    uniform highp float whiten;
+
+    const float levelRangeInv = 1.02657;
+    const float levelBlack = 0.0258820;
+    const float alpha = 0.7;
+
+    vec3 whitenColor(vec3 color) {
+      vec3 colorEPM = color;
+      color =
+          clamp((colorEPM - vec3(levelBlack)) * levelRangeInv, 0.0, 1.0);
+      vec3 texel = vec3(texture2D(lookUpGray, vec2(color.r, 0.5)).r,
+                        texture2D(lookUpGray, vec2(color.g, 0.5)).g,
+                        texture2D(lookUpGray, vec2(color.b, 0.5)).b);
+      texel = mix(color, texel, 0.5);
+      texel = mix(colorEPM, texel, alpha);
+
+      texel = clamp(texel, 0., 1.);
+      float blueColor = texel.b * 15.0;
+      vec2 quad1;
+      quad1.y = floor(floor(blueColor) * 0.25);
+      quad1.x = floor(blueColor) - (quad1.y * 4.0);
+      vec2 quad2;
+      quad2.y = floor(ceil(blueColor) * 0.25);
+      quad2.x = ceil(blueColor) - (quad2.y * 4.0);
+      vec2 texPos2 = texel.rg * 0.234375 + 0.0078125;
+      vec2 texPos1 = quad1 * 0.25 + texPos2;
+      texPos2 = quad2 * 0.25 + texPos2;
+      vec3 newColor1Origin = texture2D(lookUpOrigin, texPos1).rgb;
+      vec3 newColor2Origin = texture2D(lookUpOrigin, texPos2).rgb;
+      vec3 colorOrigin =
+          mix(newColor1Origin, newColor2Origin, fract(blueColor));
+      texel = mix(colorOrigin, color, alpha);
+
+      texel = clamp(texel, 0., 1.);
+      blueColor = texel.b * 15.0;
+      quad1.y = floor(floor(blueColor) * 0.25);
+      quad1.x = floor(blueColor) - (quad1.y * 4.0);
+      quad2.y = floor(ceil(blueColor) * 0.25);
+      quad2.x = ceil(blueColor) - (quad2.y * 4.0);
+      texPos2 = texel.rg * 0.234375 + 0.0078125;
+      texPos1 = quad1 * 0.25 + texPos2;
+      texPos2 = quad2 * 0.25 + texPos2;
+      vec3 newColor1 = texture2D(lookUpSkin, texPos1).rgb;
+      vec3 newColor2 = texture2D(lookUpSkin, texPos2).rgb;
+      color = mix(newColor1.rgb, newColor2.rgb, fract(blueColor));
+      color = clamp(color, 0., 1.);
+
+      highp float blueColor_custom = color.b * 63.0;
+      highp vec2 quad1_custom;
+      quad1_custom.y = floor(floor(blueColor_custom) / 8.0);
+      quad1_custom.x = floor(blueColor_custom) - (quad1_custom.y * 8.0);
+      highp vec2 quad2_custom;
+      quad2_custom.y = floor(ceil(blueColor_custom) / 8.0);
+      quad2_custom.x = ceil(blueColor_custom) - (quad2_custom.y * 8.0);
+      highp vec2 texPos1_custom;
+      texPos1_custom.x = (quad1_custom.x * 1.0 / 8.0) + 0.5 / 512.0 +
+                         ((1.0 / 8.0 - 1.0 / 512.0) * color.r);
+      texPos1_custom.y = (quad1_custom.y * 1.0 / 8.0) + 0.5 / 512.0 +
+                         ((1.0 / 8.0 - 1.0 / 512.0) * color.g);
+      highp vec2 texPos2_custom;
+      texPos2_custom.x = (quad2_custom.x * 1.0 / 8.0) + 0.5 / 512.0 +
+                         ((1.0 / 8.0 - 1.0 / 512.0) * color.r);
+      texPos2_custom.y = (quad2_custom.y * 1.0 / 8.0) + 0.5 / 512.0 +
+                         ((1.0 / 8.0 - 1.0 / 512.0) * color.g);
+      newColor1 = texture2D(lookUpCustom, texPos1_custom).rgb;
+      newColor2 = texture2D(lookUpCustom, texPos2_custom).rgb;
+      vec3 color_custom =
+          mix(newColor1, newColor2, fract(blueColor_custom));
+      color = mix(color, color_custom, whiten);
+
+      return color;
+    })";
+
 const std::string kGPUImageBaseBeautyFaceFragmentShaderString = R"(
     precision highp float; 
     varying highp vec2 textureCoordinate;
@@ -48,19 +128,10 @@ const std::string kGPUImageBaseBeautyFaceFragmentShaderString = R"(
     uniform sampler2D inputImageTexture;
     uniform sampler2D inputImageTexture2;
     uniform sampler2D inputImageTexture3;
-    uniform sampler2D lookUpGray;
-    uniform sampler2D lookUpOrigin;
-    uniform sampler2D lookUpSkin;
-    uniform sampler2D lookUpCustom;
 
     uniform highp float sharpen;
     uniform highp float blurAlpha;
-    uniform highp float whiten;
-
-    const float levelRangeInv = 1.02657;
-    const float levelBlack = 0.0258820;
-    const float alpha = 0.7;
-
+)" + kBeautyWhitenShaderString + R"(
     void main() {
       vec4 iColor = texture2D(inputImageTexture, textureCoordinate);
       vec4 meanColor = texture2D(inputImageTexture2, textureCoordinate);
@@ -93,73 +164,158 @@ const std::string kGPUImageBaseBeautyFaceFragmentShaderString = R"(
       }
 
       if (whiten > 0.0) {
-        vec3 colorEPM = color;
-        color =
-            clamp((colorEPM - vec3(levelBlack)) * levelRangeInv, 0.0, 1.0);
-        vec3 texel = vec3(texture2D(lookUpGray, vec2(color.r, 0.5)).r,
-                          texture2D(lookUpGray, vec2(color.g, 0.5)).g,
-                          texture2D(lookUpGray, vec2(color.b, 0.5)).b);
-        texel = mix(color, texel, 0.5);
-        texel = mix(colorEPM, texel, alpha);
-
-        texel = clamp(texel, 0., 1.);
-        float blueColor = texel.b * 15.0;
-        vec2 quad1;
-        quad1.y = floor(floor(blueColor) * 0.25);
-        quad1.x = floor(blueColor) - (quad1.y * 4.0);
-        vec2 quad2;
-        quad2.y = floor(ceil(blueColor) * 0.25);
-        quad2.x = ceil(blueColor) - (quad2.y * 4.0);
-        vec2 texPos2 = texel.rg * 0.234375 + 0.0078125;
-        vec2 texPos1 = quad1 * 0.25 + texPos2;
-        texPos2 = quad2 * 0.25 + texPos2;
-        vec3 newColor1Origin = texture2D(lookUpOrigin, texPos1).rgb;
-        vec3 newColor2Origin = texture2D(lookUpOrigin, texPos2).rgb;
-        vec3 colorOrigin =
-            mix(newColor1Origin, newColor2Origin, fract(blueColor));
-        texel = mix(colorOrigin, color, alpha);
-
-        texel = clamp(texel, 0., 1.);
-        blueColor = texel.b * 15.0;
-        quad1.y = floor(floor(blueColor) * 0.25);
-        quad1.x = floor(blueColor) - (quad1.y * 4.0);
-        quad2.y = floor(ceil(blueColor) * 0.25);
-        quad2.x = ceil(blueColor) - (quad2.y * 4.0);
-        texPos2 = texel.rg * 0.234375 + 0.0078125;
-        texPos1 = quad1 * 0.25 + texPos2;
-        texPos2 = quad2 * 0.25 + texPos2;
-        vec3 newColor1 = texture2D(lookUpSkin, texPos1).rgb;
-        vec3 newColor2 = texture2D(lookUpSkin, texPos2).rgb;
-        color = mix(newColor1.rgb, newColor2.rgb, fract(blueColor));
-        color = clamp(color, 0., 1.);
-
-        highp float blueColor_custom = color.b * 63.0;
-        highp vec2 quad1_custom;
-        quad1_custom.y = floor(floor(blueColor_custom) / 8.0);
-        quad1_custom.x = floor(blueColor_custom) - (quad1_custom.y * 8.0);
-        highp vec2 quad2_custom;
-        quad2_custom.y = floor(ceil(blueColor_custom) / 8.0);
-        quad2_custom.x = ceil(blueColor_custom) - (quad2_custom.y * 8.0);
-        highp vec2 texPos1_custom;
-        texPos1_custom.x = (quad1_custom.x * 1.0 / 8.0) + 0.5 / 512.0 +
-                           ((1.0 / 8.0 - 1.0 / 512.0) * color.r);
-        texPos1_custom.y = (quad1_custom.y * 1.0 / 8.0) + 0.5 / 512.0 +
-                           ((1.0 / 8.0 - 1.0 / 512.0) * color.g);
-        highp vec2 texPos2_custom;
-        texPos2_custom.x = (quad2_custom.x * 1.0 / 8.0) + 0.5 / 512.0 +
-                           ((1.0 / 8.0 - 1.0 / 512.0) * color.r);
-        texPos2_custom.y = (quad2_custom.y * 1.0 / 8.0) + 0.5 / 512.0 +
-                           ((1.0 / 8.0 - 1.0 / 512.0) * color.g);
-        newColor1 = texture2D(lookUpCustom, texPos1_custom).rgb;
-        newColor2 = texture2D(lookUpCustom, texPos2_custom).rgb;
-        vec3 color_custom =
-            mix(newColor1, newColor2, fract(blueColor_custom));
-        color = mix(color, color_custom, whiten);
+        color = whitenColor(color);
+      }
+
+      gl_FragColor = vec4(color, 1.0);
+    })";
+
+// Single-input variant: the mean comes from 4x4 taps spread evenly over the
+// box the blur and high-pass branches average
+const std::string kFusedBeautyFaceFragmentShaderString = R"(
+    precision highp float;
+    varying highp vec2 textureCoordinate;
+    varying highp vec4 textureShift_1;
+    varying highp vec4 textureShift_2;
+    varying highp vec4 textureShift_3;
+    varying highp vec4 textureShift_4;
+
+    uniform sampler2D inputImageTexture;
+
+    uniform highp vec2 tapStep;
+    uniform highp float delta;
+    uniform highp float sharpen;
+    uniform highp float blurAlpha;
+)" + kBeautyWhitenShaderString + R"(
+    void main() {
+      vec4 iColor = texture2D(inputImageTexture, textureCoordinate);
+
+      vec3 color = iColor.rgb;
+      if (blurAlpha >= 0.0) {
+        vec3 tapSum = vec3(0.0);
+        for (int j = 0; j < 4; j++) {
+          for (int i = 0; i < 4; i++) {
+            vec2 offset = (vec2(float(i), float(j)) - 1.5) * tapStep;
+            tapSum +=
+                texture2D(inputImageTexture, textureCoordinate + offset).rgb;
+          }
+        }
+        vec3 meanColor = tapSum / 16.0;
+        // The squared difference to the mean, like BoxDifferenceFilter
+        vec3 varColor = (iColor.rgb - meanColor) * delta;
+        varColor = min(varColor * varColor, 1.0);
+
+        float theta = 0.1;
+        float p =
+            clamp((min(iColor.r, meanColor.r - 0.1) - 0.2) * 4.0, 0.0, 1.0);
+        float meanVar = (varColor.r + varColor.g + varColor.b) / 3.0;
+        float kMin;
+        highp vec3 resultColor;
+        kMin = (1.0 - meanVar / (meanVar + theta)) * p * blurAlpha;
+        kMin = clamp(kMin, 0.0, 1.0);
+        resultColor = mix(iColor.rgb, meanColor, kMin);
+
+        vec3 sum = 0.25 * iColor.rgb;
+        sum += 0.125 * texture2D(inputImageTexture, textureShift_1.xy).rgb;
+        sum += 0.125 * texture2D(inputImageTexture, textureShift_1.zw).rgb;
+        sum += 0.125 * texture2D(inputImageTexture, textureShift_2.xy).rgb;
+        sum += 0.125 * texture2D(inputImageTexture, textureShift_2.zw).rgb;
+        sum += 0.0625 * texture2D(inputImageTexture, textureShift_3.xy).rgb;
+        sum += 0.0625 * texture2D(inputImageTexture, textureShift_3.zw).rgb;
+        sum += 0.0625 * texture2D(inputImageTexture, textureShift_4.xy).rgb;
+        sum += 0.0625 * texture2D(inputImageTexture, textureShift_4.zw).rgb;
+
+        vec3 hPass = iColor.rgb - sum;
+        color = resultColor + sharpen * hPass * 2.0;
+      }
+
+      if (whiten > 0.0) {
+        color = whitenColor(color);
       }
 
       gl_FragColor = vec4(color, 1.0);
     })";
 #elif defined(GPUPIXEL_GL_SHADER)
+// The whitening stages, shared with the other beauty filters. Included
+// after the default float precision.
+const std::string kBeautyWhitenShaderString = R"(
+    uniform sampler2D lookUpGray;
+    uniform sampler2D lookUpOrigin;
+    uniform sampler2D lookUpSkin;
+    uniform sampler2D lookUpCustom;
+    uniform float whiten;
+
+    const float levelRangeInv = 1.02657;
+    const float levelBlack = 0.0258820;
+    const float alpha = 0.7;
+
+    vec3 whitenColor(vec3 color) {
+      vec3 colorEPM = color;
+      color =
+          clamp((colorEPM - vec3(levelBlack)) * levelRangeInv, 0.0, 1.0);
+      vec3 texel = vec3(texture2D(lookUpGray, vec2(color.r, 0.5)).r,
+                        texture2D(lookUpGray, vec2(color.g, 0.5)).g,
+                        texture2D(lookUpGray, vec2(color.b, 0.5)).b);
+      texel = mix(color, texel, 0.5);
+      texel = mix(colorEPM, texel, alpha);
+
+      texel = clamp(texel, 0., 1.);
+      float blueColor = texel.b * 15.0;
+      vec2 quad1;
+      quad1.y = floor(floor(blueColor) * 0.25);
+      quad1.x = floor(blueColor) - (quad1.y * 4.0);
+      vec2 quad2;
+      quad2.y = floor(ceil(blueColor) * 0.25);
+      quad2.x = ceil(blueColor) - (quad2.y * 4.0);
+      vec2 texPos2 = texel.rg * 0.234375 + 0.0078125;
+      vec2 texPos1 = quad1 * 0.25 + texPos2;
+      texPos2 = quad2 * 0.25 + texPos2;
+      vec3 newColor1Origin = texture2D(lookUpOrigin, texPos1).rgb;
+      vec3 newColor2Origin = texture2D(lookUpOrigin, texPos2).rgb;
+      vec3 colorOrigin =
+          mix(newColor1Origin, newColor2Origin, fract(blueColor));
+      texel = mix(colorOrigin, color, alpha);
+
+      texel = clamp(texel, 0., 1.);
+      blueColor = texel.b * 15.0;
+      quad1.y = floor(floor(blueColor) * 0.25);
+      quad1.x = floor(blueColor) - (quad1.y * 4.0);
+      quad2.y = floor(ceil(blueColor) * 0.25);
+      quad2.x = ceil(blueColor) - (quad2.y * 4.0);
+      texPos2 = texel.rg * 0.234375 + 0.0078125;
+      texPos1 = quad1 * 0.25 + texPos2;
+      texPos2 = quad2 * 0.25 + texPos2;
+      vec3 newColor1 = texture2D(lookUpSkin, texPos1).rgb;
+      vec3 newColor2 = texture2D(lookUpSkin, texPos2).rgb;
+      color = mix(newColor1.rgb, newColor2.rgb, fract(blueColor));
+      color = clamp(color, 0., 1.);
+
+      float blueColor_custom = color.b * 63.0;
+      vec2 quad1_custom;
+      quad1_custom.y = floor(floor(blueColor_custom) / 8.0);
+      quad1_custom.x = floor(blueColor_custom) - (quad1_custom.y * 8.0);
+      vec2 quad2_custom;
+      quad2_custom.y = floor(ceil(blueColor_custom) / 8.0);
+      quad2_custom.x = ceil(blueColor_custom) - (quad2_custom.y * 8.0);
+      vec2 texPos1_custom;
+      texPos1_custom.x = (quad1_custom.x * 1.0 / 8.0) + 0.5 / 512.0 +
+                         ((1.0 / 8.0 - 1.0 / 512.0) * color.r);
+      texPos1_custom.y = (quad1_custom.y * 1.0 / 8.0) + 0.5 / 512.0 +
+                         ((1.0 / 8.0 - 1.0 / 512.0) * color.g);
+      vec2 texPos2_custom;
+      texPos2_custom.x = (quad2_custom.x * 1.0 / 8.0) + 0.5 / 512.0 +
+                         ((1.0 / 8.0 - 1.0 / 512.0) * color.r);
+      texPos2_custom.y = (quad2_custom.y * 1.0 / 8.0) + 0.5 / 512.0 +
+                         ((1.0 / 8.0 - 1.0 / 512.0) * color.g);
+      newColor1 = texture2D(lookUpCustom, texPos1_custom).rgb;
+      newColor2 = texture2D(lookUpCustom, texPos2_custom).rgb;
+      vec3 color_custom =
+          mix(newColor1, newColor2, fract(blueColor_custom));
+      color = mix(color, color_custom, whiten);
+
+      return color;
+    })";
+
 const std::string kGPUImageBaseBeautyFaceFragmentShaderString = R"(
     float; varying vec2 textureCoordinate; varying vec4 textureShift_1;
     varying vec4 textureShift_2;
@@ -169,19 +325,10 @@ const std::string kGPUImageBaseBeautyFaceFragmentShaderString = R"(
     uniform sampler2D inputImageTexture;
     uniform sampler2D inputImageTexture2;
     uniform sampler2D inputImageTexture3;
-    uniform sampler2D lookUpGray;
-    uniform sampler2D lookUpOrigin;
-    uniform sampler2D lookUpSkin;
-    uniform sampler2D lookUpCustom;
 
     uniform float sharpen;
     uniform float blurAlpha;
-    uniform float whiten;
-
-    const float levelRangeInv = 1.02657;
-    const float levelBlack = 0.0258820;
-    const float alpha = 0.7;
-
+)" + kBeautyWhitenShaderString + R"(
     void main() {
       vec4 iColor = texture2D(inputImageTexture, textureCoordinate);
       vec4 meanColor = texture2D(inputImageTexture2, textureCoordinate);
@@ -216,73 +363,77 @@ const std::string kGPUImageBaseBeautyFaceFragmentShaderString = R"(
 
       // whiten
       if (whiten > 0.0) {
-        vec3 colorEPM = color;
-        color =
-            clamp((colorEPM - vec3(levelBlack)) * levelRangeInv, 0.0, 1.0);
-        vec3 texel = vec3(texture2D(lookUpGray, vec2(color.r, 0.5)).r,
-                          texture2D(lookUpGray, vec2(color.g, 0.5)).g,
-                          texture2D(lookUpGray, vec2(color.b, 0.5)).b);
-        texel = mix(color, texel, 0.5);
-        texel = mix(colorEPM, texel, alpha);
-
-        texel = clamp(texel, 0., 1.);
-        float blueColor = texel.b * 15.0;
-        vec2 quad1;
-        quad1.y = floor(floor(blueColor) * 0.25);
-        quad1.x = floor(blueColor) - (quad1.y * 4.0);
-        vec2 quad2;
-        quad2.y = floor(ceil(blueColor) * 0.25);
-        quad2.x = ceil(blueColor) - (quad2.y * 4.0);
-        vec2 texPos2 = texel.rg * 0.234375 + 0.0078125;
-        vec2 texPos1 = quad1 * 0.25 + texPos2;
-        texPos2 = quad2 * 0.25 + texPos2;
-        vec3 newColor1Origin = texture2D(lookUpOrigin, texPos1).rgb;
-        vec3 newColor2Origin = texture2D(lookUpOrigin, texPos2).rgb;
-        vec3 colorOrigin =
-            mix(newColor1Origin, newColor2Origin, fract(blueColor));
-        texel = mix(colorOrigin, color, alpha);
-
-        texel = clamp(texel, 0., 1.);
-        blueColor = texel.b * 15.0;
-        quad1.y = floor(floor(blueColor) * 0.25);
-        quad1.x = floor(blueColor) - (quad1.y * 4.0);
-        quad2.y = floor(ceil(blueColor) * 0.25);
-        quad2.x = ceil(blueColor) - (quad2.y * 4.0);
-        texPos2 = texel.rg * 0.234375 + 0.0078125;
-        texPos1 = quad1 * 0.25 + texPos2;
-        texPos2 = quad2 * 0.25 + texPos2;
-        vec3 newColor1 = texture2D(lookUpSkin, texPos1).rgb;
-        vec3 newColor2 = texture2D(lookUpSkin, texPos2).rgb;
-        color = mix(newColor1.rgb, newColor2.rgb, fract(blueColor));
-        color = clamp(color, 0., 1.);
-
-        float blueColor_custom = color.b * 63.0;
-        vec2 quad1_custom;
-        quad1_custom.y = floor(floor(blueColor_custom) / 8.0);
-        quad1_custom.x = floor(blueColor_custom) - (quad1_custom.y * 8.0);
-        vec2 quad2_custom;
-        quad2_custom.y = floor(ceil(blueColor_custom) / 8.0);
-        quad2_custom.x = ceil(blueColor_custom) - (quad2_custom.y * 8.0);
-        vec2 texPos1_custom;
-        texPos1_custom.x = (quad1_custom.x * 1.0 / 8.0) + 0.5 / 512.0 +
-                           ((1.0 / 8.0 - 1.0 / 512.0) * color.r);
-        texPos1_custom.y = (quad1_custom.y * 1.0 / 8.0) + 0.5 / 512.0 +
-                           ((1.0 / 8.0 - 1.0 / 512.0) * color.g);
-        vec2 texPos2_custom;
-        texPos2_custom.x = (quad2_custom.x * 1.0 / 8.0) + 0.5 / 512.0 +
-                           ((1.0 / 8.0 - 1.0 / 512.0) * color.r);
-        texPos2_custom.y = (quad2_custom.y * 1.0 / 8.0) + 0.5 / 512.0 +
-                           ((1.0 / 8.0 - 1.0 / 512.0) * color.g);
-        newColor1 = texture2D(lookUpCustom, texPos1_custom).rgb;
-        newColor2 = texture2D(lookUpCustom, texPos2_custom).rgb;
-        vec3 color_custom =
-            mix(newColor1, newColor2, fract(blueColor_custom));
-        color = mix(color, color_custom, whiten);
+        color = whitenColor(color);
       }
       
       gl_FragColor = vec4(color, 1.0);
       
     })";
+
+// Single-input variant: the mean comes from 4x4 taps spread evenly over the
+// box the blur and high-pass branches average
+const std::string kFusedBeautyFaceFragmentShaderString = R"(
+    varying vec2 textureCoordinate;
+    varying vec4 textureShift_1;
+    varying vec4 textureShift_2;
+    varying vec4 textureShift_3;
+    varying vec4 textureShift_4;
+
+    uniform sampler2D inputImageTexture;
+
+    uniform vec2 tapStep;
+    uniform float delta;
+    uniform float sharpen;
+    uniform float blurAlpha;
+)" + kBeautyWhitenShaderString + R"(
+    void main() {
+      vec4 iColor = texture2D(inputImageTexture, textureCoordinate);
+
+      vec3 color = iColor.rgb;
+      if (blurAlpha > 0.0) {
+        vec3 tapSum = vec3(0.0);
+        for (int j = 0; j < 4; j++) {
+          for (int i = 0; i < 4; i++) {
+            vec2 offset = (vec2(float(i), float(j)) - 1.5) * tapStep;
+            tapSum +=
+                texture2D(inputImageTexture, textureCoordinate + offset).rgb;
+          }
+        }
+        vec3 meanColor = tapSum / 16.0;
+        // The squared difference to the mean, like BoxDifferenceFilter
+        vec3 varColor = (iColor.rgb - meanColor) * delta;
+        varColor = min(varColor * varColor, 1.0);
+
+        float theta = 0.1;
+        float p =
+            clamp((min(iColor.r, meanColor.r - 0.1) - 0.2) * 4.0, 0.0, 1.0);
+        float meanVar = (varColor.r + varColor.g + varColor.b) / 3.0;
+        float kMin;
+        vec3 resultColor;
+        kMin = (1.0 - meanVar / (meanVar + theta)) * p * blurAlpha;
+        kMin = clamp(kMin, 0.0, 1.0);
+        resultColor = mix(iColor.rgb, meanColor, kMin);
+
+        vec3 sum = 0.25 * iColor.rgb;
+        sum += 0.125 * texture2D(inputImageTexture, textureShift_1.xy).rgb;
+        sum += 0.125 * texture2D(inputImageTexture, textureShift_1.zw).rgb;
+        sum += 0.125 * texture2D(inputImageTexture, textureShift_2.xy).rgb;
+        sum += 0.125 * texture2D(inputImageTexture, textureShift_2.zw).rgb;
+        sum += 0.0625 * texture2D(inputImageTexture, textureShift_3.xy).rgb;
+        sum += 0.0625 * texture2D(inputImageTexture, textureShift_3.zw).rgb;
+        sum += 0.0625 * texture2D(inputImageTexture, textureShift_4.xy).rgb;
+        sum += 0.0625 * texture2D(inputImageTexture, textureShift_4.zw).rgb;
+
+        vec3 hPass = iColor.rgb - sum;
+        color = resultColor + sharpen * hPass * 2.0;
+      }
+
+      if (whiten > 0.0) {
+        color = whitenColor(color);
+      }
+
+      gl_FragColor = vec4(color, 1.0);
+    })";
 #endif
 
 BeautyFaceUnitFilter::BeautyFaceUnitFilter() {}
@@ -305,15 +456,45 @@ bool BeautyFaceUnitFilter::Init() {
                                     3)) {
     return false;
   }
+  return LoadLookupImages();
+}
+
+const std::string& BeautyFaceUnitFilter::GetWhitenShaderString() {
+  return kBeautyWhitenShaderString;
+}
 
+bool BeautyFaceUnitFilter::LoadLookupImages() {
   auto path = Util::GetResourcePath() / "res";
-  gray_image_ = SourceImage::Create((path / "lookup_gray.png").string());
-  original_image_ = SourceImage::Create((path / "lookup_origin.png").string());
-  skin_image_ = SourceImage::Create((path / "lookup_skin.png").string());
-  custom_image_ = SourceImage::Create((path / "lookup_light.png").string());
+  const char* names[] = {"lookup_gray.png", "lookup_origin.png",
+                         "lookup_skin.png", "lookup_light.png"};
+  std::shared_ptr<GPUPixelFramebuffer>* lookups[] = {
+      &gray_lookup_, &original_lookup_, &skin_lookup_, &custom_lookup_};
+  // Decoded together in the background, unless another instance has them
+  for (const char* name : names) {
+    LookupTextureCache::Prefetch((path / name).string());
+  }
+  for (int i = 0; i < 4; i++) {
+    LookupTextureCache::Acquire((path / names[i]).string(), true, *lookups[i]);
+    if (!*lookups[i]) {
+      return false;
+    }
+  }
   return true;
 }
 
+void BeautyFaceUnitFilter::BindLookupImages(int first_unit) {
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  const char* names[] = {"lookUpGray", "lookUpOrigin", "lookUpSkin",
+                         "lookUpCustom"};
+  std::shared_ptr<GPUPixelFramebuffer> lookups[] = {
+      gray_lookup_, original_lookup_, skin_lookup_, custom_lookup_};
+  for (int i = 0; i < 4; i++) {
+    gl_state->BindTexture(GL_TEXTURE0 + first_unit + i,
+                          lookups[i]->GetTexture());
+    filter_program_->SetUniformValue(names[i], first_unit + i);
+  }
+}
+
 bool BeautyFaceUnitFilter::DoRender(bool updateSinks) {
   static const float imageVertices[] = {
       -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
@@ -321,47 +502,41 @@ bool BeautyFaceUnitFilter::DoRender(bool updateSinks) {
 
   GPUPixelContext::GetInstance()->SetActiveGlProgram(filter_program_);
   framebuffer_->Activate();
-  GL_CALL(glClearColor(background_color_.r, background_color_.g,
-                       background_color_.b, background_color_.a));
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  gl_state->ClearColor(background_color_.r, background_color_.g,
+                       background_color_.b, background_color_.a);
   GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
 
-  GL_CALL(glActiveTexture(GL_TEXTURE2));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D,
-                        input_framebuffers_[0].frame_buffer->GetTexture()));
+  gl_state->BindTexture(GL_TEXTURE2,
+                        input_framebuffers_[0].frame_buffer->GetTexture());
   filter_program_->SetUniformValue("inputImageTexture", 2);
 
-  GL_CALL(glActiveTexture(GL_TEXTURE3));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D,
-                        input_framebuffers_[1].frame_buffer->GetTexture()));
+  gl_state->BindTexture(GL_TEXTURE3,
+                        input_framebuffers_[1].frame_buffer->GetTexture());
   filter_program_->SetUniformValue("inputImageTexture2", 3);
 
-  GL_CALL(glActiveTexture(GL_TEXTURE4));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D,
-                        input_framebuffers_[2].frame_buffer->GetTexture()));
+  gl_state->BindTexture(GL_TEXTURE4,
+                        input_framebuffers_[2].frame_buffer->GetTexture());
   filter_program_->SetUniformValue("inputImageTexture3", 4);
 
   // texcoord attribute
   uint32_t filter_tex_coord_attribute =
       filter_program_->GetAttribLocation("inputTextureCoordinate");
-  GL_CALL(glEnableVertexAttribArray(filter_tex_coord_attribute));
+  gl_state->EnableVertexAttribArray(filter_tex_coord_attribute);
   GL_CALL(glVertexAttribPointer(
       filter_tex_coord_attribute, 2, GL_FLOAT, 0, 0,
       GetTextureCoordinate(input_framebuffers_[0].rotation_mode)));
 
-  glActiveTexture(GL_TEXTURE5);
-  glBindTexture(GL_TEXTURE_2D, gray_image_->GetFramebuffer()->GetTexture());
+  gl_state->BindTexture(GL_TEXTURE5, gray_lookup_->GetTexture());
   filter_program_->SetUniformValue("lookUpGray", 5);
 
-  glActiveTexture(GL_TEXTURE6);
-  glBindTexture(GL_TEXTURE_2D, original_image_->GetFramebuffer()->GetTexture());
+  gl_state->BindTexture(GL_TEXTURE6, original_lookup_->GetTexture());
   filter_program_->SetUniformValue("lookUpOrigin", 6);
 
-  glActiveTexture(GL_TEXTURE7);
-  glBindTexture(GL_TEXTURE_2D, skin_image_->GetFramebuffer()->GetTexture());
+  gl_state->BindTexture(GL_TEXTURE7, skin_lookup_->GetTexture());
   filter_program_->SetUniformValue("lookUpSkin", 7);
 
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, custom_image_->GetFramebuffer()->GetTexture());
+  gl_state->BindTexture(GL_TEXTURE0, custom_lookup_->GetTexture());
   filter_program_->SetUniformValue("lookUpCustom", 0);
 
   float width_offset = 1.0 / this->GetRotatedFramebufferWidth();
@@ -385,6 +560,10 @@ bool BeautyFaceUnitFilter::DoRender(bool updateSinks) {
   return Source::DoRender(updateSinks);
 }
 
+bool BeautyFaceUnitFilter::IsIdentity() const {
+  return blur_alpha_ <= 0 && white_balance_ <= 0 && sharpen_factor_ == 0;
+}
+
 void BeautyFaceUnitFilter::SetSharpen(float sharpen) {
   sharpen_factor_ = sharpen;
 }
@@ -401,4 +580,54 @@ void BeautyFaceUnitFilter::SetWhite(float white) {
 #endif
 }
 
+FusedBeautyFaceUnitFilter::FusedBeautyFaceUnitFilter() {}
+
+std::shared_ptr<FusedBeautyFaceUnitFilter>
+FusedBeautyFaceUnitFilter::Create() {
+  auto ret = std::shared_ptr<FusedBeautyFaceUnitFilter>(
+      new FusedBeautyFaceUnitFilter());
+  gpupixel::GPUPixelContext::GetInstance()->SyncRunWithContext([&] {
+    if (ret && !ret->Init()) {
+      ret.reset();
+    }
+  });
+  return ret;
+}
+
+bool FusedBeautyFaceUnitFilter::Init() {
+  if (!Filter::InitWithShaderString(kGPUImageBaseBeautyFaceVertexShaderString,
+                                    kFusedBeautyFaceFragmentShaderString)) {
+    return false;
+  }
+  return LoadLookupImages();
+}
+
+bool FusedBeautyFaceUnitFilter::DoRender(bool updateSinks) {
+  // Unit 0 takes the input
+  BindLookupImages(1);
+
+  float width_offset = 1.0 / this->GetRotatedFramebufferWidth();
+  float height_offset = 1.0 / this->GetRotatedFramebufferHeight();
+  filter_program_->SetUniformValue("widthOffset", width_offset);
+  filter_program_->SetUniformValue("heightOffset", height_offset);
+  // The 4 taps across are centered on the quarters of the box
+  filter_program_->SetUniformValue(
+      "tapStep", Vector2(radius_ / 2 * width_offset,
+                         radius_ / 2 * height_offset));
+
+  filter_program_->SetUniformValue("delta", high_pass_delta_);
+  filter_program_->SetUniformValue("sharpen", sharpen_factor_);
+  filter_program_->SetUniformValue("blurAlpha", blur_alpha_);
+  filter_program_->SetUniformValue("whiten", white_balance_);
+  return Filter::DoRender(updateSinks);
+}
+
+void FusedBeautyFaceUnitFilter::SetRadius(float radius) {
+  radius_ = radius;
+}
+
+void FusedBeautyFaceUnitFilter::SetHighPassDelta(float delta) {
+  high_pass_delta_ = delta;
+}
+
 }  // namespace gpupixel
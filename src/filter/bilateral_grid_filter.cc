@@ -0,0 +1,656 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+#include "gpupixel/filter/bilateral_grid_filter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "core/gpupixel_context.h"
+#include "utils/logging.h"
+
+namespace gpupixel {
+
+namespace {
+
+const float kGridVertices[] = {
+    -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
+};
+
+// Samples per cell side when splatting, larger cells are subsampled. The
+// bound of the loops in the splat shader.
+const int kMaxSplatSamples = 8;
+
+// The grid is a row-major array of tiles, one per luminance bin, each
+// gridSize cells large. Integer positions are offset by half before
+// dividing, so that rounding cannot move them to the previous tile.
+#if defined(GPUPIXEL_GLES_SHADER)
+// Scatter splat: one point per sample, added into its cell of the nearest
+// bin, so each sample is read once whatever the bin count. The blur across
+// bins then spreads it, like the two-bin split of the gather splat.
+const std::string kBilateralGridScatterVertexShaderString = R"(
+    attribute vec2 sampleIndex;
+    uniform sampler2D inputImageTexture;
+    uniform highp vec2 gridSize;
+    uniform highp float tilesPerRow;
+    uniform highp float binCount;
+    uniform highp float cellSize;
+    uniform highp float sampleCount;
+    uniform highp vec2 imageSize;
+    uniform highp vec2 textureSize;
+    uniform highp vec2 originCoordinate;
+    uniform highp vec2 xAxis;
+    uniform highp vec2 yAxis;
+    varying highp vec4 splatValue;
+
+    void main() {
+      highp vec2 position = (sampleIndex + 0.5) * (cellSize / sampleCount);
+      highp vec2 uv = position / imageSize;
+      highp vec3 color =
+          texture2D(inputImageTexture,
+                    originCoordinate + uv.x * xAxis + uv.y * yAxis)
+              .rgb;
+      highp float depth =
+          dot(color, vec3(0.299, 0.587, 0.114)) * (binCount - 1.0);
+      highp float bin = floor(depth + 0.5);
+      // Samples past the image edge, in the last row or column of cells,
+      // add nothing
+      highp float weight =
+          step(position.x, imageSize.x) * step(position.y, imageSize.y);
+      splatValue =
+          vec4(color * weight, weight) / (sampleCount * sampleCount);
+
+      highp vec2 cell = floor((sampleIndex + 0.5) / sampleCount);
+      highp float row = floor((bin + 0.5) / tilesPerRow);
+      highp vec2 tile = vec2(bin - row * tilesPerRow, row);
+      gl_Position = vec4(
+          (tile * gridSize + cell + 0.5) / textureSize * 2.0 - 1.0, 0.0, 1.0);
+      gl_PointSize = 1.0;
+    })";
+
+const std::string kBilateralGridScatterFragmentShaderString = R"(
+    varying highp vec4 splatValue;
+
+    void main() {
+      gl_FragColor = splatValue;
+    })";
+
+// Gather splat, for contexts that cannot scatter: each cell of each bin
+// reads all the samples of its cell
+const std::string kBilateralGridSplatFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture;
+    uniform highp vec2 gridSize;
+    uniform highp float tilesPerRow;
+    uniform highp float binCount;
+    uniform highp float cellSize;
+    uniform highp float sampleCount;
+    uniform highp vec2 imageSize;
+    uniform highp vec2 originCoordinate;
+    uniform highp vec2 xAxis;
+    uniform highp vec2 yAxis;
+
+    void main() {
+      highp vec2 texel = floor(gl_FragCoord.xy);
+      highp vec2 tile = floor((texel + 0.5) / gridSize);
+      highp vec2 cell = texel - tile * gridSize;
+      highp float bin = tile.y * tilesPerRow + tile.x;
+      highp float spacing = cellSize / sampleCount;
+
+      highp vec4 sum = vec4(0.0);
+      for (int j = 0; j < 8; j++) {
+        if (float(j) >= sampleCount) {
+          break;
+        }
+        for (int i = 0; i < 8; i++) {
+          if (float(i) >= sampleCount) {
+            break;
+          }
+          highp vec2 position =
+              cell * cellSize + (vec2(float(i), float(j)) + 0.5) * spacing;
+          highp vec2 uv = position / imageSize;
+          highp vec3 color =
+              texture2D(inputImageTexture,
+                        originCoordinate + uv.x * xAxis + uv.y * yAxis)
+                  .rgb;
+          highp float depth =
+              dot(color, vec3(0.299, 0.587, 0.114)) * (binCount - 1.0);
+          // Split between the two nearest bins. Samples past the image
+          // edge, in the last row or column of cells, add nothing.
+          highp float weight = max(1.0 - abs(depth - bin), 0.0) *
+                               step(position.x, imageSize.x) *
+                               step(position.y, imageSize.y);
+          sum += vec4(color * weight, weight);
+        }
+      }
+      gl_FragColor = sum / (sampleCount * sampleCount);
+    })";
+
+const std::string kBilateralGridBlurFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture;
+    uniform highp vec2 gridSize;
+    uniform highp float tilesPerRow;
+    uniform highp float binCount;
+    uniform highp vec2 textureSize;
+    uniform highp vec2 cellStep;
+    uniform highp float binStep;
+
+    highp vec4 cellAt(highp vec2 cell, highp float bin) {
+      highp float row = floor((bin + 0.5) / tilesPerRow);
+      highp vec2 tile = vec2(bin - row * tilesPerRow, row);
+      highp vec4 value = texture2D(
+          inputImageTexture, (tile * gridSize + cell + 0.5) / textureSize);
+      // Outside the grid is empty
+      highp vec2 inside = step(vec2(0.0), cell) * step(cell, gridSize - 1.0);
+      return value * inside.x * inside.y * step(0.0, bin) *
+             step(bin, binCount - 1.0);
+    }
+
+    void main() {
+      highp vec2 texel = floor(gl_FragCoord.xy);
+      highp vec2 tile = floor((texel + 0.5) / gridSize);
+      highp vec2 cell = texel - tile * gridSize;
+      highp float bin = tile.y * tilesPerRow + tile.x;
+
+      highp vec4 sum = cellAt(cell, bin) * 6.0;
+      sum += (cellAt(cell - cellStep, bin - binStep) +
+              cellAt(cell + cellStep, bin + binStep)) *
+             4.0;
+      sum += cellAt(cell - cellStep * 2.0, bin - binStep * 2.0) +
+             cellAt(cell + cellStep * 2.0, bin + binStep * 2.0);
+      gl_FragColor = sum / 16.0;
+    })";
+
+const std::string kBilateralGridSliceFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture;
+    uniform sampler2D gridTexture;
+    uniform highp vec2 gridSize;
+    uniform highp float tilesPerRow;
+    uniform highp float binCount;
+    uniform highp vec2 textureSize;
+    uniform highp float cellSize;
+    varying highp vec2 textureCoordinate;
+
+    highp vec4 cellAt(highp vec2 cell, highp float bin) {
+      highp float row = floor((bin + 0.5) / tilesPerRow);
+      highp vec2 tile = vec2(bin - row * tilesPerRow, row);
+      return texture2D(gridTexture,
+                       (tile * gridSize + cell + 0.5) / textureSize);
+    }
+
+    highp vec4 sliceAt(highp vec2 low,
+                       highp vec2 high,
+                       highp vec2 fraction,
+                       highp float bin) {
+      return mix(mix(cellAt(low, bin), cellAt(vec2(high.x, low.y), bin),
+                     fraction.x),
+                 mix(cellAt(vec2(low.x, high.y), bin), cellAt(high, bin),
+                     fraction.x),
+                 fraction.y);
+    }
+
+    void main() {
+      lowp vec4 color = texture2D(inputImageTexture, textureCoordinate);
+      // Cell centers lie half a cell in
+      highp vec2 position = gl_FragCoord.xy / cellSize - 0.5;
+      highp vec2 low = clamp(floor(position), vec2(0.0), gridSize - 1.0);
+      highp vec2 high = min(low + 1.0, gridSize - 1.0);
+      highp vec2 fraction = clamp(position - low, 0.0, 1.0);
+      highp float depth =
+          dot(color.rgb, vec3(0.299, 0.587, 0.114)) * (binCount - 1.0);
+      highp float bin = min(floor(depth), binCount - 2.0);
+      highp vec4 value = mix(sliceAt(low, high, fraction, bin),
+                             sliceAt(low, high, fraction, bin + 1.0),
+                             depth - bin);
+      // Cells that nothing was splatted into keep the input
+      gl_FragColor =
+          vec4(mix(color.rgb, value.rgb / max(value.a, 0.00001),
+                   step(0.00001, value.a)),
+               color.a);
+    })";
+#elif defined(GPUPIXEL_GL_SHADER)
+const std::string kBilateralGridScatterVertexShaderString = R"(
+    attribute vec2 sampleIndex;
+    uniform sampler2D inputImageTexture; uniform vec2 gridSize;
+    uniform float tilesPerRow; uniform float binCount; uniform float cellSize;
+    uniform float sampleCount; uniform vec2 imageSize; uniform vec2 textureSize;
+    uniform vec2 originCoordinate; uniform vec2 xAxis; uniform vec2 yAxis;
+    varying vec4 splatValue;
+
+    void main() {
+      vec2 position = (sampleIndex + 0.5) * (cellSize / sampleCount);
+      vec2 uv = position / imageSize;
+      vec3 color = texture2D(inputImageTexture,
+                             originCoordinate + uv.x * xAxis + uv.y * yAxis)
+                       .rgb;
+      float depth = dot(color, vec3(0.299, 0.587, 0.114)) * (binCount - 1.0);
+      float bin = floor(depth + 0.5);
+      // Samples past the image edge, in the last row or column of cells,
+      // add nothing
+      float weight =
+          step(position.x, imageSize.x) * step(position.y, imageSize.y);
+      splatValue = vec4(color * weight, weight) / (sampleCount * sampleCount);
+
+      vec2 cell = floor((sampleIndex + 0.5) / sampleCount);
+      float row = floor((bin + 0.5) / tilesPerRow);
+      vec2 tile = vec2(bin - row * tilesPerRow, row);
+      gl_Position = vec4(
+          (tile * gridSize + cell + 0.5) / textureSize * 2.0 - 1.0, 0.0, 1.0);
+      gl_PointSize = 1.0;
+    })";
+
+const std::string kBilateralGridScatterFragmentShaderString = R"(
+    varying vec4 splatValue;
+
+    void main() {
+      gl_FragColor = splatValue;
+    })";
+
+const std::string kBilateralGridSplatFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture; uniform vec2 gridSize;
+    uniform float tilesPerRow; uniform float binCount; uniform float cellSize;
+    uniform float sampleCount; uniform vec2 imageSize;
+    uniform vec2 originCoordinate; uniform vec2 xAxis; uniform vec2 yAxis;
+
+    void main() {
+      vec2 texel = floor(gl_FragCoord.xy);
+      vec2 tile = floor((texel + 0.5) / gridSize);
+      vec2 cell = texel - tile * gridSize;
+      float bin = tile.y * tilesPerRow + tile.x;
+      float spacing = cellSize / sampleCount;
+
+      vec4 sum = vec4(0.0);
+      for (int j = 0; j < 8; j++) {
+        if (float(j) >= sampleCount) {
+          break;
+        }
+        for (int i = 0; i < 8; i++) {
+          if (float(i) >= sampleCount) {
+            break;
+          }
+          vec2 position =
+              cell * cellSize + (vec2(float(i), float(j)) + 0.5) * spacing;
+          vec2 uv = position / imageSize;
+          vec3 color = texture2D(inputImageTexture,
+                                 originCoordinate + uv.x * xAxis + uv.y * yAxis)
+                           .rgb;
+          float depth =
+              dot(color, vec3(0.299, 0.587, 0.114)) * (binCount - 1.0);
+          // Split between the two nearest bins. Samples past the image
+          // edge, in the last row or column of cells, add nothing.
+          float weight = max(1.0 - abs(depth - bin), 0.0) *
+                         step(position.x, imageSize.x) *
+                         step(position.y, imageSize.y);
+          sum += vec4(color * weight, weight);
+        }
+      }
+      gl_FragColor = sum / (sampleCount * sampleCount);
+    })";
+
+const std::string kBilateralGridBlurFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture; uniform vec2 gridSize;
+    uniform float tilesPerRow; uniform float binCount; uniform vec2 textureSize;
+    uniform vec2 cellStep; uniform float binStep;
+
+    vec4 cellAt(vec2 cell, float bin) {
+      float row = floor((bin + 0.5) / tilesPerRow);
+      vec2 tile = vec2(bin - row * tilesPerRow, row);
+      vec4 value = texture2D(inputImageTexture,
+                             (tile * gridSize + cell + 0.5) / textureSize);
+      // Outside the grid is empty
+      vec2 inside = step(vec2(0.0), cell) * step(cell, gridSize - 1.0);
+      return value * inside.x * inside.y * step(0.0, bin) *
+             step(bin, binCount - 1.0);
+    }
+
+    void main() {
+      vec2 texel = floor(gl_FragCoord.xy);
+      vec2 tile = floor((texel + 0.5) / gridSize);
+      vec2 cell = texel - tile * gridSize;
+      float bin = tile.y * tilesPerRow + tile.x;
+
+      vec4 sum = cellAt(cell, bin) * 6.0;
+      sum += (cellAt(cell - cellStep, bin - binStep) +
+              cellAt(cell + cellStep, bin + binStep)) *
+             4.0;
+      sum += cellAt(cell - cellStep * 2.0, bin - binStep * 2.0) +
+             cellAt(cell + cellStep * 2.0, bin + binStep * 2.0);
+      gl_FragColor = sum / 16.0;
+    })";
+
+const std::string kBilateralGridSliceFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture; uniform sampler2D gridTexture;
+    uniform vec2 gridSize; uniform float tilesPerRow; uniform float binCount;
+    uniform vec2 textureSize; uniform float cellSize;
+    varying vec2 textureCoordinate;
+
+    vec4 cellAt(vec2 cell, float bin) {
+      float row = floor((bin + 0.5) / tilesPerRow);
+      vec2 tile = vec2(bin - row * tilesPerRow, row);
+      return texture2D(gridTexture,
+                       (tile * gridSize + cell + 0.5) / textureSize);
+    }
+
+    vec4 sliceAt(vec2 low, vec2 high, vec2 fraction, float bin) {
+      return mix(mix(cellAt(low, bin), cellAt(vec2(high.x, low.y), bin),
+                     fraction.x),
+                 mix(cellAt(vec2(low.x, high.y), bin), cellAt(high, bin),
+                     fraction.x),
+                 fraction.y);
+    }
+
+    void main() {
+      vec4 color = texture2D(inputImageTexture, textureCoordinate);
+      // Cell centers lie half a cell in
+      vec2 position = gl_FragCoord.xy / cellSize - 0.5;
+      vec2 low = clamp(floor(position), vec2(0.0), gridSize - 1.0);
+      vec2 high = min(low + 1.0, gridSize - 1.0);
+      vec2 fraction = clamp(position - low, 0.0, 1.0);
+      float depth =
+          dot(color.rgb, vec3(0.299, 0.587, 0.114)) * (binCount - 1.0);
+      float bin = min(floor(depth), binCount - 2.0);
+      vec4 value = mix(sliceAt(low, high, fraction, bin),
+                       sliceAt(low, high, fraction, bin + 1.0), depth - bin);
+      // Cells that nothing was splatted into keep the input
+      gl_FragColor =
+          vec4(mix(color.rgb, value.rgb / max(value.a, 0.00001),
+                   step(0.00001, value.a)),
+               color.a);
+    })";
+#endif
+
+// Scattering reads the input in the vertex shader and adds into float
+// framebuffers, which GLES only does with EXT_float_blend
+bool SupportsScatterSplat() {
+  GLint vertex_texture_units = 0;
+  GL_CALL(glGetIntegerv(GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS,
+                        &vertex_texture_units));
+  if (vertex_texture_units < 1) {
+    return false;
+  }
+#if defined(GPUPIXEL_GLES_SHADER)
+  const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+  return extensions && strstr(extensions, "GL_EXT_float_blend");
+#else
+  return true;
+#endif
+}
+
+}  // namespace
+
+BilateralGridFilter::BilateralGridFilter()
+    : spatial_sigma_(8.0),
+      range_sigma_(0.125),
+      scatter_program_(0),
+      splat_program_(0),
+      blur_program_(0),
+      splat_points_(0),
+      splat_points_width_(0),
+      splat_points_height_(0) {}
+
+BilateralGridFilter::~BilateralGridFilter() {
+  if (splat_points_) {
+    context_->SyncRunWithContext(
+        [this] { GL_CALL(glDeleteBuffers(1, &splat_points_)); });
+    splat_points_ = 0;
+  }
+  if (scatter_program_) {
+    delete scatter_program_;
+    scatter_program_ = 0;
+  }
+  if (splat_program_) {
+    delete splat_program_;
+    splat_program_ = 0;
+  }
+  if (blur_program_) {
+    delete blur_program_;
+    blur_program_ = 0;
+  }
+}
+
+std::shared_ptr<BilateralGridFilter> BilateralGridFilter::Create(
+    float spatial_sigma /* = 8.0*/,
+    float range_sigma /* = 0.125*/) {
+  auto ret = std::shared_ptr<BilateralGridFilter>(new BilateralGridFilter());
+  gpupixel::GPUPixelContext::GetInstance()->SyncRunWithContext([&] {
+    if (ret && !ret->Init(spatial_sigma, range_sigma)) {
+      ret.reset();
+    }
+  });
+  return ret;
+}
+
+bool BilateralGridFilter::Init(float spatial_sigma, float range_sigma) {
+  if (!GPUPixelContext::GetInstance()->SupportsFloatFramebuffers()) {
+    LOG_WARN("BilateralGridFilter: float framebuffers are unsupported");
+    return false;
+  }
+  // Slicing draws the output through Filter::DoRender
+  if (!InitWithFragmentShaderString(kBilateralGridSliceFragmentShaderString)) {
+    return false;
+  }
+  if (SupportsScatterSplat()) {
+    scatter_program_ = GPUPixelGLProgram::CreateWithShaderString(
+        kBilateralGridScatterVertexShaderString,
+        kBilateralGridScatterFragmentShaderString);
+  }
+  if (!scatter_program_) {
+    splat_program_ = GPUPixelGLProgram::CreateWithShaderString(
+        kDefaultVertexShader, kBilateralGridSplatFragmentShaderString);
+  }
+  blur_program_ = GPUPixelGLProgram::CreateWithShaderString(
+      kDefaultVertexShader, kBilateralGridBlurFragmentShaderString);
+  if ((!scatter_program_ && !splat_program_) || !blur_program_) {
+    return false;
+  }
+
+  SetSpatialSigma(spatial_sigma);
+  SetRangeSigma(range_sigma);
+  RegisterProperty("spatialSigma", spatial_sigma_,
+                   "Standard deviation of the blur in pixels",
+                   [this](float& sigma) { SetSpatialSigma(sigma); });
+  RegisterProperty("rangeSigma", range_sigma_,
+                   "Luminance difference between 0 and 1 across which colors "
+                   "still mix",
+                   [this](float& sigma) { SetRangeSigma(sigma); });
+  return true;
+}
+
+void BilateralGridFilter::SetSpatialSigma(float sigma) {
+  if (sigma == spatial_sigma_) {
+    return;
+  }
+  spatial_sigma_ = sigma;
+  MarkDirty();
+}
+
+void BilateralGridFilter::SetRangeSigma(float sigma) {
+  if (sigma == range_sigma_) {
+    return;
+  }
+  range_sigma_ = sigma;
+  MarkDirty();
+}
+
+// The 5-tap binomial blur of the grid has a standard deviation of one cell
+int BilateralGridFilter::GetCellSize() const {
+  return std::max((int)std::lround(spatial_sigma_), kMinCellSize);
+}
+
+// One bin per range sigma
+int BilateralGridFilter::GetBinCount() const {
+  if (range_sigma_ <= 0.0) {
+    return kMaxBins;
+  }
+  return std::min(std::max((int)std::ceil(1.0 / range_sigma_) + 1, 2),
+                  kMaxBins);
+}
+
+bool BilateralGridFilter::DoRender(bool updateSinks) {
+  InputFrameBufferInfo& input = input_framebuffers_.begin()->second;
+  int width = framebuffer_->GetWidth();
+  int height = framebuffer_->GetHeight();
+  int cell_size = GetCellSize();
+  int bins = GetBinCount();
+  int grid_width = (width + cell_size - 1) / cell_size;
+  int grid_height = (height + cell_size - 1) / cell_size;
+  int tiles_per_row = (int)std::ceil(std::sqrt((float)bins));
+  int tile_rows = (bins + tiles_per_row - 1) / tiles_per_row;
+  int texture_width = grid_width * tiles_per_row;
+  int texture_height = grid_height * tile_rows;
+
+  bool resized = false;
+  for (auto& grid : grids_) {
+    if (!grid || grid->GetWidth() != texture_width ||
+        grid->GetHeight() != texture_height) {
+      grid = GPUPixelContext::GetInstance()
+                 ->GetFramebufferFactory()
+                 ->CreateFramebuffer(
+                     texture_width, texture_height, false,
+                     GPUPixelFramebuffer::float_texture_attributes);
+      resized = true;
+    }
+  }
+
+  Vector2 grid_size(grid_width, grid_height);
+  Vector2 texture_size(texture_width, texture_height);
+  // Only the input and the grid shape, not the output, which may be a new
+  // transient framebuffer every frame
+  std::vector<uint64_t> signature = {input.frame_buffer->GetContentVersion(),
+                                     (uint64_t)input.rotation_mode,
+                                     (uint64_t)cell_size, (uint64_t)bins};
+  if (resized || signature != grid_signature_) {
+    // The splat reads the input in the orientation of the output
+    const float* texture_coordinate = GetTextureCoordinate(input.rotation_mode);
+    int samples = std::min(cell_size, kMaxSplatSamples);
+    GPUPixelGLProgram* splat =
+        scatter_program_ ? scatter_program_ : splat_program_;
+    splat->SetUniformValue("gridSize", grid_size);
+    splat->SetUniformValue("tilesPerRow", (float)tiles_per_row);
+    splat->SetUniformValue("binCount", (float)bins);
+    splat->SetUniformValue("cellSize", (float)cell_size);
+    splat->SetUniformValue("sampleCount", (float)samples);
+    splat->SetUniformValue("imageSize", Vector2(width, height));
+    splat->SetUniformValue(
+        "originCoordinate",
+        Vector2(texture_coordinate[0], texture_coordinate[1]));
+    splat->SetUniformValue(
+        "xAxis", Vector2(texture_coordinate[2] - texture_coordinate[0],
+                         texture_coordinate[3] - texture_coordinate[1]));
+    splat->SetUniformValue(
+        "yAxis", Vector2(texture_coordinate[4] - texture_coordinate[0],
+                         texture_coordinate[5] - texture_coordinate[1]));
+    if (scatter_program_) {
+      scatter_program_->SetUniformValue("textureSize", texture_size);
+      RenderScatterSplat(input.frame_buffer, grid_width * samples,
+                         grid_height * samples);
+    } else {
+      RenderGridPass(splat_program_, input.frame_buffer, grids_[0]);
+    }
+
+    // Across cells, then across bins
+    blur_program_->SetUniformValue("gridSize", grid_size);
+    blur_program_->SetUniformValue("tilesPerRow", (float)tiles_per_row);
+    blur_program_->SetUniformValue("binCount", (float)bins);
+    blur_program_->SetUniformValue("textureSize", texture_size);
+    blur_program_->SetUniformValue("cellStep", Vector2(1.0, 0.0));
+    blur_program_->SetUniformValue("binStep", 0.0f);
+    RenderGridPass(blur_program_, grids_[0], grids_[1]);
+    blur_program_->SetUniformValue("cellStep", Vector2(0.0, 1.0));
+    RenderGridPass(blur_program_, grids_[1], grids_[0]);
+    blur_program_->SetUniformValue("cellStep", Vector2(0.0, 0.0));
+    blur_program_->SetUniformValue("binStep", 1.0f);
+    RenderGridPass(blur_program_, grids_[0], grids_[1]);
+    grid_signature_ = signature;
+  }
+
+  // Single input, so unit 1 is free for the grid
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  gl_state->BindTexture(GL_TEXTURE1, grids_[1]->GetTexture());
+  filter_program_->SetUniformValue("gridTexture", 1);
+  filter_program_->SetUniformValue("gridSize", grid_size);
+  filter_program_->SetUniformValue("tilesPerRow", (float)tiles_per_row);
+  filter_program_->SetUniformValue("binCount", (float)bins);
+  filter_program_->SetUniformValue("textureSize", texture_size);
+  filter_program_->SetUniformValue("cellSize", (float)cell_size);
+  Filter::DoRender(false);
+  return Source::DoRender(updateSinks);
+}
+
+void BilateralGridFilter::RenderScatterSplat(
+    const std::shared_ptr<GPUPixelFramebuffer>& source,
+    int points_width,
+    int points_height) {
+  if (!splat_points_) {
+    GL_CALL(glGenBuffers(1, &splat_points_));
+  }
+  GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, splat_points_));
+  if (points_width != splat_points_width_ ||
+      points_height != splat_points_height_) {
+    // The sample indices along x and y, one point per sample
+    std::vector<uint16_t> points;
+    points.reserve((size_t)points_width * points_height * 2);
+    for (int y = 0; y < points_height; y++) {
+      for (int x = 0; x < points_width; x++) {
+        points.push_back((uint16_t)x);
+        points.push_back((uint16_t)y);
+      }
+    }
+    GL_CALL(glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(uint16_t),
+                         points.data(), GL_STATIC_DRAW));
+    splat_points_width_ = points_width;
+    splat_points_height_ = points_height;
+  }
+
+  GPUPixelContext::GetInstance()->SetActiveGlProgram(scatter_program_);
+  grids_[0]->Activate();
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  gl_state->ClearColor(0.0, 0.0, 0.0, 0.0);
+  GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
+  gl_state->BindTexture(GL_TEXTURE0, source->GetTexture());
+  scatter_program_->SetUniformValue(
+      scatter_program_->GetInputTextureUniform(0), 0);
+
+  uint32_t point_attribute = scatter_program_->GetAttribLocation("sampleIndex");
+  gl_state->EnableVertexAttribArray(point_attribute);
+  GL_CALL(glVertexAttribPointer(point_attribute, 2, GL_UNSIGNED_SHORT,
+                                GL_FALSE, 0, 0));
+  GL_CALL(glEnable(GL_BLEND));
+  GL_CALL(glBlendFunc(GL_ONE, GL_ONE));
+  GL_CALL(glDrawArrays(GL_POINTS, 0, points_width * points_height));
+  GL_CALL(glDisable(GL_BLEND));
+  // Other passes draw from client-side arrays
+  GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+  grids_[0]->Deactivate();
+  GPUPixelContext::GetInstance()->CountPass(false);
+}
+
+void BilateralGridFilter::RenderGridPass(
+    GPUPixelGLProgram* program,
+    const std::shared_ptr<GPUPixelFramebuffer>& source,
+    const std::shared_ptr<GPUPixelFramebuffer>& target) {
+  GPUPixelContext::GetInstance()->SetActiveGlProgram(program);
+  target->Activate();
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  gl_state->BindTexture(GL_TEXTURE0, source->GetTexture());
+  program->SetUniformValue(program->GetInputTextureUniform(0), 0);
+
+  uint32_t position_attribute = program->GetAttribLocation("position");
+  uint32_t tex_coord_attribute = program->GetInputTexCoordAttribute(0);
+  gl_state->EnableVertexAttribArray(position_attribute);
+  GL_CALL(glVertexAttribPointer(position_attribute, 2, GL_FLOAT, 0, 0,
+                                kGridVertices));
+  // The grid passes address texels by gl_FragCoord, so it may be unused
+  if (tex_coord_attribute != (uint32_t)-1) {
+    gl_state->EnableVertexAttribArray(tex_coord_attribute);
+    GL_CALL(glVertexAttribPointer(tex_coord_attribute, 2, GL_FLOAT, 0, 0,
+                                  GetTextureCoordinate(NoRotation)));
+  }
+  GL_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+  target->Deactivate();
+  GPUPixelContext::GetInstance()->CountPass(false);
+}
+
+}  // namespace gpupixel
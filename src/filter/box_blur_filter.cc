@@ -10,7 +10,13 @@
 namespace gpupixel {
 
 BoxBlurFilter::BoxBlurFilter()
-    : horizontal_blur_filter_(nullptr), vertical_blur_filter_(nullptr) {}
+    : radius_(4),
+      texel_spacing_(1.0),
+      processing_scale_(1.0),
+      horizontal_blur_filter_(nullptr),
+      vertical_blur_filter_(nullptr),
+      table_blur_filter_(nullptr),
+      backend_(SEPARABLE) {}
 
 BoxBlurFilter::~BoxBlurFilter() {}
 
@@ -41,12 +47,20 @@ bool BoxBlurFilter::Init(int radius, float sigma) {
 
   RegisterProperty("sigma", 0.0, "", [this](float& sigma) { setSigma(sigma); });
 
+  RegisterProperty("backend", (int)SEPARABLE,
+                   "0 for separable passes, 1 for a summed-area table",
+                   [this](int& backend) { SetBackend((Backend)backend); });
+
   return true;
 }
 
 void BoxBlurFilter::SetRadius(int radius) {
+  radius_ = radius;
   horizontal_blur_filter_->SetRadius(radius);
   vertical_blur_filter_->SetRadius(radius);
+  if (table_blur_filter_) {
+    table_blur_filter_->SetRadius(GetTableRadius());
+  }
 }
 
 void BoxBlurFilter::setSigma(float sigma) {
@@ -55,8 +69,55 @@ void BoxBlurFilter::setSigma(float sigma) {
 }
 
 void BoxBlurFilter::SetTexelSpacingMultiplier(float value) {
-  horizontal_blur_filter_->SetTexelSpacingMultiplier(value);
-  vertical_blur_filter_->SetTexelSpacingMultiplier(value);
+  texel_spacing_ = value;
+  // Spacing is in texels of the output, which shrink with the scale
+  horizontal_blur_filter_->SetTexelSpacingMultiplier(value * processing_scale_);
+  vertical_blur_filter_->SetTexelSpacingMultiplier(value * processing_scale_);
+  if (table_blur_filter_) {
+    table_blur_filter_->SetRadius(GetTableRadius());
+  }
+}
+
+void BoxBlurFilter::SetProcessingScale(float scale) {
+  processing_scale_ = scale;
+  horizontal_blur_filter_->SetFramebufferScale(scale);
+  if (table_blur_filter_) {
+    table_blur_filter_->SetFramebufferScale(scale);
+  }
+  SetTexelSpacingMultiplier(texel_spacing_);
+}
+
+void BoxBlurFilter::SetBackend(Backend backend) {
+  if (backend == backend_) {
+    return;
+  }
+  if (backend == SUMMED_AREA_TABLE && !table_blur_filter_) {
+    table_blur_filter_ = SummedAreaTableBlurFilter::Create(GetTableRadius());
+    if (!table_blur_filter_) {
+      return;
+    }
+    table_blur_filter_->SetFramebufferScale(processing_scale_);
+  }
+  backend_ = backend;
+
+  // The sinks move over to the new terminal filter
+  std::map<std::shared_ptr<Sink>, int> sinks = terminal_filter_->GetSinks();
+  terminal_filter_->RemoveAllSinks();
+  RemoveAllFilters();
+  if (backend_ == SUMMED_AREA_TABLE) {
+    AddFilter(table_blur_filter_);
+  } else {
+    AddFilter(horizontal_blur_filter_);
+  }
+  for (auto& sink : sinks) {
+    terminal_filter_->AddSink(sink.first, sink.second);
+  }
+}
+
+// The separable passes sample radius_ texels on each side, texel_spacing_
+// output texels apart
+float BoxBlurFilter::GetTableRadius() const {
+  return radius_ * texel_spacing_ * processing_scale_;
 }
 
 }  // namespace gpupixel
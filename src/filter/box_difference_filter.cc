@@ -90,28 +90,27 @@ bool BoxDifferenceFilter::DoRender(bool updateSinks) {
 
   GPUPixelContext::GetInstance()->SetActiveGlProgram(filter_program_);
   framebuffer_->Activate();
-  GL_CALL(glClearColor(background_color_.r, background_color_.g,
-                       background_color_.b, background_color_.a));
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  gl_state->ClearColor(background_color_.r, background_color_.g,
+                       background_color_.b, background_color_.a);
   GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
 
   // Texture 0
-  GL_CALL(glActiveTexture(GL_TEXTURE0));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D,
-                        input_framebuffers_[0].frame_buffer->GetTexture()));
+  gl_state->BindTexture(GL_TEXTURE0,
+                        input_framebuffers_[0].frame_buffer->GetTexture());
   filter_program_->SetUniformValue("inputImageTexture", 0);
 
   // Texture 1
-  GL_CALL(glActiveTexture(GL_TEXTURE1));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D,
-                        input_framebuffers_[1].frame_buffer->GetTexture()));
+  gl_state->BindTexture(GL_TEXTURE1,
+                        input_framebuffers_[1].frame_buffer->GetTexture());
   filter_program_->SetUniformValue("inputImageTexture2", 1);
 
-  GL_CALL(glEnableVertexAttribArray(filter_texture_coordinate_attribute_));
+  gl_state->EnableVertexAttribArray(filter_texture_coordinate_attribute_);
   GL_CALL(glVertexAttribPointer(
       filter_texture_coordinate_attribute_, 2, GL_FLOAT, 0, 0,
       GetTextureCoordinate(input_framebuffers_[0].rotation_mode)));
 
-  GL_CALL(glEnableVertexAttribArray(filter_texture_coordinate_attribute2_));
+  gl_state->EnableVertexAttribArray(filter_texture_coordinate_attribute2_);
   GL_CALL(glVertexAttribPointer(
       filter_texture_coordinate_attribute2_, 2, GL_FLOAT, 0, 0,
       GetTextureCoordinate(input_framebuffers_[1].rotation_mode)));
@@ -58,4 +58,14 @@ void BoxHighPassFilter::SetDelta(float delta) {
   box_difference_filter_->SetDelta(delta);
 }
 
+void BoxHighPassFilter::SetProcessingScale(float scale) {
+  box_blur_filter_->SetProcessingScale(scale);
+  // Sized after the full-size input, sampling the blur bilinearly
+  box_difference_filter_->SetFramebufferScale(scale);
+}
+
+void BoxHighPassFilter::SetBlurBackend(BoxBlurFilter::Backend backend) {
+  box_blur_filter_->SetBackend(backend);
+}
+
 }  // namespace gpupixel
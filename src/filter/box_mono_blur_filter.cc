@@ -29,12 +29,7 @@ std::shared_ptr<BoxMonoBlurFilter> BoxMonoBlurFilter::Create(Type type,
 }
 
 bool BoxMonoBlurFilter::Init(int radius, float sigma) {
-  if (Filter::InitWithShaderString(
-          GenerateOptimizedVertexShaderString(radius, sigma),
-          GenerateOptimizedFragmentShaderString(radius, sigma))) {
-    return true;
-  }
-  return false;
+  return GaussianBlurMonoFilter::Init(radius, sigma);
 }
 
 void BoxMonoBlurFilter::SetRadius(int radius) {
@@ -43,13 +38,28 @@ void BoxMonoBlurFilter::SetRadius(int radius) {
 
   if (newBlurRadius != radius_) {
     radius_ = newBlurRadius;
+    sigma_ = 0.0;
+    UpdateProgram();
+  }
+}
 
-    if (filter_program_) {
-      delete filter_program_;
-      filter_program_ = 0;
-    }
-    InitWithShaderString(GenerateOptimizedVertexShaderString(radius_, 0.0),
-                         GenerateOptimizedFragmentShaderString(radius_, 0.0));
+void BoxMonoBlurFilter::GetSampleWeights(int radius,
+                                         float /*sigma*/,
+                                         float& center_weight,
+                                         std::vector<float>& offsets,
+                                         std::vector<float>& weights) {
+  offsets.clear();
+  weights.clear();
+  if (radius < 1) {
+    center_weight = 1.0;
+    return;
+  }
+
+  float box_weight = 1.0 / (float)((radius * 2) + 1);
+  center_weight = box_weight;
+  for (int i = 0; i < radius / 2 + (radius % 2); ++i) {
+    offsets.push_back((float)(i * 2) + 1.5);
+    weights.push_back(box_weight * 2.0);
   }
 }
 
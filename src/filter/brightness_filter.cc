@@ -67,4 +67,17 @@ bool BrightnessFilter::DoRender(bool updateSinks) {
   return Filter::DoRender(updateSinks);
 }
 
+bool BrightnessFilter::GetColorStage(ColorStage& stage) const {
+  stage.uniforms = R"(
+      uniform float $brightness_factor;)";
+  stage.code = R"(
+      color.rgb += vec3($brightness_factor);)";
+  return true;
+}
+
+void BrightnessFilter::SetColorStageUniforms(GPUPixelGLProgram* program,
+                                             const std::string& prefix) {
+  program->SetUniformValue(prefix + "brightness_factor", brightness_factor_);
+}
+
 }  // namespace gpupixel
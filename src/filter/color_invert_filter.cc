@@ -9,6 +9,7 @@
 #include "core/gpupixel_context.h"
 namespace gpupixel {
 
+#if defined(GPUPIXEL_GLES_SHADER)
 const std::string kColorInvertFragmentShaderString = R"(
 
     uniform sampler2D inputImageTexture; varying highp vec2 textureCoordinate;
@@ -17,6 +18,16 @@ const std::string kColorInvertFragmentShaderString = R"(
       lowp vec4 color = texture2D(inputImageTexture, textureCoordinate);
       gl_FragColor = vec4((1.0 - color.rgb), color.a);
     })";
+#elif defined(GPUPIXEL_GL_SHADER)
+const std::string kColorInvertFragmentShaderString = R"(
+
+    uniform sampler2D inputImageTexture; varying vec2 textureCoordinate;
+
+    void main() {
+      vec4 color = texture2D(inputImageTexture, textureCoordinate);
+      gl_FragColor = vec4((1.0 - color.rgb), color.a);
+    })";
+#endif
 
 std::shared_ptr<ColorInvertFilter> ColorInvertFilter::Create() {
   auto ret = std::shared_ptr<ColorInvertFilter>(new ColorInvertFilter());
@@ -39,4 +50,10 @@ bool ColorInvertFilter::DoRender(bool updateSinks) {
   return Filter::DoRender(updateSinks);
 }
 
+bool ColorInvertFilter::GetColorStage(ColorStage& stage) const {
+  stage.code = R"(
+      color.rgb = 1.0 - color.rgb;)";
+  return true;
+}
+
 }  // namespace gpupixel
@@ -80,4 +80,19 @@ bool ColorMatrixFilter::DoRender(bool updateSinks) {
   return Filter::DoRender(updateSinks);
 }
 
+bool ColorMatrixFilter::GetColorStage(ColorStage& stage) const {
+  stage.uniforms = R"(
+      uniform mat4 $colorMatrix; uniform float $intensity;)";
+  stage.code = R"(
+      color = mix(color, color * $colorMatrix, $intensity);)";
+  stage.bakeable = false;
+  return true;
+}
+
+void ColorMatrixFilter::SetColorStageUniforms(GPUPixelGLProgram* program,
+                                              const std::string& prefix) {
+  program->SetUniformValue(prefix + "intensity", intensity_factor_);
+  program->SetUniformValue(prefix + "colorMatrix", color_matrix_);
+}
+
 }  // namespace gpupixel
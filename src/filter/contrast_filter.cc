@@ -9,6 +9,7 @@
 #include "core/gpupixel_context.h"
 namespace gpupixel {
 
+#if defined(GPUPIXEL_GLES_SHADER)
 const std::string kContrastFragmentShaderString = R"(
     uniform sampler2D inputImageTexture; uniform lowp float contrast;
     varying highp vec2 textureCoordinate;
@@ -18,6 +19,17 @@ const std::string kContrastFragmentShaderString = R"(
       gl_FragColor =
           vec4(((color.rgb - vec3(0.5)) * contrast + vec3(0.5)), color.a);
     })";
+#elif defined(GPUPIXEL_GL_SHADER)
+const std::string kContrastFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture; uniform float contrast;
+    varying vec2 textureCoordinate;
+
+    void main() {
+      vec4 color = texture2D(inputImageTexture, textureCoordinate);
+      gl_FragColor =
+          vec4(((color.rgb - vec3(0.5)) * contrast + vec3(0.5)), color.a);
+    })";
+#endif
 
 std::shared_ptr<ContrastFilter> ContrastFilter::Create() {
   auto ret = std::shared_ptr<ContrastFilter>(new ContrastFilter());
@@ -57,4 +69,17 @@ bool ContrastFilter::DoRender(bool updateSinks) {
   return Filter::DoRender(updateSinks);
 }
 
+bool ContrastFilter::GetColorStage(ColorStage& stage) const {
+  stage.uniforms = R"(
+      uniform float $contrast;)";
+  stage.code = R"(
+      color.rgb = (color.rgb - vec3(0.5)) * $contrast + vec3(0.5);)";
+  return true;
+}
+
+void ContrastFilter::SetColorStageUniforms(GPUPixelGLProgram* program,
+                                           const std::string& prefix) {
+  program->SetUniformValue(prefix + "contrast", contrast_factor_);
+}
+
 }  // namespace gpupixel
@@ -0,0 +1,275 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+#include "gpupixel/filter/dual_kawase_blur_filter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "core/gpupixel_context.h"
+
+namespace gpupixel {
+
+namespace {
+
+const float kPyramidVertices[] = {
+    -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
+};
+
+// Beyond this the taps of a level no longer overlap and the blur turns
+// blocky, so larger sigmas need a deeper pyramid instead
+const float kMaxOffset = 3.0;
+
+#if defined(GPUPIXEL_GLES_SHADER)
+const std::string kDualKawaseDownFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture;
+    uniform highp vec2 halfTexel;
+    varying highp vec2 textureCoordinate;
+
+    void main() {
+      mediump vec4 sum = texture2D(inputImageTexture, textureCoordinate) * 4.0;
+      sum += texture2D(inputImageTexture, textureCoordinate - halfTexel);
+      sum += texture2D(inputImageTexture, textureCoordinate + halfTexel);
+      sum += texture2D(inputImageTexture,
+                       textureCoordinate + vec2(halfTexel.x, -halfTexel.y));
+      sum += texture2D(inputImageTexture,
+                       textureCoordinate - vec2(halfTexel.x, -halfTexel.y));
+      gl_FragColor = sum * 0.125;
+    })";
+
+const std::string kDualKawaseUpFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture;
+    uniform highp vec2 halfTexel;
+    varying highp vec2 textureCoordinate;
+
+    void main() {
+      mediump vec4 sum = texture2D(inputImageTexture,
+                                   textureCoordinate +
+                                       vec2(-halfTexel.x * 2.0, 0.0));
+      sum += texture2D(inputImageTexture,
+                       textureCoordinate + vec2(-halfTexel.x, halfTexel.y)) *
+             2.0;
+      sum += texture2D(inputImageTexture,
+                       textureCoordinate + vec2(0.0, halfTexel.y * 2.0));
+      sum += texture2D(inputImageTexture, textureCoordinate + halfTexel) * 2.0;
+      sum += texture2D(inputImageTexture,
+                       textureCoordinate + vec2(halfTexel.x * 2.0, 0.0));
+      sum += texture2D(inputImageTexture,
+                       textureCoordinate + vec2(halfTexel.x, -halfTexel.y)) *
+             2.0;
+      sum += texture2D(inputImageTexture,
+                       textureCoordinate + vec2(0.0, -halfTexel.y * 2.0));
+      sum += texture2D(inputImageTexture, textureCoordinate - halfTexel) * 2.0;
+      gl_FragColor = sum / 12.0;
+    })";
+#elif defined(GPUPIXEL_GL_SHADER)
+const std::string kDualKawaseDownFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture; uniform vec2 halfTexel;
+    varying vec2 textureCoordinate;
+
+    void main() {
+      vec4 sum = texture2D(inputImageTexture, textureCoordinate) * 4.0;
+      sum += texture2D(inputImageTexture, textureCoordinate - halfTexel);
+      sum += texture2D(inputImageTexture, textureCoordinate + halfTexel);
+      sum += texture2D(inputImageTexture,
+                       textureCoordinate + vec2(halfTexel.x, -halfTexel.y));
+      sum += texture2D(inputImageTexture,
+                       textureCoordinate - vec2(halfTexel.x, -halfTexel.y));
+      gl_FragColor = sum * 0.125;
+    })";
+
+const std::string kDualKawaseUpFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture; uniform vec2 halfTexel;
+    varying vec2 textureCoordinate;
+
+    void main() {
+      vec4 sum = texture2D(inputImageTexture,
+                           textureCoordinate + vec2(-halfTexel.x * 2.0, 0.0));
+      sum += texture2D(inputImageTexture,
+                       textureCoordinate + vec2(-halfTexel.x, halfTexel.y)) *
+             2.0;
+      sum += texture2D(inputImageTexture,
+                       textureCoordinate + vec2(0.0, halfTexel.y * 2.0));
+      sum += texture2D(inputImageTexture, textureCoordinate + halfTexel) * 2.0;
+      sum += texture2D(inputImageTexture,
+                       textureCoordinate + vec2(halfTexel.x * 2.0, 0.0));
+      sum += texture2D(inputImageTexture,
+                       textureCoordinate + vec2(halfTexel.x, -halfTexel.y)) *
+             2.0;
+      sum += texture2D(inputImageTexture,
+                       textureCoordinate + vec2(0.0, -halfTexel.y * 2.0));
+      sum += texture2D(inputImageTexture, textureCoordinate - halfTexel) * 2.0;
+      gl_FragColor = sum / 12.0;
+    })";
+#endif
+
+// Number of levels and tap offset, in texels of each pass's source, that
+// approximate sigma. With n levels, the down and up passes together spread
+// a pixel with a variance of about (4^n - 1) / 3 * (1.46 * offset^2 + 1)
+// pixels squared, so each level added quadruples it.
+void GetPyramidShape(float sigma, int max_levels, int& levels, float& offset) {
+  float variance = sigma * sigma;
+  levels = 1;
+  while (levels < max_levels &&
+         (std::pow(4.0, levels + 1) - 1) / 3 * 2.46 <= variance) {
+    levels++;
+  }
+  float scale = 3 * variance / (std::pow(4.0, levels) - 1);
+  offset = std::sqrt(std::max(scale - 1, 0.0f) / 1.46);
+  offset = std::min(offset, kMaxOffset);
+}
+
+}  // namespace
+
+DualKawaseBlurFilter::DualKawaseBlurFilter()
+    : sigma_(2.0), down_program_(0), up_program_(0) {}
+
+DualKawaseBlurFilter::~DualKawaseBlurFilter() {
+  if (down_program_) {
+    delete down_program_;
+    down_program_ = 0;
+  }
+  if (up_program_) {
+    delete up_program_;
+    up_program_ = 0;
+  }
+}
+
+std::shared_ptr<DualKawaseBlurFilter> DualKawaseBlurFilter::Create(
+    float sigma /* = 2.0*/) {
+  auto ret = std::shared_ptr<DualKawaseBlurFilter>(new DualKawaseBlurFilter());
+  gpupixel::GPUPixelContext::GetInstance()->SyncRunWithContext([&] {
+    if (ret && !ret->Init(sigma)) {
+      ret.reset();
+    }
+  });
+  return ret;
+}
+
+bool DualKawaseBlurFilter::Init(float sigma) {
+  // The last upsampling pass draws the output through Filter::DoRender
+  if (!InitWithFragmentShaderString(kDualKawaseUpFragmentShaderString)) {
+    return false;
+  }
+  down_program_ = GPUPixelGLProgram::CreateWithShaderString(
+      kDefaultVertexShader, kDualKawaseDownFragmentShaderString);
+  up_program_ = GPUPixelGLProgram::CreateWithShaderString(
+      kDefaultVertexShader, kDualKawaseUpFragmentShaderString);
+  if (!down_program_ || !up_program_) {
+    return false;
+  }
+
+  SetSigma(sigma);
+  RegisterProperty("sigma", sigma_,
+                   "Standard deviation in pixels of the Gaussian blur to "
+                   "approximate",
+                   [this](float& sigma) { SetSigma(sigma); });
+  return true;
+}
+
+void DualKawaseBlurFilter::SetSigma(float sigma) {
+  if (sigma == sigma_) {
+    return;
+  }
+  sigma_ = sigma;
+  MarkDirty();
+}
+
+bool DualKawaseBlurFilter::DoRender(bool updateSinks) {
+  InputFrameBufferInfo& input = input_framebuffers_.begin()->second;
+  int width = framebuffer_->GetWidth();
+  int height = framebuffer_->GetHeight();
+
+  // The smallest level keeps at least 2 pixels on its short side
+  int max_levels = 1;
+  while (max_levels < kMaxLevels &&
+         std::min(width, height) >> (max_levels + 1) >= 2) {
+    max_levels++;
+  }
+  int levels;
+  float offset;
+  GetPyramidShape(sigma_, max_levels, levels, offset);
+
+  bool resized = (int)levels_.size() != levels;
+  levels_.resize(levels);
+  for (int i = 0; i < levels; i++) {
+    int level_width = std::max(width >> (i + 1), 1);
+    int level_height = std::max(height >> (i + 1), 1);
+    if (!levels_[i] || levels_[i]->GetWidth() != level_width ||
+        levels_[i]->GetHeight() != level_height) {
+      levels_[i] = GPUPixelContext::GetInstance()
+                       ->GetFramebufferFactory()
+                       ->CreateFramebuffer(level_width, level_height);
+      resized = true;
+    }
+  }
+
+  // Only the input and the pyramid shape, not the output, which may be a
+  // new transient framebuffer every frame
+  uint32_t offset_bits;
+  memcpy(&offset_bits, &offset, sizeof(offset_bits));
+  std::vector<uint64_t> signature = {input.frame_buffer->GetContentVersion(),
+                                     (uint64_t)input.rotation_mode,
+                                     (uint64_t)levels, offset_bits};
+  if (resized || signature != pyramid_signature_) {
+    // Down to the smallest level, then back up to the first one
+    RenderLevel(down_program_, input.frame_buffer, input.rotation_mode,
+                levels_[0], offset);
+    for (int i = 1; i < levels; i++) {
+      RenderLevel(down_program_, levels_[i - 1], NoRotation, levels_[i],
+                  offset);
+    }
+    for (int i = levels - 1; i > 0; i--) {
+      RenderLevel(up_program_, levels_[i], NoRotation, levels_[i - 1],
+                  offset);
+    }
+    pyramid_signature_ = signature;
+  }
+
+  // The last pass upsamples the first level into the output, in place of
+  // the input while it draws
+  InputFrameBufferInfo original_input = input;
+  input.frame_buffer = levels_[0];
+  input.rotation_mode = NoRotation;
+  filter_program_->SetUniformValue(
+      "halfTexel", Vector2(0.5 * offset / levels_[0]->GetWidth(),
+                           0.5 * offset / levels_[0]->GetHeight()));
+  // The sinks run last, as they may release the input and a transient
+  // output
+  Filter::DoRender(false);
+  input = original_input;
+  return Source::DoRender(updateSinks);
+}
+
+void DualKawaseBlurFilter::RenderLevel(
+    GPUPixelGLProgram* program,
+    const std::shared_ptr<GPUPixelFramebuffer>& source,
+    RotationMode rotation,
+    const std::shared_ptr<GPUPixelFramebuffer>& target,
+    float offset) {
+  GPUPixelContext::GetInstance()->SetActiveGlProgram(program);
+  target->Activate();
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  gl_state->BindTexture(GL_TEXTURE0, source->GetTexture());
+  program->SetUniformValue(program->GetInputTextureUniform(0), 0);
+  program->SetUniformValue("halfTexel",
+                           Vector2(0.5 * offset / source->GetWidth(),
+                                   0.5 * offset / source->GetHeight()));
+
+  uint32_t position_attribute = program->GetAttribLocation("position");
+  uint32_t tex_coord_attribute = program->GetInputTexCoordAttribute(0);
+  gl_state->EnableVertexAttribArray(position_attribute);
+  gl_state->EnableVertexAttribArray(tex_coord_attribute);
+  GL_CALL(glVertexAttribPointer(position_attribute, 2, GL_FLOAT, 0, 0,
+                                kPyramidVertices));
+  GL_CALL(glVertexAttribPointer(tex_coord_attribute, 2, GL_FLOAT, 0, 0,
+                                GetTextureCoordinate(rotation)));
+  GL_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+  target->Deactivate();
+  GPUPixelContext::GetInstance()->CountPass(false);
+}
+
+}  // namespace gpupixel
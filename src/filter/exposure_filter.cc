@@ -9,6 +9,7 @@
 #include "core/gpupixel_context.h"
 namespace gpupixel {
 
+#if defined(GPUPIXEL_GLES_SHADER)
 const std::string kExposureFragmentShaderString = R"(
     uniform sampler2D inputImageTexture; uniform lowp float exposure;
     varying highp vec2 textureCoordinate;
@@ -17,6 +18,16 @@ const std::string kExposureFragmentShaderString = R"(
       lowp vec4 color = texture2D(inputImageTexture, textureCoordinate);
       gl_FragColor = vec4(color.rgb * pow(2.0, exposure), color.a);
     })";
+#elif defined(GPUPIXEL_GL_SHADER)
+const std::string kExposureFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture; uniform float exposure;
+    varying vec2 textureCoordinate;
+
+    void main() {
+      vec4 color = texture2D(inputImageTexture, textureCoordinate);
+      gl_FragColor = vec4(color.rgb * pow(2.0, exposure), color.a);
+    })";
+#endif
 
 std::shared_ptr<ExposureFilter> ExposureFilter::Create() {
   auto ret = std::shared_ptr<ExposureFilter>(new ExposureFilter());
@@ -56,4 +67,17 @@ bool ExposureFilter::DoRender(bool updateSinks) {
   return Filter::DoRender(updateSinks);
 }
 
+bool ExposureFilter::GetColorStage(ColorStage& stage) const {
+  stage.uniforms = R"(
+      uniform float $exposure;)";
+  stage.code = R"(
+      color.rgb *= pow(2.0, $exposure);)";
+  return true;
+}
+
+void ExposureFilter::SetColorStageUniforms(GPUPixelGLProgram* program,
+                                           const std::string& prefix) {
+  program->SetUniformValue(prefix + "exposure", exposure_factor_);
+}
+
 }  // namespace gpupixel
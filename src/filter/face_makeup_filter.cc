@@ -226,33 +226,39 @@ bool FaceMakeupFilter::DoRender(bool updateSinks) {
       -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
   };
 
-  framebuffer_->Activate();
-  // render origin frame --- begin -----//
-  GPUPixelContext::GetInstance()->SetActiveGlProgram(filter_program2_);
-  GL_CALL(glClearColor(background_color_.r, background_color_.g,
-                       background_color_.b, background_color_.a));
-  GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
-
-  GL_CALL(glActiveTexture(GL_TEXTURE4));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D,
-                        input_framebuffers_[0].frame_buffer->GetTexture()));
-  filter_program2_->SetUniformValue("inputImageTexture", 4);
-
-  // vertex
-  GL_CALL(glEnableVertexAttribArray(filter_position_attribute2_));
-  GL_CALL(glVertexAttribPointer(filter_position_attribute2_, 2, GL_FLOAT, 0, 0,
-                                imageVertices));
-
-  GL_CALL(glEnableVertexAttribArray(filter_tex_coord_attribute2_));
-  GL_CALL(glVertexAttribPointer(filter_tex_coord_attribute2_, 2, GL_FLOAT, 0, 0,
-                                GetTextureCoordinate(NoRotation)));
-
-  GL_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  uint32_t input_texture = input_framebuffers_[0].frame_buffer->GetTexture();
+  // The mesh stays within the landmarks, so the input can be drawn over
+  uint32_t region_texture = has_face_ ? ActivateInPlace(face_landmarks_) : 0;
+  if (region_texture) {
+    input_texture = region_texture;
+  } else {
+    framebuffer_->Activate();
+    // render origin frame --- begin -----//
+    GPUPixelContext::GetInstance()->SetActiveGlProgram(filter_program2_);
+    gl_state->ClearColor(background_color_.r, background_color_.g,
+                         background_color_.b, background_color_.a);
+    GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
+
+    gl_state->BindTexture(GL_TEXTURE4, input_texture);
+    filter_program2_->SetUniformValue("inputImageTexture", 4);
+
+    // vertex
+    gl_state->EnableVertexAttribArray(filter_position_attribute2_);
+    GL_CALL(glVertexAttribPointer(filter_position_attribute2_, 2, GL_FLOAT, 0,
+                                  0, imageVertices));
+
+    gl_state->EnableVertexAttribArray(filter_tex_coord_attribute2_);
+    GL_CALL(glVertexAttribPointer(filter_tex_coord_attribute2_, 2, GL_FLOAT, 0,
+                                  0, GetTextureCoordinate(NoRotation)));
+
+    GL_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+  }
 
   // render image --- begin --- //
   GPUPixelContext::GetInstance()->SetActiveGlProgram(filter_program_);
 
-  GL_CALL(glEnableVertexAttribArray(filter_position_attribute_));
+  gl_state->EnableVertexAttribArray(filter_position_attribute_);
   if (face_landmarks_.size() != 0) {
     GL_CALL(glVertexAttribPointer(filter_position_attribute_, 2, GL_FLOAT, 0, 0,
                                   face_landmarks_.data()));
@@ -268,7 +274,7 @@ bool FaceMakeupFilter::DoRender(bool updateSinks) {
         (coord[i * 2 + 1] * 1280 - texture_bounds_.y) / texture_bounds_.height;
   }
   // texcoord attribute
-  GL_CALL(glEnableVertexAttribArray(filter_tex_coord_attribute_));
+  gl_state->EnableVertexAttribArray(filter_tex_coord_attribute_);
   GL_CALL(glVertexAttribPointer(filter_tex_coord_attribute_, 2, GL_FLOAT, 0, 0,
                                 textureCoordinates.data()));
 
@@ -276,14 +282,12 @@ bool FaceMakeupFilter::DoRender(bool updateSinks) {
 
   filter_program_->SetUniformValue("blendMode", 15);
 
-  std::shared_ptr<GPUPixelFramebuffer> fb = input_framebuffers_[0].frame_buffer;
-  GL_CALL(glActiveTexture(GL_TEXTURE0));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D, fb->GetTexture()));
+  gl_state->BindTexture(GL_TEXTURE0, input_texture);
   filter_program_->SetUniformValue("inputImageTexture", 0);  // origin image
 
-  glActiveTexture(GL_TEXTURE3);
   // assert(image_texture_);
-  glBindTexture(GL_TEXTURE_2D, image_texture_->GetFramebuffer()->GetTexture());
+  gl_state->BindTexture(GL_TEXTURE3,
+                        image_texture_->GetFramebuffer()->GetTexture());
   filter_program_->SetUniformValue("inputImageTexture2", 3);
 
   if (has_face_) {
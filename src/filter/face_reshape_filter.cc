@@ -270,6 +270,10 @@ bool FaceReshapeFilter::DoRender(bool updateSinks) {
   return Filter::DoRender(updateSinks);
 }
 
+bool FaceReshapeFilter::IsIdentity() const {
+  return !has_face_ || (thin_face_delta_ == 0 && big_eye_delta_ == 0);
+}
+
 #pragma mark - face slim
 void FaceReshapeFilter::SetFaceSlimLevel(float level) {
   thin_face_delta_ = level;
@@ -6,12 +6,83 @@
  */
 
 #include "gpupixel/filter/filter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include "core/gpupixel_context.h"
 #include "gpupixel/gpupixel.h"
 #include "utils/logging.h"
 #include "utils/util.h"
 namespace gpupixel {
 
+namespace {
+const float kImageVertices[] = {
+    -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
+};
+
+// Pixel rectangle x, y, width, height covering normalized device
+// coordinates x1, y1, x2, y2, with a pixel to spare for filtering
+void GetPixelBounds(const float bounds[4], int width, int height, int rect[4]) {
+  int x1 = std::floor((bounds[0] + 1) * 0.5f * width) - 1;
+  int y1 = std::floor((bounds[1] + 1) * 0.5f * height) - 1;
+  int x2 = std::ceil((bounds[2] + 1) * 0.5f * width) + 1;
+  int y2 = std::ceil((bounds[3] + 1) * 0.5f * height) + 1;
+  rect[0] = std::min(std::max(x1, 0), width);
+  rect[1] = std::min(std::max(y1, 0), height);
+  rect[2] = std::min(std::max(x2, 0), width) - rect[0];
+  rect[3] = std::min(std::max(y2, 0), height) - rect[1];
+}
+
+// Frames a baked chain's parameters must stay the same before it is baked
+const int kColorLutBakeFrames = 3;
+
+#if defined(GPUPIXEL_GLES_SHADER)
+// Header of the fused and baked color chains
+const std::string kColorStageShaderHeader = R"(
+    precision highp float; uniform sampler2D inputImageTexture;
+    varying highp vec2 textureCoordinate;
+)";
+
+// Applies a lookup table in the LookupFilter layout
+const std::string kColorLutFragmentShader = R"(
+    precision highp float; uniform sampler2D inputImageTexture;
+    uniform sampler2D lookupTexture;
+    varying highp vec2 textureCoordinate;
+
+    void main() {
+      vec4 color = texture2D(inputImageTexture, textureCoordinate);
+      float blue = color.b * 63.0;
+      vec2 quad1 = vec2(mod(floor(blue), 8.0), floor(floor(blue) / 8.0));
+      vec2 quad2 = vec2(mod(ceil(blue), 8.0), floor(ceil(blue) / 8.0));
+      vec2 offset = 0.5 / 512.0 + (0.125 - 1.0 / 512.0) * color.rg;
+      vec4 color1 = texture2D(lookupTexture, quad1 * 0.125 + offset);
+      vec4 color2 = texture2D(lookupTexture, quad2 * 0.125 + offset);
+      gl_FragColor = vec4(mix(color1.rgb, color2.rgb, fract(blue)), color.a);
+    })";
+#elif defined(GPUPIXEL_GL_SHADER)
+// Header of the fused and baked color chains
+const std::string kColorStageShaderHeader = R"(
+    uniform sampler2D inputImageTexture; varying vec2 textureCoordinate;
+)";
+
+// Applies a lookup table in the LookupFilter layout
+const std::string kColorLutFragmentShader = R"(
+    uniform sampler2D inputImageTexture; uniform sampler2D lookupTexture;
+    varying vec2 textureCoordinate;
+
+    void main() {
+      vec4 color = texture2D(inputImageTexture, textureCoordinate);
+      float blue = color.b * 63.0;
+      vec2 quad1 = vec2(mod(floor(blue), 8.0), floor(floor(blue) / 8.0));
+      vec2 quad2 = vec2(mod(ceil(blue), 8.0), floor(ceil(blue) / 8.0));
+      vec2 offset = 0.5 / 512.0 + (0.125 - 1.0 / 512.0) * color.rg;
+      vec4 color1 = texture2D(lookupTexture, quad1 * 0.125 + offset);
+      vec4 color2 = texture2D(lookupTexture, quad2 * 0.125 + offset);
+      gl_FragColor = vec4(mix(color1.rgb, color2.rgb, fract(blue)), color.a);
+    })";
+#endif
+}  // namespace
+
 std::map<std::string, std::function<std::shared_ptr<Filter>()>>
 init_filter_factory() {
   std::map<std::string, std::function<std::shared_ptr<Filter>()>> factory;
@@ -69,7 +140,18 @@ init_filter_factory() {
 std::map<std::string, std::function<std::shared_ptr<Filter>()>>
     Filter::filter_factories_ = init_filter_factory();
 
-Filter::Filter() : filter_program_(0), filter_class_name_("") {
+Filter::Filter()
+    : filter_program_(0),
+      filter_class_name_(""),
+      bypassed_(false),
+      dirty_tracking_(true),
+      property_version_(0),
+      has_render_bounds_(false),
+      fused_program_(0),
+      bake_program_(0),
+      lut_program_(0),
+      color_lut_version_(0),
+      stable_frames_(0) {
   background_color_.r = 0.0;
   background_color_.g = 0.0;
   background_color_.b = 0.0;
@@ -81,6 +163,12 @@ Filter::~Filter() {
     delete filter_program_;
     filter_program_ = 0;
   }
+  for (GPUPixelGLProgram* program :
+       {fused_program_, bake_program_, lut_program_}) {
+    if (program) {
+      delete program;
+    }
+  }
 }
 
 std::shared_ptr<Filter> Filter::Create(const std::string& filter_class_name) {
@@ -98,6 +186,7 @@ std::shared_ptr<Filter> Filter::CreateWithShaderString(
   auto filter = std::shared_ptr<Filter>(new Filter());
   if (!filter->InitWithShaderString(vertex_shader_source,
                                     fragment_shader_source)) {
+    filter.reset();
   }
   return filter;
 }
@@ -106,6 +195,7 @@ std::shared_ptr<Filter> Filter::CreateWithFragmentShaderString(
     const std::string& fragment_shader_source) {
   auto filter = std::shared_ptr<Filter>(new Filter());
   if (!filter->InitWithFragmentShaderString(fragment_shader_source)) {
+    filter.reset();
   }
   return filter;
 }
@@ -116,9 +206,13 @@ bool Filter::InitWithShaderString(const std::string& vertex_shader_source,
   input_count_ = input_number;
   filter_program_ = GPUPixelGLProgram::CreateWithShaderString(
       vertex_shader_source, fragment_shader_source);
+  if (!filter_program_) {
+    return false;
+  }
   filter_position_attribute_ = filter_program_->GetAttribLocation("position");
   GPUPixelContext::GetInstance()->SetActiveGlProgram(filter_program_);
-  GL_CALL(glEnableVertexAttribArray(filter_position_attribute_));
+  GPUPixelContext::GetInstance()->GetGlStateCache()->EnableVertexAttribArray(
+      filter_position_attribute_);
   return true;
 }
 
@@ -164,42 +258,347 @@ std::string Filter::GetVertexShaderString(int input_number) const {
   return shader_str;
 }
 
-bool Filter::DoRender(bool update_sinks) {
-  static const float image_vertices[] = {
-      -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
-  };
+bool Filter::SetFusedStages(const std::vector<std::shared_ptr<Filter>>& stages,
+                            bool bake_lut /* = false*/) {
+  fused_stages_.clear();
+  fused_prefixes_.clear();
+  color_lut_.reset();
+  for (GPUPixelGLProgram** program :
+       {&fused_program_, &bake_program_, &lut_program_}) {
+    if (*program) {
+      delete *program;
+      *program = 0;
+    }
+  }
+  if (stages.empty() && !bake_lut) {
+    return true;
+  }
 
-  GPUPixelContext::GetInstance()->SetActiveGlProgram(filter_program_);
+  std::vector<Filter*> filters = {this};
+  for (auto& stage : stages) {
+    filters.push_back(stage.get());
+  }
+
+  std::string uniforms;
+  std::string code;
+  for (size_t i = 0; i < filters.size(); ++i) {
+    ColorStage stage;
+    if (!filters[i]->GetColorStage(stage) || (bake_lut && !stage.bakeable)) {
+      fused_prefixes_.clear();
+      return false;
+    }
+    std::string prefix = Util::StringFormat("s%d_", (int)i);
+    fused_prefixes_.push_back(prefix);
+    for (std::string* source : {&stage.uniforms, &stage.code}) {
+      size_t pos = 0;
+      while ((pos = source->find('$', pos)) != std::string::npos) {
+        source->replace(pos, 1, prefix);
+        pos += prefix.size();
+      }
+    }
+    // Every pass stores to an 8-bit target, so clamp between stages as the
+    // unfused chain does
+    uniforms += stage.uniforms + "\n";
+    code += "{\n" + stage.code + "\n}\ncolor = clamp(color, 0.0, 1.0);\n";
+  }
+
+  std::string header = kColorStageShaderHeader + uniforms + "void main() {\n";
+  fused_program_ = GPUPixelGLProgram::CreateWithShaderString(
+      kDefaultVertexShader,
+      header +
+          "vec4 color = texture2D(inputImageTexture, textureCoordinate);\n" +
+          code + "gl_FragColor = color;\n}\n");
+  if (bake_lut) {
+    // Each of the 8x8 tiles of 64x64 texels holds one blue level, with red
+    // along x and green along y
+    bake_program_ = GPUPixelGLProgram::CreateWithShaderString(
+        kDefaultVertexShader,
+        header +
+            "vec2 texel = floor(textureCoordinate * 512.0);\n"
+            "vec2 tile = floor(texel / 64.0);\n"
+            "vec4 color = vec4((texel - tile * 64.0) / 63.0,\n"
+            "                        (tile.y * 8.0 + tile.x) / 63.0, 1.0);\n" +
+            code + "gl_FragColor = color;\n}\n");
+    lut_program_ = GPUPixelGLProgram::CreateWithShaderString(
+        kDefaultVertexShader, kColorLutFragmentShader);
+    color_lut_version_ = 0;
+    stable_frames_ = 0;
+  }
+  if (!fused_program_ || (bake_lut && (!bake_program_ || !lut_program_))) {
+    SetFusedStages({});
+    return false;
+  }
+
+  for (auto& stage : stages) {
+    fused_stages_.push_back(stage);
+    // Stages after the first never render on their own
+    stage->ReleaseFramebuffer();
+  }
+  return true;
+}
+
+bool Filter::Bypass() {
+  auto input = input_framebuffers_.find(0);
+  if (input == input_framebuffers_.end() || !input->second.frame_buffer ||
+      input->second.rotation_mode != NoRotation || framebuffer_scale_ != 1.0 ||
+      GetFusedTail()) {
+    return false;
+  }
+  framebuffer_ = input->second.frame_buffer;
+  output_rotation_ = NoRotation;
+  bypassed_ = true;
+  has_render_bounds_ = false;
+  rendered_signature_.clear();
+  GPUPixelContext::GetInstance()->CountBypassedPass();
+  return Source::DoRender(true);
+}
+
+void Filter::SetRenderBounds(float x1, float y1, float x2, float y2) {
+  render_bounds_[0] = std::min(x1, x2);
+  render_bounds_[1] = std::min(y1, y2);
+  render_bounds_[2] = std::max(x1, x2);
+  render_bounds_[3] = std::max(y1, y2);
+  has_render_bounds_ = true;
+}
+
+uint32_t Filter::ActivateInPlace(float x1, float y1, float x2, float y2) {
+  auto input = input_framebuffers_.find(0);
+  if (input == input_framebuffers_.end() || !input->second.frame_buffer ||
+      input->second.rotation_mode != NoRotation) {
+    return 0;
+  }
+  // Written in place only when nobody else can see the change
+  std::shared_ptr<GPUPixelFramebuffer>& input_framebuffer =
+      input->second.frame_buffer;
+  int width = input_framebuffer->GetWidth();
+  int height = input_framebuffer->GetHeight();
+  if (input_framebuffer.use_count() != 1 ||
+      !input_framebuffer->HasFramebuffer() || !framebuffer_ ||
+      framebuffer_->GetWidth() != width ||
+      framebuffer_->GetHeight() != height) {
+    return 0;
+  }
+
+  // Takes the place of the output this filter no longer needs
+  if (!in_place_copy_ || in_place_copy_->GetWidth() != width ||
+      in_place_copy_->GetHeight() != height) {
+    in_place_copy_ = GPUPixelContext::GetInstance()
+                         ->GetFramebufferFactory()
+                         ->CreateFramebuffer(width, height);
+  }
+  float bounds[4] = {std::min(x1, x2), std::min(y1, y2), std::max(x1, x2),
+                     std::max(y1, y2)};
+  int rect[4];
+  GetPixelBounds(bounds, width, height, rect);
+
+  framebuffer_ = input_framebuffer;
   framebuffer_->Activate();
-  GL_CALL(glClearColor(background_color_.r, background_color_.g,
-                       background_color_.b, background_color_.a));
+  if (rect[2] > 0 && rect[3] > 0) {
+    GPUPixelContext::GetInstance()->GetGlStateCache()->BindTexture(
+        in_place_copy_->GetTexture());
+    GL_CALL(glCopyTexSubImage2D(GL_TEXTURE_2D, 0, rect[0], rect[1], rect[0],
+                                rect[1], rect[2], rect[3]));
+  }
+  return in_place_copy_->GetTexture();
+}
+
+uint32_t Filter::ActivateInPlace(const std::vector<float>& points) {
+  if (points.size() < 2) {
+    return 0;
+  }
+  float x1 = points[0];
+  float y1 = points[1];
+  float x2 = x1;
+  float y2 = y1;
+  for (size_t i = 2; i + 1 < points.size(); i += 2) {
+    x1 = std::min(x1, points[i]);
+    y1 = std::min(y1, points[i + 1]);
+    x2 = std::max(x2, points[i]);
+    y2 = std::max(y2, points[i + 1]);
+  }
+  return ActivateInPlace(x1, y1, x2, y2);
+}
+
+void Filter::SetDirtyTracking(bool enabled) {
+  dirty_tracking_ = enabled;
+  rendered_signature_.clear();
+}
+
+std::vector<uint64_t> Filter::GetRenderSignature() const {
+  std::vector<uint64_t> signature = {
+      property_version_, filter_program_->GetUniformVersion(),
+      framebuffer_->GetContentVersion()};
+  for (auto& it : input_framebuffers_) {
+    signature.push_back(it.first);
+    signature.push_back(it.second.frame_buffer
+                            ? it.second.frame_buffer->GetContentVersion()
+                            : 0);
+    signature.push_back(it.second.rotation_mode);
+  }
+  signature.push_back(has_render_bounds_);
+  if (has_render_bounds_) {
+    for (float bound : render_bounds_) {
+      uint32_t bits;
+      memcpy(&bits, &bound, sizeof(bits));
+      signature.push_back(bits);
+    }
+  }
+  return signature;
+}
+
+Filter* Filter::GetFusedTail() {
+  if (fused_prefixes_.empty()) {
+    return nullptr;
+  }
+
+  Filter* previous = this;
+  for (auto& weak_stage : fused_stages_) {
+    std::shared_ptr<Filter> stage = weak_stage.lock();
+    if (!stage || previous->sinks_.size() != 1 ||
+        previous->sinks_.begin()->first.get() !=
+            static_cast<Sink*>(stage.get())) {
+      LOG_WARN("Filter: fused chain was relinked, rendering it unfused");
+      SetFusedStages({});
+      return nullptr;
+    }
+    // Kept alive by the previous filter's sinks
+    previous = stage.get();
+  }
+  return previous;
+}
+
+void Filter::SetFusedStageUniforms(GPUPixelGLProgram* program) {
+  SetColorStageUniforms(program, fused_prefixes_[0]);
+  for (size_t i = 0; i < fused_stages_.size(); ++i) {
+    fused_stages_[i].lock()->SetColorStageUniforms(program,
+                                                   fused_prefixes_[i + 1]);
+  }
+}
+
+bool Filter::UpdateColorLut() {
+  if (!bake_program_) {
+    return false;
+  }
+
+  GPUPixelContext::GetInstance()->SetActiveGlProgram(bake_program_);
+  SetFusedStageUniforms(bake_program_);
+  uint64_t version = bake_program_->GetUniformVersion();
+  if (version != color_lut_version_) {
+    // While parameters change, rendering the chain directly is cheaper than
+    // baking every frame
+    color_lut_version_ = version;
+    stable_frames_ = 0;
+    color_lut_.reset();
+    return false;
+  }
+  if (color_lut_) {
+    return true;
+  }
+  if (++stable_frames_ < kColorLutBakeFrames) {
+    return false;
+  }
+
+  color_lut_ = GPUPixelContext::GetInstance()
+                   ->GetFramebufferFactory()
+                   ->CreateFramebuffer(512, 512);
+  color_lut_->Activate();
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  uint32_t position_attribute = bake_program_->GetAttribLocation("position");
+  uint32_t tex_coord_attribute = bake_program_->GetInputTexCoordAttribute(0);
+  gl_state->EnableVertexAttribArray(position_attribute);
+  gl_state->EnableVertexAttribArray(tex_coord_attribute);
+  GL_CALL(glVertexAttribPointer(position_attribute, 2, GL_FLOAT, 0, 0,
+                                kImageVertices));
+  GL_CALL(glVertexAttribPointer(tex_coord_attribute, 2, GL_FLOAT, 0, 0,
+                                GetTextureCoordinate(NoRotation)));
+  GL_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+  color_lut_->Deactivate();
+  return true;
+}
+
+bool Filter::DoRender(bool update_sinks) {
+  GPUPixelGLProgram* program = filter_program_;
+  Filter* fused_tail = GetFusedTail();
+  if (fused_tail) {
+    program = UpdateColorLut() ? lut_program_ : fused_program_;
+  } else if (dirty_tracking_ && !rendered_signature_.empty() &&
+             GetRenderSignature() == rendered_signature_) {
+    // The last output is still what this pass would draw
+    has_render_bounds_ = false;
+    GPUPixelContext::GetInstance()->CountPass(true);
+    return Source::DoRender(update_sinks);
+  }
+  uint32_t position_attribute = program == filter_program_
+                                    ? filter_position_attribute_
+                                    : program->GetAttribLocation("position");
+
+  GPUPixelContext::GetInstance()->SetActiveGlProgram(program);
+  framebuffer_->Activate();
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  if (program == fused_program_) {
+    SetFusedStageUniforms(program);
+  } else if (program == lut_program_) {
+    // Single input, so unit 1 is free
+    gl_state->BindTexture(GL_TEXTURE1, color_lut_->GetTexture());
+    program->SetUniformValue("lookupTexture", 1);
+  }
+  gl_state->ClearColor(background_color_.r, background_color_.g,
+                       background_color_.b, background_color_.a);
   GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
+  if (has_render_bounds_) {
+    int rect[4];
+    GetPixelBounds(render_bounds_, framebuffer_->GetWidth(),
+                   framebuffer_->GetHeight(), rect);
+    GL_CALL(glEnable(GL_SCISSOR_TEST));
+    GL_CALL(glScissor(rect[0], rect[1], rect[2], rect[3]));
+  }
   for (std::map<int, InputFrameBufferInfo>::const_iterator it =
            input_framebuffers_.begin();
        it != input_framebuffers_.end(); ++it) {
     int tex_idx = it->first;
     std::shared_ptr<GPUPixelFramebuffer> fb = it->second.frame_buffer;
-    GL_CALL(glActiveTexture(GL_TEXTURE0 + tex_idx));
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, fb->GetTexture()));
-    filter_program_->SetUniformValue(
-        tex_idx == 0 ? "inputImageTexture"
-                     : Util::StringFormat("inputImageTexture%d", tex_idx),
-        tex_idx);
-    // texcoord attribute
-    uint32_t filter_tex_coord_attribute = filter_program_->GetAttribLocation(
-        tex_idx == 0 ? "inputTextureCoordinate"
-                     : Util::StringFormat("inputTextureCoordinate%d", tex_idx));
-    GL_CALL(glEnableVertexAttribArray(filter_tex_coord_attribute));
+    gl_state->BindTexture(GL_TEXTURE0 + tex_idx, fb->GetTexture());
+    program->SetUniformValue(program->GetInputTextureUniform(tex_idx),
+                             tex_idx);
+    // texcoord attribute, unused by shaders that address texels by
+    // gl_FragCoord
+    uint32_t filter_tex_coord_attribute =
+        program->GetInputTexCoordAttribute(tex_idx);
+    if (filter_tex_coord_attribute == (uint32_t)-1) {
+      continue;
+    }
+    gl_state->EnableVertexAttribArray(filter_tex_coord_attribute);
     GL_CALL(
         glVertexAttribPointer(filter_tex_coord_attribute, 2, GL_FLOAT, 0, 0,
                               GetTextureCoordinate(it->second.rotation_mode)));
   }
-  GL_CALL(glVertexAttribPointer(filter_position_attribute_, 2, GL_FLOAT, 0, 0,
-                                image_vertices));
+  gl_state->EnableVertexAttribArray(position_attribute);
+  GL_CALL(glVertexAttribPointer(position_attribute, 2, GL_FLOAT, 0, 0,
+                                kImageVertices));
   GL_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+  if (has_render_bounds_) {
+    GL_CALL(glDisable(GL_SCISSOR_TEST));
+  }
 
   framebuffer_->Deactivate();
-
+  GPUPixelContext::GetInstance()->CountPass(false);
+  rendered_signature_.clear();
+  if (dirty_tracking_ && !fused_tail) {
+    rendered_signature_ = GetRenderSignature();
+  }
+  // Bounds only apply to the next pass
+  has_render_bounds_ = false;
+
+  if (fused_tail && fused_tail != this) {
+    // The result is the tail's output, its sinks take it from there
+    fused_tail->framebuffer_ = framebuffer_;
+    fused_tail->output_rotation_ = NoRotation;
+    fused_tail->timestamp_ = timestamp_;
+    if (transient_output_) {
+      framebuffer_.reset();
+    }
+    return fused_tail->Source::DoRender(update_sinks);
+  }
   return Source::DoRender(update_sinks);
 }
 
@@ -267,18 +666,41 @@ const float* Filter::GetTextureCoordinate(
   }
 }
 
+void Filter::SetInputTimestamp(int64_t timestamp) {
+  Sink::SetInputTimestamp(timestamp);
+  timestamp_ = timestamp;
+}
+
+void Filter::DoUpdateSinks() {
+  if (transient_output_) {
+    // The inputs are drawn; release them before the sinks render so that
+    // transient ones can be reused further down the graph
+    Sink::ResetAndClean();
+  }
+  Source::DoUpdateSinks();
+}
+
 void Filter::Render() {
   if (input_framebuffers_.empty()) {
     return;
   }
 
-  std::shared_ptr<GPUPixelFramebuffer> first_input_framebuffer =
+  // Not a copy, so that a pass can tell when it is the input's only holder
+  const std::shared_ptr<GPUPixelFramebuffer>& first_input_framebuffer =
       input_framebuffers_.begin()->second.frame_buffer;
   RotationMode first_input_rotation =
       input_framebuffers_.begin()->second.rotation_mode;
   if (!first_input_framebuffer) {
     return;
   }
+  if (IsIdentity() && Bypass()) {
+    return;
+  }
+  if (bypassed_) {
+    // Never draw into the input that was handed on
+    framebuffer_.reset();
+    bypassed_ = false;
+  }
 
   int rotated_framebuffer_width = first_input_framebuffer->GetWidth();
   int rotated_framebuffer_height = first_input_framebuffer->GetHeight();
@@ -387,6 +809,7 @@ bool Filter::SetProperty(const std::string& name, int value) {
   if (property->on_property_set_func) {
     property->on_property_set_func(value);
   }
+  property_version_++;
   return true;
 }
 
@@ -406,6 +829,7 @@ bool Filter::SetProperty(const std::string& name, float value) {
   }
   property->value = value;
 
+  property_version_++;
   return true;
 }
 
@@ -425,6 +849,7 @@ bool Filter::SetProperty(const std::string& name, std::vector<float> value) {
   }
   property->value = value;
 
+  property_version_++;
   return true;
 }
 
@@ -443,6 +868,7 @@ bool Filter::SetProperty(const std::string& name, std::string value) {
   if (property->on_property_set_func) {
     property->on_property_set_func(value);
   }
+  property_version_++;
   return true;
 }
 
@@ -141,6 +141,14 @@ bool FilterGroup::DoRender(bool updateSinks) {
 void FilterGroup::Render() {
   DoRender();
 
+  // The terminal filter has the group's input too, and hands it on
+  if (terminal_filter_ && IsIdentity() && terminal_filter_->Bypass()) {
+    for (auto& filter : filters_) {
+      filter->ResetAndClean();
+    }
+    return;
+  }
+
   for (auto& filter : filters_) {
     if (filter->IsReady()) {
       filter->Render();
@@ -176,6 +184,12 @@ void FilterGroup::SetInputFramebuffer(
   }
 }
 
+void FilterGroup::SetInputTimestamp(int64_t timestamp) {
+  for (auto& filter : filters_) {
+    filter->SetInputTimestamp(timestamp);
+  }
+}
+
 bool FilterGroup::IsReady() const {
   //    for (auto& filter : filters_) {
   //        if (!filter->IsReady())
@@ -6,13 +6,19 @@
  */
 
 #include "gpupixel/filter/gaussian_blur_filter.h"
+#include <algorithm>
 #include <cmath>
 #include "core/gpupixel_context.h"
 #include "utils/util.h"
 namespace gpupixel {
 
 GaussianBlurFilter::GaussianBlurFilter()
-    : horizontal_blur_filter_(nullptr), vertical_blur_filter_(nullptr) {}
+    : horizontal_blur_filter_(nullptr),
+      vertical_blur_filter_(nullptr),
+      pyramid_blur_filter_(nullptr),
+      backend_(SEPARABLE),
+      sigma_(2.0),
+      pyramid_sigma_(2.0) {}
 
 GaussianBlurFilter::~GaussianBlurFilter() {}
 
@@ -39,22 +45,66 @@ bool GaussianBlurFilter::Init(int radius, float sigma) {
       GaussianBlurMonoFilter::VERTICAL, radius, sigma);
   horizontal_blur_filter_->AddSink(vertical_blur_filter_);
   AddFilter(horizontal_blur_filter_);
+  sigma_ = sigma;
+  pyramid_sigma_ = std::min(sigma, radius / 2.0f);
 
   RegisterProperty("radius", 4, "", [this](int& radius) { SetRadius(radius); });
 
   RegisterProperty("sigma", 2.0, "", [this](float& sigma) { setSigma(sigma); });
 
+  RegisterProperty("backend", (int)SEPARABLE,
+                   "0 for separable passes, 1 for a downsampling pyramid",
+                   [this](int& backend) { SetBackend((Backend)backend); });
+
   return true;
 }
 
+// The separable kernel is cut off at the radius, so the pyramid follows the
+// narrower of the two
 void GaussianBlurFilter::SetRadius(int radius) {
   horizontal_blur_filter_->SetRadius(radius);
   vertical_blur_filter_->SetRadius(radius);
+  pyramid_sigma_ = std::min(sigma_, radius / 2.0f);
+  if (pyramid_blur_filter_) {
+    pyramid_blur_filter_->SetSigma(pyramid_sigma_);
+  }
 }
 
 void GaussianBlurFilter::setSigma(float sigma) {
   horizontal_blur_filter_->setSigma(sigma);
   vertical_blur_filter_->setSigma(sigma);
+  // The radius is widened to cover the whole curve
+  sigma_ = sigma;
+  pyramid_sigma_ = sigma;
+  if (pyramid_blur_filter_) {
+    pyramid_blur_filter_->SetSigma(pyramid_sigma_);
+  }
+}
+
+void GaussianBlurFilter::SetBackend(Backend backend) {
+  if (backend == backend_) {
+    return;
+  }
+  if (backend == PYRAMID && !pyramid_blur_filter_) {
+    pyramid_blur_filter_ = DualKawaseBlurFilter::Create(pyramid_sigma_);
+    if (!pyramid_blur_filter_) {
+      return;
+    }
+  }
+  backend_ = backend;
+
+  // The sinks move over to the new terminal filter
+  std::map<std::shared_ptr<Sink>, int> sinks = terminal_filter_->GetSinks();
+  terminal_filter_->RemoveAllSinks();
+  RemoveAllFilters();
+  if (backend_ == PYRAMID) {
+    AddFilter(pyramid_blur_filter_);
+  } else {
+    AddFilter(horizontal_blur_filter_);
+  }
+  for (auto& sink : sinks) {
+    terminal_filter_->AddSink(sink.first, sink.second);
+  }
 }
 
 }  // namespace gpupixel
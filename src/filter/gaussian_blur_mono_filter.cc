@@ -11,8 +11,21 @@
 #include "utils/util.h"
 namespace gpupixel {
 
+namespace {
+
+// Frames the radius and sigma of a parametric blur must stay the same before
+// the shader specialized for them is compiled
+const int kSpecializeFrames = 30;
+
+}  // namespace
+
 GaussianBlurMonoFilter::GaussianBlurMonoFilter(Type type /* = HORIZONTAL*/)
-    : type_(type), radius_(4), sigma_(2.0) {}
+    : type_(type),
+      radius_(4),
+      sigma_(2.0),
+      parametric_(false),
+      settled_frames_(0),
+      center_weight_(1.0) {}
 
 std::shared_ptr<GaussianBlurMonoFilter> GaussianBlurMonoFilter::Create(
     Type type /* = HORIZONTAL*/,
@@ -29,9 +42,15 @@ std::shared_ptr<GaussianBlurMonoFilter> GaussianBlurMonoFilter::Create(
 }
 
 bool GaussianBlurMonoFilter::Init(int radius, float sigma) {
-  if (Filter::InitWithShaderString(
-          GenerateOptimizedVertexShaderString(radius, sigma),
-          GenerateOptimizedFragmentShaderString(radius, sigma))) {
+  radius_ = radius;
+  sigma_ = sigma;
+  std::string vertex_shader =
+      GenerateOptimizedVertexShaderString(radius, sigma);
+  std::string fragment_shader =
+      GenerateOptimizedFragmentShaderString(radius, sigma);
+  if (Filter::InitWithShaderString(vertex_shader, fragment_shader)) {
+    GPUPixelContext::GetInstance()->GetProgramVariantCache()->Retain(
+        vertex_shader, fragment_shader);
     return true;
   }
   return false;
@@ -43,13 +62,7 @@ void GaussianBlurMonoFilter::SetRadius(int radius) {
   }
 
   radius_ = radius;
-
-  if (filter_program_) {
-    delete filter_program_;
-    filter_program_ = 0;
-  }
-  InitWithShaderString(GenerateOptimizedVertexShaderString(radius_, sigma_),
-                       GenerateOptimizedFragmentShaderString(radius_, sigma_));
+  UpdateProgram();
 }
 
 void GaussianBlurMonoFilter::setSigma(float sigma) {
@@ -75,16 +88,76 @@ void GaussianBlurMonoFilter::setSigma(float sigma) {
             // radius sizes, due to the optimizations I use
   }
   radius_ = calculatedSampleRadius;
+  UpdateProgram();
+}
 
+void GaussianBlurMonoFilter::UpdateProgram() {
+  GPUPixelContext::GetInstance()->SyncRunWithContext([=] {
+    settled_frames_ = 0;
+    MarkDirty();
+
+    std::string vertex_shader =
+        GenerateOptimizedVertexShaderString(radius_, sigma_);
+    std::string fragment_shader =
+        GenerateOptimizedFragmentShaderString(radius_, sigma_);
+    ProgramVariantCache* variants =
+        GPUPixelContext::GetInstance()->GetProgramVariantCache();
+    // A cached variant is linked already, and radii beyond the uniform
+    // arrays have to be compiled anyway
+    if (radius_ > kMaxParametricRadius ||
+        variants->Contains(vertex_shader, fragment_shader)) {
+      SwitchProgram(vertex_shader, fragment_shader);
+      variants->Retain(vertex_shader, fragment_shader);
+      parametric_ = false;
+      return;
+    }
+
+    GetSampleWeights(radius_, sigma_, center_weight_, sample_offsets_,
+                     sample_weights_);
+    if (!parametric_) {
+      SwitchProgram(kDefaultVertexShader,
+                    GenerateParametricFragmentShaderString());
+      parametric_ = true;
+    }
+  });
+}
+
+void GaussianBlurMonoFilter::SwitchProgram(
+    const std::string& vertex_shader,
+    const std::string& fragment_shader) {
   if (filter_program_) {
     delete filter_program_;
     filter_program_ = 0;
   }
-  InitWithShaderString(GenerateOptimizedVertexShaderString(radius_, sigma_),
-                       GenerateOptimizedFragmentShaderString(radius_, sigma_));
+  InitWithShaderString(vertex_shader, fragment_shader);
 }
 
 bool GaussianBlurMonoFilter::DoRender(bool updateSinks) {
+  if (parametric_ && ++settled_frames_ >= kSpecializeFrames) {
+    // The parameters have settled, so the specialized shader is compiled
+    // and kept for the next time they are used
+    std::string vertex_shader =
+        GenerateOptimizedVertexShaderString(radius_, sigma_);
+    std::string fragment_shader =
+        GenerateOptimizedFragmentShaderString(radius_, sigma_);
+    SwitchProgram(vertex_shader, fragment_shader);
+    GPUPixelContext::GetInstance()->GetProgramVariantCache()->Retain(
+        vertex_shader, fragment_shader);
+    parametric_ = false;
+    MarkDirty();
+  }
+  if (parametric_) {
+    filter_program_->SetUniformValue("centerWeight", center_weight_);
+    filter_program_->SetUniformValue("sampleCount",
+                                     (int)sample_offsets_.size());
+    if (!sample_offsets_.empty()) {
+      filter_program_->SetUniformValue(
+          "sampleOffsets", sample_offsets_.data(), sample_offsets_.size());
+      filter_program_->SetUniformValue(
+          "sampleWeights", sample_weights_.data(), sample_weights_.size());
+    }
+  }
+
   RotationMode inputRotation =
       input_framebuffers_.begin()->second.rotation_mode;
 
@@ -121,6 +194,103 @@ void GaussianBlurMonoFilter::SetTexelSpacingMultiplier(float value) {
   horizontal_texel_spacing_ = value;
 }
 
+void GaussianBlurMonoFilter::GetSampleWeights(int radius,
+                                              float sigma,
+                                              float& center_weight,
+                                              std::vector<float>& offsets,
+                                              std::vector<float>& weights) {
+  offsets.clear();
+  weights.clear();
+  if (radius < 1 || sigma <= 0.0) {
+    center_weight = 1.0;
+    return;
+  }
+
+  std::vector<float> standard_weights(radius + 1);
+  float sum_of_weights = 0.0;
+  for (int i = 0; i < radius + 1; ++i) {
+    standard_weights[i] = (1.0 / sqrt(2.0 * M_PI * pow(sigma, 2.0))) *
+                          exp(-pow(i, 2.0) / (2.0 * pow(sigma, 2.0)));
+    sum_of_weights += i == 0 ? standard_weights[i] : 2.0 * standard_weights[i];
+  }
+  for (int i = 0; i < radius + 1; ++i) {
+    standard_weights[i] /= sum_of_weights;
+  }
+
+  center_weight = standard_weights[0];
+  // Each pair of neighbouring texels is read with one interpolated sample
+  for (int i = 0; i < radius / 2 + (radius % 2); ++i) {
+    float first_weight = standard_weights[i * 2 + 1];
+    float second_weight = i * 2 + 2 <= radius ? standard_weights[i * 2 + 2] : 0;
+    float weight = first_weight + second_weight;
+    offsets.push_back(
+        (first_weight * (i * 2 + 1) + second_weight * (i * 2 + 2)) / weight);
+    weights.push_back(weight);
+  }
+}
+
+std::string GaussianBlurMonoFilter::GenerateParametricFragmentShaderString() {
+#if defined(GPUPIXEL_GLES_SHADER)
+  return Util::StringFormat(
+      "\
+      uniform sampler2D inputImageTexture;\n\
+      uniform highp float texelWidthOffset;\n\
+      uniform highp float texelHeightOffset;\n\
+      uniform highp float centerWeight;\n\
+      uniform highp float sampleOffsets[%d];\n\
+      uniform highp float sampleWeights[%d];\n\
+      uniform int sampleCount;\n\
+      varying highp vec2 textureCoordinate;\n\
+      void main()\n\
+      {\n\
+      highp vec2 texelSpacing = vec2(texelWidthOffset, texelHeightOffset);\n\
+      mediump vec4 sum = texture2D(inputImageTexture, textureCoordinate) *\n\
+                         centerWeight;\n\
+      for (int i = 0; i < %d; i++) {\n\
+        if (i >= sampleCount) {\n\
+          break;\n\
+        }\n\
+        highp vec2 offset = texelSpacing * sampleOffsets[i];\n\
+        sum += (texture2D(inputImageTexture, textureCoordinate + offset) +\n\
+                texture2D(inputImageTexture, textureCoordinate - offset)) *\n\
+               sampleWeights[i];\n\
+      }\n\
+      gl_FragColor = sum;\n\
+      }",
+      kMaxParametricRadius / 2, kMaxParametricRadius / 2,
+      kMaxParametricRadius / 2);
+#elif defined(GPUPIXEL_GL_SHADER)
+  return Util::StringFormat(
+      "\
+      uniform sampler2D inputImageTexture;\n\
+      uniform float texelWidthOffset;\n\
+      uniform float texelHeightOffset;\n\
+      uniform float centerWeight;\n\
+      uniform float sampleOffsets[%d];\n\
+      uniform float sampleWeights[%d];\n\
+      uniform int sampleCount;\n\
+      varying vec2 textureCoordinate;\n\
+      void main()\n\
+      {\n\
+      vec2 texelSpacing = vec2(texelWidthOffset, texelHeightOffset);\n\
+      vec4 sum = texture2D(inputImageTexture, textureCoordinate) *\n\
+                 centerWeight;\n\
+      for (int i = 0; i < %d; i++) {\n\
+        if (i >= sampleCount) {\n\
+          break;\n\
+        }\n\
+        vec2 offset = texelSpacing * sampleOffsets[i];\n\
+        sum += (texture2D(inputImageTexture, textureCoordinate + offset) +\n\
+                texture2D(inputImageTexture, textureCoordinate - offset)) *\n\
+               sampleWeights[i];\n\
+      }\n\
+      gl_FragColor = sum;\n\
+      }",
+      kMaxParametricRadius / 2, kMaxParametricRadius / 2,
+      kMaxParametricRadius / 2);
+#endif
+}
+
 std::string GaussianBlurMonoFilter::GenerateVertexShaderString(int radius,
                                                                float sigma) {
   if (radius < 1 || sigma <= 0.0) {
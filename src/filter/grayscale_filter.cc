@@ -55,4 +55,11 @@ bool GrayscaleFilter::DoRender(bool updateSinks) {
   return Filter::DoRender(updateSinks);
 }
 
+bool GrayscaleFilter::GetColorStage(ColorStage& stage) const {
+  stage.code = R"(
+      float luminance = dot(color.rgb, vec3(0.2125, 0.7154, 0.0721));
+      color.rgb = vec3(luminance);)";
+  return true;
+}
+
 }  // namespace gpupixel
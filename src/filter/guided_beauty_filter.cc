@@ -0,0 +1,390 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+#include "gpupixel/filter/guided_beauty_filter.h"
+#include "core/gpupixel_context.h"
+
+namespace gpupixel {
+
+namespace {
+
+// In pixels of the input, close to the extent of the BeautyFaceFilter blur
+const float kDefaultRadius = 16.0;
+
+#if defined(GPUPIXEL_GLES_SHADER)
+const std::string kGuidedFilterDownsampleFragmentShaderString = R"(
+    precision highp float;
+    varying highp vec2 textureCoordinate;
+    uniform sampler2D inputImageTexture;
+    uniform highp vec2 texelOffset;
+    uniform highp float carryVariance;
+    uniform highp float varianceScale;
+
+    void main() {
+      // The centers of the 2x2 input pixels
+      vec2 coordinate = textureCoordinate;
+      vec2 flipped = vec2(texelOffset.x, -texelOffset.y);
+      vec4 color0 = texture2D(inputImageTexture, coordinate - texelOffset);
+      vec4 color1 = texture2D(inputImageTexture, coordinate + flipped);
+      vec4 color2 = texture2D(inputImageTexture, coordinate - flipped);
+      vec4 color3 = texture2D(inputImageTexture, coordinate + texelOffset);
+      vec3 weights = vec3(0.299, 0.587, 0.114);
+      vec4 luma = vec4(dot(color0.rgb, weights), dot(color1.rgb, weights),
+                       dot(color2.rgb, weights), dot(color3.rgb, weights));
+      float lumaMean = dot(luma, vec4(0.25));
+      // The variance of the pixels plus the mean of the variances they carry
+      float variance =
+          max(dot(luma, luma) * 0.25 - lumaMean * lumaMean, 0.0) *
+              varianceScale +
+          carryVariance * (color0.a + color1.a + color2.a + color3.a) * 0.25;
+      vec3 mean = (color0.rgb + color1.rgb + color2.rgb + color3.rgb) * 0.25;
+      gl_FragColor = vec4(mean, variance);
+    })";
+
+const std::string kGuidedFilterCoefficientFragmentShaderString = R"(
+    precision highp float;
+    varying highp vec2 textureCoordinate;
+    uniform sampler2D inputImageTexture;
+    uniform highp vec2 tapOffset;
+    uniform highp float epsilon;
+    uniform highp float varianceScale;
+
+    void main() {
+      vec3 sum = vec3(0.0);
+      float lumaSum = 0.0;
+      float lumaSquareSum = 0.0;
+      float varianceSum = 0.0;
+      for (int j = -2; j <= 2; j++) {
+        for (int i = -2; i <= 2; i++) {
+          vec2 offset = vec2(float(i), float(j)) * tapOffset;
+          vec4 color = texture2D(inputImageTexture, textureCoordinate + offset);
+          float luma = dot(color.rgb, vec3(0.299, 0.587, 0.114));
+          sum += color.rgb;
+          lumaSum += luma;
+          lumaSquareSum += luma * luma;
+          varianceSum += color.a;
+        }
+      }
+      vec3 mean = sum / 25.0;
+      float lumaMean = lumaSum / 25.0;
+      // The variance of the taps plus the mean of the variances within them
+      float variance = max(lumaSquareSum / 25.0 - lumaMean * lumaMean, 0.0) +
+                       varianceSum / 25.0 / varianceScale;
+      // Flat areas take the mean, detailed ones keep the pixel
+      float a = variance / (variance + epsilon);
+      gl_FragColor = vec4(mean * (1.0 - a), a);
+    })";
+
+// The whitening functions of BeautyFaceUnitFilter go in between
+const std::string kGuidedBeautyFragmentShaderHeader = R"(
+    precision highp float;
+    varying highp vec2 textureCoordinate;
+    varying highp vec2 textureCoordinate1;
+    uniform sampler2D inputImageTexture;
+    uniform sampler2D inputImageTexture1;
+    uniform highp float blurAlpha;
+)";
+
+const std::string kGuidedBeautyFragmentShaderMain = R"(
+    void main() {
+      vec4 iColor = texture2D(inputImageTexture, textureCoordinate);
+      vec4 coefficients = texture2D(inputImageTexture1, textureCoordinate1);
+
+      vec3 color = iColor.rgb;
+      if (blurAlpha > 0.0) {
+        vec3 smoothColor = coefficients.a * iColor.rgb + coefficients.rgb;
+        // Limited to skin tones like in BeautyFaceUnitFilter
+        float p =
+            clamp((min(iColor.r, smoothColor.r - 0.1) - 0.2) * 4.0, 0.0, 1.0);
+        color = mix(iColor.rgb, smoothColor, clamp(p * blurAlpha, 0.0, 1.0));
+      }
+
+      if (whiten > 0.0) {
+        color = whitenColor(color);
+      }
+      gl_FragColor = vec4(color, 1.0);
+    })";
+#elif defined(GPUPIXEL_GL_SHADER)
+const std::string kGuidedFilterDownsampleFragmentShaderString = R"(
+    varying vec2 textureCoordinate; uniform sampler2D inputImageTexture;
+    uniform vec2 texelOffset; uniform float carryVariance;
+    uniform float varianceScale;
+
+    void main() {
+      // The centers of the 2x2 input pixels
+      vec2 coordinate = textureCoordinate;
+      vec2 flipped = vec2(texelOffset.x, -texelOffset.y);
+      vec4 color0 = texture2D(inputImageTexture, coordinate - texelOffset);
+      vec4 color1 = texture2D(inputImageTexture, coordinate + flipped);
+      vec4 color2 = texture2D(inputImageTexture, coordinate - flipped);
+      vec4 color3 = texture2D(inputImageTexture, coordinate + texelOffset);
+      vec3 weights = vec3(0.299, 0.587, 0.114);
+      vec4 luma = vec4(dot(color0.rgb, weights), dot(color1.rgb, weights),
+                       dot(color2.rgb, weights), dot(color3.rgb, weights));
+      float lumaMean = dot(luma, vec4(0.25));
+      // The variance of the pixels plus the mean of the variances they carry
+      float variance =
+          max(dot(luma, luma) * 0.25 - lumaMean * lumaMean, 0.0) *
+              varianceScale +
+          carryVariance * (color0.a + color1.a + color2.a + color3.a) * 0.25;
+      vec3 mean = (color0.rgb + color1.rgb + color2.rgb + color3.rgb) * 0.25;
+      gl_FragColor = vec4(mean, variance);
+    })";
+
+const std::string kGuidedFilterCoefficientFragmentShaderString = R"(
+    varying vec2 textureCoordinate; uniform sampler2D inputImageTexture;
+    uniform vec2 tapOffset; uniform float epsilon; uniform float varianceScale;
+
+    void main() {
+      vec3 sum = vec3(0.0);
+      float lumaSum = 0.0;
+      float lumaSquareSum = 0.0;
+      float varianceSum = 0.0;
+      for (int j = -2; j <= 2; j++) {
+        for (int i = -2; i <= 2; i++) {
+          vec2 offset = vec2(float(i), float(j)) * tapOffset;
+          vec4 color = texture2D(inputImageTexture, textureCoordinate + offset);
+          float luma = dot(color.rgb, vec3(0.299, 0.587, 0.114));
+          sum += color.rgb;
+          lumaSum += luma;
+          lumaSquareSum += luma * luma;
+          varianceSum += color.a;
+        }
+      }
+      vec3 mean = sum / 25.0;
+      float lumaMean = lumaSum / 25.0;
+      // The variance of the taps plus the mean of the variances within them
+      float variance = max(lumaSquareSum / 25.0 - lumaMean * lumaMean, 0.0) +
+                       varianceSum / 25.0 / varianceScale;
+      // Flat areas take the mean, detailed ones keep the pixel
+      float a = variance / (variance + epsilon);
+      gl_FragColor = vec4(mean * (1.0 - a), a);
+    })";
+
+// The whitening functions of BeautyFaceUnitFilter go in between
+const std::string kGuidedBeautyFragmentShaderHeader = R"(
+    varying vec2 textureCoordinate; varying vec2 textureCoordinate1;
+    uniform sampler2D inputImageTexture; uniform sampler2D inputImageTexture1;
+    uniform float blurAlpha;
+)";
+
+const std::string kGuidedBeautyFragmentShaderMain = R"(
+    void main() {
+      vec4 iColor = texture2D(inputImageTexture, textureCoordinate);
+      vec4 coefficients = texture2D(inputImageTexture1, textureCoordinate1);
+
+      vec3 color = iColor.rgb;
+      if (blurAlpha > 0.0) {
+        vec3 smoothColor = coefficients.a * iColor.rgb + coefficients.rgb;
+        // Limited to skin tones like in BeautyFaceUnitFilter
+        float p =
+            clamp((min(iColor.r, smoothColor.r - 0.1) - 0.2) * 4.0, 0.0, 1.0);
+        color = mix(iColor.rgb, smoothColor, clamp(p * blurAlpha, 0.0, 1.0));
+      }
+
+      if (whiten > 0.0) {
+        color = whitenColor(color);
+      }
+      gl_FragColor = vec4(color, 1.0);
+    })";
+#endif
+
+}  // namespace
+
+GuidedFilterDownsampleFilter::GuidedFilterDownsampleFilter()
+    : carry_variance_(false) {}
+
+std::shared_ptr<GuidedFilterDownsampleFilter>
+GuidedFilterDownsampleFilter::Create(bool carry_variance) {
+  auto ret = std::shared_ptr<GuidedFilterDownsampleFilter>(
+      new GuidedFilterDownsampleFilter());
+  gpupixel::GPUPixelContext::GetInstance()->SyncRunWithContext([&] {
+    if (ret && !ret->Init(carry_variance)) {
+      ret.reset();
+    }
+  });
+  return ret;
+}
+
+bool GuidedFilterDownsampleFilter::Init(bool carry_variance) {
+  if (!InitWithFragmentShaderString(
+          kGuidedFilterDownsampleFragmentShaderString)) {
+    return false;
+  }
+  carry_variance_ = carry_variance;
+  SetFramebufferScale(0.5);
+  return true;
+}
+
+bool GuidedFilterDownsampleFilter::DoRender(bool updateSinks) {
+  // Half a texel of the input in each direction, so a rotation of the input
+  // only reorders the four fetches
+  std::shared_ptr<GPUPixelFramebuffer> input =
+      input_framebuffers_.begin()->second.frame_buffer;
+  filter_program_->SetUniformValue(
+      "texelOffset",
+      Vector2(0.5 / input->GetWidth(), 0.5 / input->GetHeight()));
+  filter_program_->SetUniformValue("carryVariance",
+                                   carry_variance_ ? 1.0f : 0.0f);
+  filter_program_->SetUniformValue("varianceScale", kVarianceScale);
+  return Filter::DoRender(updateSinks);
+}
+
+GuidedFilterCoefficientFilter::GuidedFilterCoefficientFilter()
+    : tap_spacing_(2.0), epsilon_(0.002) {}
+
+std::shared_ptr<GuidedFilterCoefficientFilter>
+GuidedFilterCoefficientFilter::Create() {
+  auto ret = std::shared_ptr<GuidedFilterCoefficientFilter>(
+      new GuidedFilterCoefficientFilter());
+  gpupixel::GPUPixelContext::GetInstance()->SyncRunWithContext([&] {
+    if (ret && !ret->Init()) {
+      ret.reset();
+    }
+  });
+  return ret;
+}
+
+bool GuidedFilterCoefficientFilter::Init() {
+  return InitWithFragmentShaderString(
+      kGuidedFilterCoefficientFragmentShaderString);
+}
+
+bool GuidedFilterCoefficientFilter::DoRender(bool updateSinks) {
+  // The input is the unrotated output of the downsampling passes
+  filter_program_->SetUniformValue(
+      "tapOffset", Vector2(tap_spacing_ / framebuffer_->GetWidth(),
+                           tap_spacing_ / framebuffer_->GetHeight()));
+  filter_program_->SetUniformValue("epsilon", epsilon_);
+  filter_program_->SetUniformValue(
+      "varianceScale", GuidedFilterDownsampleFilter::kVarianceScale);
+  return Filter::DoRender(updateSinks);
+}
+
+void GuidedFilterCoefficientFilter::SetTapSpacing(float spacing) {
+  tap_spacing_ = spacing;
+  MarkDirty();
+}
+
+void GuidedFilterCoefficientFilter::SetEpsilon(float epsilon) {
+  epsilon_ = epsilon;
+  MarkDirty();
+}
+
+GuidedBeautyUnitFilter::GuidedBeautyUnitFilter() {}
+
+std::shared_ptr<GuidedBeautyUnitFilter> GuidedBeautyUnitFilter::Create() {
+  auto ret =
+      std::shared_ptr<GuidedBeautyUnitFilter>(new GuidedBeautyUnitFilter());
+  gpupixel::GPUPixelContext::GetInstance()->SyncRunWithContext([&] {
+    if (ret && !ret->Init()) {
+      ret.reset();
+    }
+  });
+  return ret;
+}
+
+bool GuidedBeautyUnitFilter::Init() {
+  if (!InitWithFragmentShaderString(kGuidedBeautyFragmentShaderHeader +
+                                        GetWhitenShaderString() +
+                                        kGuidedBeautyFragmentShaderMain,
+                                    2)) {
+    return false;
+  }
+  return LoadLookupImages();
+}
+
+bool GuidedBeautyUnitFilter::DoRender(bool updateSinks) {
+  // Units 0 and 1 take the inputs
+  BindLookupImages(2);
+  filter_program_->SetUniformValue("blurAlpha", blur_alpha_);
+  filter_program_->SetUniformValue("whiten", white_balance_);
+  return Filter::DoRender(updateSinks);
+}
+
+GuidedBeautyFilter::GuidedBeautyFilter() {}
+
+GuidedBeautyFilter::~GuidedBeautyFilter() {}
+
+std::shared_ptr<GuidedBeautyFilter> GuidedBeautyFilter::Create() {
+  auto ret = std::shared_ptr<GuidedBeautyFilter>(new GuidedBeautyFilter());
+  gpupixel::GPUPixelContext::GetInstance()->SyncRunWithContext([&] {
+    if (ret && !ret->Init()) {
+      ret.reset();
+    }
+  });
+  return ret;
+}
+
+bool GuidedBeautyFilter::Init() {
+  if (!FilterGroup::Init()) {
+    return false;
+  }
+
+  half_filter_ = GuidedFilterDownsampleFilter::Create(false);
+  quarter_filter_ = GuidedFilterDownsampleFilter::Create(true);
+  coefficient_filter_ = GuidedFilterCoefficientFilter::Create();
+  coefficient_blur_filter_ = BoxBlurFilter::Create();
+  unit_filter_ = GuidedBeautyUnitFilter::Create();
+  if (!half_filter_ || !quarter_filter_ || !coefficient_filter_ ||
+      !coefficient_blur_filter_ || !unit_filter_) {
+    return false;
+  }
+  // Averages the coefficients like the second box filter of a guided filter
+  coefficient_blur_filter_->SetRadius(2);
+
+  AddFilter(half_filter_);
+  AddFilter(unit_filter_);
+  half_filter_->AddSink(quarter_filter_)
+      ->AddSink(coefficient_filter_)
+      ->AddSink(coefficient_blur_filter_)
+      ->AddSink(unit_filter_, 1);
+  SetTerminalFilter(unit_filter_);
+  SetRadius(kDefaultRadius);
+
+  RegisterProperty("whiteness", 0,
+                   "The whiteness of filter with range between -1 and 1.",
+                   [this](float& val) { SetWhite(val); });
+
+  RegisterProperty("skin_smoothing", 0,
+                   "The smoothing of filter with range between -1 and 1.",
+                   [this](float& val) { SetBlurAlpha(val); });
+
+  RegisterProperty("radius", kDefaultRadius,
+                   "The half width in pixels of the smoothing window.",
+                   [this](float& val) { SetRadius(val); });
+  return true;
+}
+
+void GuidedBeautyFilter::SetInputFramebuffer(
+    std::shared_ptr<GPUPixelFramebuffer> framebuffer,
+    RotationMode rotation_mode /* = NoRotation*/,
+    int texIdx /* = 0*/) {
+  for (auto& filter : filters_) {
+    filter->SetInputFramebuffer(framebuffer, rotation_mode, texIdx);
+  }
+}
+
+void GuidedBeautyFilter::SetBlurAlpha(float blurAlpha) {
+  unit_filter_->SetBlurAlpha(blurAlpha);
+}
+
+void GuidedBeautyFilter::SetWhite(float white) {
+  unit_filter_->SetWhite(white);
+}
+
+// The 5x5 taps of the coefficients span 4 tap spacings, in texels of the
+// quarter-size image
+void GuidedBeautyFilter::SetRadius(float radius) {
+  coefficient_filter_->SetTapSpacing(radius / 4 / 2);
+}
+
+bool GuidedBeautyFilter::IsIdentity() const {
+  return unit_filter_->IsIdentity();
+}
+
+}  // namespace gpupixel
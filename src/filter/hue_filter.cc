@@ -13,6 +13,7 @@ namespace gpupixel {
 // Adapted from
 // http://stackoverflow.com/questions/9234724/how-to-change-hue-of-a-texture-with-glsl
 // - see for code and discussion
+#if defined(GPUPIXEL_GLES_SHADER)
 const std::string kHueFragmentShaderString = R"(
     precision highp float; uniform sampler2D inputImageTexture;
     uniform mediump float hueAdjustment;
@@ -53,6 +54,48 @@ const std::string kHueFragmentShaderString = R"(
       // Save the result
       gl_FragColor = color;
     })";
+#elif defined(GPUPIXEL_GL_SHADER)
+const std::string kHueFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture;
+    uniform float hueAdjustment;
+    varying vec2 textureCoordinate;
+    const vec4 kRGBToYPrime = vec4(0.299, 0.587, 0.114, 0.0);
+    const vec4 kRGBToI = vec4(0.595716, -0.274453, -0.321263, 0.0);
+    const vec4 kRGBToQ = vec4(0.211456, -0.522591, 0.31135, 0.0);
+    const vec4 kYIQToR = vec4(1.0, 0.9563, 0.6210, 0.0);
+    const vec4 kYIQToG = vec4(1.0, -0.2721, -0.6474, 0.0);
+    const vec4 kYIQToB = vec4(1.0, -1.1070, 1.7046, 0.0);
+
+    void main() {
+      // Sample the input pixel
+      vec4 color = texture2D(inputImageTexture, textureCoordinate);
+
+      // Convert to YIQ
+      float YPrime = dot(color, kRGBToYPrime);
+      float I = dot(color, kRGBToI);
+      float Q = dot(color, kRGBToQ);
+
+      // Calculate the hue and chroma
+      float hue = atan(Q, I);
+      float chroma = sqrt(I * I + Q * Q);
+
+      // Make the user's adjustments
+      hue += (-hueAdjustment);  // why negative rotation?
+
+      // Convert back to YIQ
+      Q = chroma * sin(hue);
+      I = chroma * cos(hue);
+
+      // Convert back to RGB
+      vec4 yIQ = vec4(YPrime, I, Q, 0.0);
+      color.r = dot(yIQ, kYIQToR);
+      color.g = dot(yIQ, kYIQToG);
+      color.b = dot(yIQ, kYIQToB);
+
+      // Save the result
+      gl_FragColor = color;
+    })";
+#endif
 
 std::shared_ptr<HueFilter> HueFilter::Create() {
   auto ret = std::shared_ptr<HueFilter>(new HueFilter());
@@ -88,4 +131,31 @@ bool HueFilter::DoRender(bool updateSinks) {
   return Filter::DoRender(updateSinks);
 }
 
+bool HueFilter::GetColorStage(ColorStage& stage) const {
+  stage.uniforms = R"(
+      uniform float $hueAdjustment;)";
+  stage.code = R"(
+      const vec4 kRGBToYPrime = vec4(0.299, 0.587, 0.114, 0.0);
+      const vec4 kRGBToI = vec4(0.595716, -0.274453, -0.321263, 0.0);
+      const vec4 kRGBToQ = vec4(0.211456, -0.522591, 0.31135, 0.0);
+      const vec4 kYIQToR = vec4(1.0, 0.9563, 0.6210, 0.0);
+      const vec4 kYIQToG = vec4(1.0, -0.2721, -0.6474, 0.0);
+      const vec4 kYIQToB = vec4(1.0, -1.1070, 1.7046, 0.0);
+
+      float YPrime = dot(color, kRGBToYPrime);
+      float I = dot(color, kRGBToI);
+      float Q = dot(color, kRGBToQ);
+      float hue = atan(Q, I) - $hueAdjustment;
+      float chroma = sqrt(I * I + Q * Q);
+      vec4 yIQ = vec4(YPrime, chroma * cos(hue), chroma * sin(hue), 0.0);
+      color.rgb =
+          vec3(dot(yIQ, kYIQToR), dot(yIQ, kYIQToG), dot(yIQ, kYIQToB));)";
+  return true;
+}
+
+void HueFilter::SetColorStageUniforms(GPUPixelGLProgram* program,
+                                      const std::string& prefix) {
+  program->SetUniformValue(prefix + "hueAdjustment", hue_adjustment_);
+}
+
 }  // namespace gpupixel
@@ -201,23 +201,23 @@ bool ImageOverlayFilter::DoRender(bool updateSinks) {
   
   // 第一步：使用默认着色器渲染原图
   GPUPixelContext::GetInstance()->SetActiveGlProgram(filter_program2_);
-  GL_CALL(glClearColor(background_color_.r, background_color_.g,
-                       background_color_.b, background_color_.a));
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  gl_state->ClearColor(background_color_.r, background_color_.g,
+                       background_color_.b, background_color_.a);
   GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
 
   static const float imageVertices[] = {
       -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
   };
 
-  GL_CALL(glActiveTexture(GL_TEXTURE0));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D,
-                        input_framebuffers_[0].frame_buffer->GetTexture()));
+  gl_state->BindTexture(GL_TEXTURE0,
+                        input_framebuffers_[0].frame_buffer->GetTexture());
   filter_program2_->SetUniformValue("inputImageTexture", 0);
 
-  GL_CALL(glEnableVertexAttribArray(position_attribute2_));
+  gl_state->EnableVertexAttribArray(position_attribute2_);
   GL_CALL(glVertexAttribPointer(position_attribute2_, 2, GL_FLOAT, 0, 0, imageVertices));
 
-  GL_CALL(glEnableVertexAttribArray(tex_coord_attribute2_));
+  gl_state->EnableVertexAttribArray(tex_coord_attribute2_);
   GL_CALL(glVertexAttribPointer(tex_coord_attribute2_, 2, GL_FLOAT, 0, 0,
                                 GetTextureCoordinate(NoRotation)));
 
@@ -274,15 +274,13 @@ bool ImageOverlayFilter::DoRender(bool updateSinks) {
 
   if (!overlayVertices.empty()) {
     // 绑定原图纹理（用于在片段着色器中采样）
-    GL_CALL(glActiveTexture(GL_TEXTURE0));
-    GL_CALL(glBindTexture(GL_TEXTURE_2D,
-                          input_framebuffers_[0].frame_buffer->GetTexture()));
+    gl_state->BindTexture(GL_TEXTURE0,
+                          input_framebuffers_[0].frame_buffer->GetTexture());
     filter_program_->SetUniformValue("inputImageTexture", 0);
 
     // 绑定叠加图片纹理
-    GL_CALL(glActiveTexture(GL_TEXTURE1));
-    GL_CALL(glBindTexture(GL_TEXTURE_2D,
-                          image_texture_->GetFramebuffer()->GetTexture()));
+    gl_state->BindTexture(GL_TEXTURE1,
+                          image_texture_->GetFramebuffer()->GetTexture());
     filter_program_->SetUniformValue("overlayTexture", 1);
 
     // 设置 Uniform
@@ -290,12 +288,12 @@ bool ImageOverlayFilter::DoRender(bool updateSinks) {
     filter_program_->SetUniformValue("blendLevel", blend_level_);
 
     // 设置顶点（使用叠加图片的位置）
-    GL_CALL(glEnableVertexAttribArray(position_attribute_));
+    gl_state->EnableVertexAttribArray(position_attribute_);
     GL_CALL(glVertexAttribPointer(position_attribute_, 2, GL_FLOAT, 0, 0,
                                   overlayVertices.data()));
 
     // 设置纹理坐标（叠加图片的纹理坐标）
-    GL_CALL(glEnableVertexAttribArray(tex_coord_attribute_));
+    gl_state->EnableVertexAttribArray(tex_coord_attribute_);
     GL_CALL(glVertexAttribPointer(tex_coord_attribute_, 2, GL_FLOAT, 0, 0,
                                   overlayTexCoords.data()));
 
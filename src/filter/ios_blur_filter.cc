@@ -63,6 +63,12 @@ bool IOSBlurFilter::Init() {
       "downSampling", down_sampling_, "",
       [this](float& downSampling) { setDownSampling(downSampling); });
 
+  RegisterProperty("blurBackend", (int)GaussianBlurFilter::SEPARABLE,
+                   "0 for separable passes, 1 for a downsampling pyramid",
+                   [this](int& blurBackend) {
+                     SetBlurBackend((GaussianBlurFilter::Backend)blurBackend);
+                   });
+
   return true;
 }
 
@@ -71,6 +77,10 @@ void IOSBlurFilter::setBlurSigma(float blurSigma) {
   blur_filter_->setSigma(blurSigma);
 }
 
+void IOSBlurFilter::SetBlurBackend(GaussianBlurFilter::Backend backend) {
+  blur_filter_->SetBackend(backend);
+}
+
 void IOSBlurFilter::setSaturation(float saturation) {
   saturation_ = saturation;
   saturation_filter_->setSaturation(saturation);
@@ -8,8 +8,8 @@
 #include "gpupixel/filter/lookup_filter.h"
 #include "core/gpupixel_context.h"
 #include "core/gpupixel_gl_include.h"
+#include "core/gpupixel_lookup_texture_cache.h"
 #include "utils/util.h"
-#include "stb/stb_image.h"
 
 namespace gpupixel {
 
@@ -87,16 +87,9 @@ const std::string kLookupFragmentShaderString = R"(
 LookupFilter::LookupFilter()
     : lookup_image_path_(""),
       intensity_(1.0f),
-      lookup_texture_(0),
-      lookup_texture_loaded_(false) {}
-
-LookupFilter::~LookupFilter() {
-  if (lookup_texture_loaded_ && lookup_texture_ != 0) {
-    GL_CALL(glDeleteTextures(1, &lookup_texture_));
-    lookup_texture_ = 0;
-    lookup_texture_loaded_ = false;
-  }
-}
+      lookup_texture_pending_(false) {}
+
+LookupFilter::~LookupFilter() {}
 
 std::shared_ptr<LookupFilter> LookupFilter::Create() {
   return Create("");
@@ -121,8 +114,8 @@ bool LookupFilter::Init() {
   }
 
   intensity_ = 1.0f;
-  lookup_texture_ = 0;
-  lookup_texture_loaded_ = false;
+  lookup_texture_.reset();
+  lookup_texture_pending_ = false;
 
   RegisterProperty("intensity", intensity_,
                    "The intensity of the lookup filter effect (0.0 to 1.0).",
@@ -153,63 +146,43 @@ void LookupFilter::SetIntensity(float intensity) {
 }
 
 void LookupFilter::LoadLookupTexture() {
-  // Clean up existing texture
-  if (lookup_texture_loaded_ && lookup_texture_ != 0) {
-    GL_CALL(glDeleteTextures(1, &lookup_texture_));
-    lookup_texture_ = 0;
-    lookup_texture_loaded_ = false;
-  }
-
+  MarkDirty();
   if (lookup_image_path_.empty()) {
+    lookup_texture_.reset();
+    lookup_texture_pending_ = false;
     return;
   }
+  // Decodes in the background, the upload happens when rendering
+  LookupTextureCache::Prefetch(lookup_image_path_);
+  lookup_texture_pending_ = true;
+}
 
-  // Load image using stb_image
-  int width, height, channels;
-  unsigned char* data =
-      stbi_load(lookup_image_path_.c_str(), &width, &height, &channels, 0);
-
-  if (data == nullptr) {
+void LookupFilter::UpdateLookupTexture() {
+  if (!lookup_texture_pending_) {
     return;
   }
-
-  // Create OpenGL texture
-  GL_CALL(glGenTextures(1, &lookup_texture_));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D, lookup_texture_));
-
-  // Set texture parameters
-  GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-  GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-  GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-  GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-
-  // Upload texture data
-  if (channels == 3) {
-    GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB,
-                         GL_UNSIGNED_BYTE, data));
-  } else if (channels == 4) {
-    GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
-                         GL_UNSIGNED_BYTE, data));
-  } else {
-    GL_CALL(glDeleteTextures(1, &lookup_texture_));
-    lookup_texture_ = 0;
-    stbi_image_free(data);
-    return;
+  // The current table stays in use until the new one is decoded, so that
+  // switching tables does not hold up a frame. Without one there is nothing
+  // better to show, so the first table is waited for.
+  std::shared_ptr<GPUPixelFramebuffer> texture;
+  if (LookupTextureCache::Acquire(lookup_image_path_, !lookup_texture_,
+                                  texture)) {
+    lookup_texture_ = texture;
+    lookup_texture_pending_ = false;
+    MarkDirty();
   }
+}
 
-  GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
-
-  // Free image data
-  stbi_image_free(data);
-
-  lookup_texture_loaded_ = true;
+bool LookupFilter::IsIdentity() const {
+  return (!lookup_texture_ && !lookup_texture_pending_) || intensity_ == 0;
 }
 
 bool LookupFilter::DoRender(bool updateSinks) {
-  if (lookup_texture_loaded_ && lookup_texture_ != 0) {
+  UpdateLookupTexture();
+  if (lookup_texture_) {
     // Bind lookup texture to texture unit 1
-    GL_CALL(glActiveTexture(GL_TEXTURE1));
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, lookup_texture_));
+    GPUPixelContext::GetInstance()->GetGlStateCache()->BindTexture(
+        GL_TEXTURE1, lookup_texture_->GetTexture());
 
     // Set uniforms
     filter_program_->SetUniformValue("lookupTexture", 1);
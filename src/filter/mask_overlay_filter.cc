@@ -220,53 +220,57 @@ bool MaskOverlayFilter::DoRender(bool updateSinks) {
     return Filter::DoRender(updateSinks);
   }
 
-  framebuffer_->Activate();
-  
-  // 第一步：渲染原图
-  GPUPixelContext::GetInstance()->SetActiveGlProgram(filter_program2_);
-  GL_CALL(glClearColor(background_color_.r, background_color_.g,
-                       background_color_.b, background_color_.a));
-  GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
-
-  static const float imageVertices[] = {
-      -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
-  };
-
-  GL_CALL(glActiveTexture(GL_TEXTURE0));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D,
-                        input_framebuffers_[0].frame_buffer->GetTexture()));
-  filter_program2_->SetUniformValue("inputImageTexture", 0);
-
-  GL_CALL(glEnableVertexAttribArray(position_attribute2_));
-  GL_CALL(glVertexAttribPointer(position_attribute2_, 2, GL_FLOAT, 0, 0, imageVertices));
-
-  GL_CALL(glEnableVertexAttribArray(tex_coord_attribute2_));
-  GL_CALL(glVertexAttribPointer(tex_coord_attribute2_, 2, GL_FLOAT, 0, 0,
-                                GetTextureCoordinate(NoRotation)));
-
-  GL_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+  // 面罩网格不超出其顶点范围，可直接在输入上绘制
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  uint32_t input_texture = input_framebuffers_[0].frame_buffer->GetTexture();
+  uint32_t region_texture = ActivateInPlace(mask_vertices_);
+  if (region_texture) {
+    input_texture = region_texture;
+  } else {
+    framebuffer_->Activate();
+
+    // 第一步：渲染原图
+    GPUPixelContext::GetInstance()->SetActiveGlProgram(filter_program2_);
+    gl_state->ClearColor(background_color_.r, background_color_.g,
+                         background_color_.b, background_color_.a);
+    GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
+
+    static const float imageVertices[] = {
+        -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
+    };
+
+    gl_state->BindTexture(GL_TEXTURE0, input_texture);
+    filter_program2_->SetUniformValue("inputImageTexture", 0);
+
+    gl_state->EnableVertexAttribArray(position_attribute2_);
+    GL_CALL(glVertexAttribPointer(position_attribute2_, 2, GL_FLOAT, 0, 0,
+                                  imageVertices));
+
+    gl_state->EnableVertexAttribArray(tex_coord_attribute2_);
+    GL_CALL(glVertexAttribPointer(tex_coord_attribute2_, 2, GL_FLOAT, 0, 0,
+                                  GetTextureCoordinate(NoRotation)));
+
+    GL_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+  }
 
   // 第二步：渲染面罩
   GPUPixelContext::GetInstance()->SetActiveGlProgram(filter_program_);
 
-  GL_CALL(glActiveTexture(GL_TEXTURE0));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D,
-                        input_framebuffers_[0].frame_buffer->GetTexture()));
+  gl_state->BindTexture(GL_TEXTURE0, input_texture);
   filter_program_->SetUniformValue("inputImageTexture", 0);
 
-  GL_CALL(glActiveTexture(GL_TEXTURE1));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D,
-                        image_texture_->GetFramebuffer()->GetTexture()));
+  gl_state->BindTexture(GL_TEXTURE1,
+                        image_texture_->GetFramebuffer()->GetTexture());
   filter_program_->SetUniformValue("overlayTexture", 1);
 
   filter_program_->SetUniformValue("opacity", opacity_);
   filter_program_->SetUniformValue("blendLevel", blend_level_);
 
-  GL_CALL(glEnableVertexAttribArray(position_attribute_));
+  gl_state->EnableVertexAttribArray(position_attribute_);
   GL_CALL(glVertexAttribPointer(position_attribute_, 2, GL_FLOAT, 0, 0,
                                 mask_vertices_.data()));
 
-  GL_CALL(glEnableVertexAttribArray(tex_coord_attribute_));
+  gl_state->EnableVertexAttribArray(tex_coord_attribute_);
   GL_CALL(glVertexAttribPointer(tex_coord_attribute_, 2, GL_FLOAT, 0, 0,
                                 mask_tex_coords_.data()));
 
@@ -162,74 +162,82 @@ bool NoseDeroFilter::DoRender(bool updateSinks) {
     return Filter::DoRender(updateSinks);
   }
 
-  framebuffer_->Activate();
-  
-  // 第一步：渲染原图
-  GPUPixelContext::GetInstance()->SetActiveGlProgram(filter_program2_);
-  GL_CALL(glClearColor(background_color_.r, background_color_.g,
-                       background_color_.b, background_color_.a));
-  GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
-
-  static const float imageVertices[] = {
-      -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
-  };
+  // 点45是鼻子中心点（索引45*2和45*2+1）
+  std::vector<float> overlayVertices;
+  if (face_landmarks_.size() >= 92) {
+    float nose_x = face_landmarks_[90];   // 点45的x (索引45*2)
+    float nose_y = face_landmarks_[91];  // 点45的y (索引45*2+1)
 
-  GL_CALL(glActiveTexture(GL_TEXTURE0));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D,
-                        input_framebuffers_[0].frame_buffer->GetTexture()));
-  filter_program2_->SetUniformValue("inputImageTexture", 0);
+    // 以鼻子为中心，构建矩形
+    float half_width = image_width_ * 0.5f;
+    float half_height = image_height_ * 0.5f;
 
-  GL_CALL(glEnableVertexAttribArray(position_attribute2_));
-  GL_CALL(glVertexAttribPointer(position_attribute2_, 2, GL_FLOAT, 0, 0, imageVertices));
+    float x1 = nose_x - half_width;
+    float y1 = nose_y - half_height;
+    float x2 = nose_x + half_width;
+    float y2 = nose_y + half_height;
 
-  GL_CALL(glEnableVertexAttribArray(tex_coord_attribute2_));
-  GL_CALL(glVertexAttribPointer(tex_coord_attribute2_, 2, GL_FLOAT, 0, 0,
-                                GetTextureCoordinate(NoRotation)));
+    overlayVertices = {x1, y1, x2, y1, x1, y2, x2, y2};
+  }
+  std::vector<float> overlayTexCoords = {0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
 
-  GL_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  uint32_t input_texture = input_framebuffers_[0].frame_buffer->GetTexture();
+  // 贴图只覆盖矩形区域，可直接在输入上绘制
+  uint32_t region_texture =
+      overlayVertices.empty() ? 0 : ActivateInPlace(overlayVertices);
+  if (region_texture) {
+    input_texture = region_texture;
+  } else {
+    framebuffer_->Activate();
+
+    // 第一步：渲染原图
+    GPUPixelContext::GetInstance()->SetActiveGlProgram(filter_program2_);
+    gl_state->ClearColor(background_color_.r, background_color_.g,
+                         background_color_.b, background_color_.a);
+    GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
+
+    static const float imageVertices[] = {
+        -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
+    };
+
+    gl_state->BindTexture(GL_TEXTURE0, input_texture);
+    filter_program2_->SetUniformValue("inputImageTexture", 0);
+
+    gl_state->EnableVertexAttribArray(position_attribute2_);
+    GL_CALL(glVertexAttribPointer(position_attribute2_, 2, GL_FLOAT, 0, 0,
+                                  imageVertices));
+
+    gl_state->EnableVertexAttribArray(tex_coord_attribute2_);
+    GL_CALL(glVertexAttribPointer(tex_coord_attribute2_, 2, GL_FLOAT, 0, 0,
+                                  GetTextureCoordinate(NoRotation)));
+
+    GL_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+  }
 
   // 第二步：渲染鼻子贴纸
   GPUPixelContext::GetInstance()->SetActiveGlProgram(filter_program_);
 
-  // 点45是鼻子中心点（索引45*2和45*2+1）
-  if (face_landmarks_.size() < 92) {  // 至少需要46个点
+  if (overlayVertices.empty()) {
     framebuffer_->Deactivate();
     return Source::DoRender(updateSinks);
   }
 
-  float nose_x = face_landmarks_[90];   // 点45的x (索引45*2)
-  float nose_y = face_landmarks_[91];  // 点45的y (索引45*2+1)
-
-  // 以鼻子为中心，构建矩形
-  float half_width = image_width_ * 0.5f;
-  float half_height = image_height_ * 0.5f;
-
-  float x1 = nose_x - half_width;
-  float y1 = nose_y - half_height;
-  float x2 = nose_x + half_width;
-  float y2 = nose_y + half_height;
-
-  std::vector<float> overlayVertices = {x1, y1, x2, y1, x1, y2, x2, y2};
-  std::vector<float> overlayTexCoords = {0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
-
-  GL_CALL(glActiveTexture(GL_TEXTURE0));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D,
-                        input_framebuffers_[0].frame_buffer->GetTexture()));
+  gl_state->BindTexture(GL_TEXTURE0, input_texture);
   filter_program_->SetUniformValue("inputImageTexture", 0);
 
-  GL_CALL(glActiveTexture(GL_TEXTURE1));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D,
-                        image_texture_->GetFramebuffer()->GetTexture()));
+  gl_state->BindTexture(GL_TEXTURE1,
+                        image_texture_->GetFramebuffer()->GetTexture());
   filter_program_->SetUniformValue("overlayTexture", 1);
 
   filter_program_->SetUniformValue("opacity", opacity_);
   filter_program_->SetUniformValue("blendLevel", blend_level_);
 
-  GL_CALL(glEnableVertexAttribArray(position_attribute_));
+  gl_state->EnableVertexAttribArray(position_attribute_);
   GL_CALL(glVertexAttribPointer(position_attribute_, 2, GL_FLOAT, 0, 0,
                                 overlayVertices.data()));
 
-  GL_CALL(glEnableVertexAttribArray(tex_coord_attribute_));
+  gl_state->EnableVertexAttribArray(tex_coord_attribute_);
   GL_CALL(glVertexAttribPointer(tex_coord_attribute_, 2, GL_FLOAT, 0, 0,
                                 overlayTexCoords.data()));
 
@@ -9,6 +9,7 @@
 #include "core/gpupixel_context.h"
 namespace gpupixel {
 
+#if defined(GPUPIXEL_GLES_SHADER)
 const std::string kPixellationFragmentShaderString = R"(
     uniform highp float pixelSize; uniform highp float aspectRatio;
 
@@ -22,6 +23,21 @@ const std::string kPixellationFragmentShaderString = R"(
           0.5 * pixelSizeVec;
       gl_FragColor = texture2D(inputImageTexture, samplePos);
     })";
+#elif defined(GPUPIXEL_GL_SHADER)
+const std::string kPixellationFragmentShaderString = R"(
+    uniform float pixelSize; uniform float aspectRatio;
+
+    uniform sampler2D inputImageTexture;
+    varying vec2 textureCoordinate;
+
+    void main() {
+      vec2 pixelSizeVec = vec2(pixelSize, pixelSize / aspectRatio);
+      vec2 samplePos =
+          floor(textureCoordinate / pixelSizeVec) * pixelSizeVec +
+          0.5 * pixelSizeVec;
+      gl_FragColor = texture2D(inputImageTexture, samplePos);
+    })";
+#endif
 
 std::shared_ptr<PixellationFilter> PixellationFilter::Create() {
   auto ret = std::shared_ptr<PixellationFilter>(new PixellationFilter());
@@ -69,4 +69,18 @@ bool PosterizeFilter::DoRender(bool updateSinks) {
   return Filter::DoRender(updateSinks);
 }
 
+bool PosterizeFilter::GetColorStage(ColorStage& stage) const {
+  stage.uniforms = R"(
+      uniform float $colorLevels;)";
+  stage.code = R"(
+      color = floor((color * $colorLevels) + vec4(0.5)) / $colorLevels;)";
+  stage.bakeable = false;
+  return true;
+}
+
+void PosterizeFilter::SetColorStageUniforms(GPUPixelGLProgram* program,
+                                            const std::string& prefix) {
+  program->SetUniformValue(prefix + "colorLevels", (float)color_levels_);
+}
+
 }  // namespace gpupixel
@@ -0,0 +1,219 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+#include "gpupixel/filter/render_graph.h"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+#include "core/gpupixel_context.h"
+#include "core/gpupixel_framebuffer.h"
+#include "gpupixel/filter/filter_group.h"
+
+namespace gpupixel {
+
+namespace {
+struct GraphNode {
+  Filter* filter = nullptr;
+  size_t bytes = 0;
+  int sink_count = 0;
+  int input_count = 0;
+  bool transient = false;
+  std::vector<Filter*> inputs;
+};
+
+class GraphBuilder {
+ public:
+  explicit GraphBuilder(Source* root) : root_(root) {}
+
+  std::map<Filter*, GraphNode> nodes;
+
+  void Visit(Source* source, int width, int height) {
+    for (auto& it : source->GetSinks()) {
+      AddEdge(source, it.first.get(), width, height);
+    }
+  }
+
+ private:
+  void AddEdge(Source* source, Sink* sink, int width, int height) {
+    // A group forwards its input to all of its filters and renders nothing
+    // itself; its terminal filter owns the group's sinks
+    FilterGroup* group = dynamic_cast<FilterGroup*>(sink);
+    if (group) {
+      for (auto& filter : group->GetFilters()) {
+        AddEdge(source, filter.get(), width, height);
+      }
+      return;
+    }
+
+    Filter* filter = dynamic_cast<Filter*>(sink);
+    if (!filter || filter == root_) {
+      return;
+    }
+
+    bool first_visit = nodes.find(filter) == nodes.end();
+    GraphNode& node = nodes[filter];
+    node.input_count++;
+    Filter* input = dynamic_cast<Filter*>(source);
+    if (input && input != root_) {
+      node.inputs.push_back(input);
+    }
+    if (!first_visit) {
+      return;
+    }
+
+    node.filter = filter;
+    node.sink_count = filter->GetSinks().size();
+    int output_width = int(width * filter->GetFramebufferScale());
+    int output_height = int(height * filter->GetFramebufferScale());
+    node.bytes = (size_t)output_width * output_height * 4;
+    Visit(filter, output_width, output_height);
+  }
+
+  Source* root_;
+};
+
+// The sink a color filter can be fused with: a color filter that is its only
+// sink and has no other input. Sizes must not change along the chain.
+std::shared_ptr<Filter> GetFusableSink(std::map<Filter*, GraphNode>& nodes,
+                                       Filter* filter) {
+  Filter::ColorStage stage;
+  if (!filter->GetColorStage(stage) || filter->GetFramebufferScale() != 1.0 ||
+      filter->GetSinks().size() != 1) {
+    return nullptr;
+  }
+  std::shared_ptr<Filter> sink =
+      std::dynamic_pointer_cast<Filter>(filter->GetSinks().begin()->first);
+  auto it = nodes.find(sink.get());
+  if (!sink || it == nodes.end() || it->second.input_count != 1 ||
+      !sink->GetColorStage(stage) || sink->GetFramebufferScale() != 1.0) {
+    return nullptr;
+  }
+  return sink;
+}
+}  // namespace
+
+RenderGraphReport RenderGraph::Compile(std::shared_ptr<Source> source,
+                                       bool alias /* = true*/,
+                                       bool fuse /* = true*/,
+                                       bool bake /* = false*/) {
+  RenderGraphReport report = {0, 0, 0, 0, 0, 0};
+  if (!source) {
+    return report;
+  }
+
+  // Runs on the context thread so that no frame renders while the flags
+  // change
+  source->GetContext()->SyncRunWithContext([&] {
+    int width = 0;
+    int height = 0;
+    std::shared_ptr<GPUPixelFramebuffer> framebuffer =
+        source->GetFramebuffer();
+    if (framebuffer) {
+      width = source->GetRotatedFramebufferWidth();
+      height = source->GetRotatedFramebufferHeight();
+    }
+
+    GraphBuilder builder(source.get());
+    builder.Visit(source.get(), width, height);
+
+    std::map<Filter*, std::shared_ptr<Filter>> fusable_sinks;
+    std::set<Filter*> fused_filters;
+    for (auto& it : builder.nodes) {
+      it.first->SetFusedStages({});
+      if (fuse || bake) {
+        std::shared_ptr<Filter> sink = GetFusableSink(builder.nodes, it.first);
+        if (sink) {
+          fusable_sinks[it.first] = sink;
+          fused_filters.insert(sink.get());
+        }
+      }
+    }
+    // Each chain renders in the pass of its first filter. When baking, a
+    // single color filter is a chain too.
+    for (auto& it : builder.nodes) {
+      Filter* head = it.first;
+      Filter::ColorStage stage;
+      if (fused_filters.count(head) || !head->GetColorStage(stage) ||
+          (!fusable_sinks.count(head) && !bake)) {
+        continue;
+      }
+      std::vector<std::shared_ptr<Filter>> stages;
+      for (auto next = fusable_sinks.find(head); next != fusable_sinks.end();
+           next = fusable_sinks.find(next->second.get())) {
+        stages.push_back(next->second);
+      }
+      if (bake && head->SetFusedStages(stages, true)) {
+        report.baked_count += stages.size() + 1;
+      } else if (stages.empty() || !fuse || !head->SetFusedStages(stages)) {
+        for (auto& fused_stage : stages) {
+          fused_filters.erase(fused_stage.get());
+        }
+      }
+    }
+    report.fused_count = fused_filters.size();
+
+    size_t persistent_bytes = 0;
+    size_t waiting_bytes = 0;
+    size_t largest_pass_bytes = 0;
+    for (auto& it : builder.nodes) {
+      GraphNode& node = it.second;
+      node.transient = alias && node.sink_count > 0;
+      node.filter->SetTransientOutput(node.transient);
+
+      report.filter_count++;
+      report.peak_bytes_before += node.bytes;
+      if (fused_filters.count(node.filter)) {
+        // Holds no target of its own; its output is the fused pass's
+        node.bytes = 0;
+        continue;
+      }
+      if (!node.transient) {
+        persistent_bytes += node.bytes;
+      } else {
+        report.transient_count++;
+      }
+    }
+
+    if (!alias) {
+      report.peak_bytes_after = persistent_bytes;
+      return;
+    }
+
+    for (auto& it : builder.nodes) {
+      GraphNode& node = it.second;
+      // A pass holds its own output and its transient inputs while drawing
+      size_t pass_bytes = node.transient ? node.bytes : 0;
+      for (Filter* input : node.inputs) {
+        GraphNode& input_node = builder.nodes[input];
+        if (input_node.transient) {
+          pass_bytes += input_node.bytes;
+        }
+      }
+      largest_pass_bytes = std::max(largest_pass_bytes, pass_bytes);
+
+      // An output feeding several sinks, or a sink that waits for another
+      // input, may stay alive while other branches render
+      if (node.transient && node.sink_count > 1) {
+        waiting_bytes += node.bytes;
+      } else if (node.input_count > 1) {
+        for (Filter* input : node.inputs) {
+          GraphNode& input_node = builder.nodes[input];
+          if (input_node.transient && input_node.sink_count == 1) {
+            waiting_bytes += input_node.bytes;
+          }
+        }
+      }
+    }
+    report.peak_bytes_after =
+        std::min(report.peak_bytes_before,
+                 persistent_bytes + largest_pass_bytes + waiting_bytes);
+  });
+  return report;
+}
+
+}  // namespace gpupixel
@@ -9,6 +9,7 @@
 #include "core/gpupixel_context.h"
 namespace gpupixel {
 
+#if defined(GPUPIXEL_GLES_SHADER)
 const std::string kRGBFragmentShaderString = R"(
     uniform sampler2D inputImageTexture; uniform highp float redAdjustment;
     uniform highp float greenAdjustment;
@@ -20,6 +21,19 @@ const std::string kRGBFragmentShaderString = R"(
       gl_FragColor = vec4(color.r * redAdjustment, color.g * greenAdjustment,
                           color.b * blueAdjustment, color.a);
     })";
+#elif defined(GPUPIXEL_GL_SHADER)
+const std::string kRGBFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture; uniform float redAdjustment;
+    uniform float greenAdjustment;
+    uniform float blueAdjustment;
+    varying vec2 textureCoordinate;
+
+    void main() {
+      vec4 color = texture2D(inputImageTexture, textureCoordinate);
+      gl_FragColor = vec4(color.r * redAdjustment, color.g * greenAdjustment,
+                          color.b * blueAdjustment, color.a);
+    })";
+#endif
 
 std::shared_ptr<RGBFilter> RGBFilter::Create() {
   auto ret = std::shared_ptr<RGBFilter>(new RGBFilter());
@@ -90,4 +104,20 @@ bool RGBFilter::DoRender(bool updateSinks) {
   return Filter::DoRender(updateSinks);
 }
 
+bool RGBFilter::GetColorStage(ColorStage& stage) const {
+  stage.uniforms = R"(
+      uniform float $redAdjustment; uniform float $greenAdjustment;
+      uniform float $blueAdjustment;)";
+  stage.code = R"(
+      color.rgb *= vec3($redAdjustment, $greenAdjustment, $blueAdjustment);)";
+  return true;
+}
+
+void RGBFilter::SetColorStageUniforms(GPUPixelGLProgram* program,
+                                      const std::string& prefix) {
+  program->SetUniformValue(prefix + "redAdjustment", red_adjustment_);
+  program->SetUniformValue(prefix + "greenAdjustment", green_adjustment_);
+  program->SetUniformValue(prefix + "blueAdjustment", blue_adjustment_);
+}
+
 }  // namespace gpupixel
@@ -9,6 +9,7 @@
 #include "core/gpupixel_context.h"
 namespace gpupixel {
 
+#if defined(GPUPIXEL_GLES_SHADER)
 const std::string kSaturationFragmentShaderString = R"(
     uniform sampler2D inputImageTexture; uniform lowp float saturation;
     varying highp vec2 textureCoordinate;
@@ -24,6 +25,23 @@ const std::string kSaturationFragmentShaderString = R"(
 
       gl_FragColor = vec4(mix(greyScaleColor, color.rgb, saturation), color.a);
     })";
+#elif defined(GPUPIXEL_GL_SHADER)
+const std::string kSaturationFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture; uniform float saturation;
+    varying vec2 textureCoordinate;
+
+    // Values from "Graphics Shaders: Theory and Practice" by Bailey and
+    // Cunningham
+    const vec3 luminanceWeighting = vec3(0.2125, 0.7154, 0.0721);
+
+    void main() {
+      vec4 color = texture2D(inputImageTexture, textureCoordinate);
+      float luminance = dot(color.rgb, luminanceWeighting);
+      vec3 greyScaleColor = vec3(luminance);
+
+      gl_FragColor = vec4(mix(greyScaleColor, color.rgb, saturation), color.a);
+    })";
+#endif
 
 std::shared_ptr<SaturationFilter> SaturationFilter::Create() {
   auto ret = std::shared_ptr<SaturationFilter>(new SaturationFilter());
@@ -64,4 +82,18 @@ bool SaturationFilter::DoRender(bool updateSinks) {
   return Filter::DoRender(updateSinks);
 }
 
+bool SaturationFilter::GetColorStage(ColorStage& stage) const {
+  stage.uniforms = R"(
+      uniform float $saturation;)";
+  stage.code = R"(
+      float luminance = dot(color.rgb, vec3(0.2125, 0.7154, 0.0721));
+      color.rgb = mix(vec3(luminance), color.rgb, $saturation);)";
+  return true;
+}
+
+void SaturationFilter::SetColorStageUniforms(GPUPixelGLProgram* program,
+                                             const std::string& prefix) {
+  program->SetUniformValue(prefix + "saturation", saturation_);
+}
+
 }  // namespace gpupixel
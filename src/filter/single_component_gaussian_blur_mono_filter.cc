@@ -233,4 +233,67 @@ SingleComponentGaussianBlurMonoFilter::GenerateOptimizedFragmentShaderString(
   return shaderStr;
 }
 
+std::string SingleComponentGaussianBlurMonoFilter::
+    GenerateParametricFragmentShaderString() {
+#if defined(GPUPIXEL_GLES_SHADER)
+  return Util::StringFormat(
+      "\
+      uniform sampler2D inputImageTexture;\n\
+      uniform highp float texelWidthOffset;\n\
+      uniform highp float texelHeightOffset;\n\
+      uniform highp float centerWeight;\n\
+      uniform highp float sampleOffsets[%d];\n\
+      uniform highp float sampleWeights[%d];\n\
+      uniform int sampleCount;\n\
+      varying highp vec2 textureCoordinate;\n\
+      void main()\n\
+      {\n\
+      highp vec2 texelSpacing = vec2(texelWidthOffset, texelHeightOffset);\n\
+      mediump float sum = texture2D(inputImageTexture, textureCoordinate).r *\n\
+                          centerWeight;\n\
+      for (int i = 0; i < %d; i++) {\n\
+        if (i >= sampleCount) {\n\
+          break;\n\
+        }\n\
+        highp vec2 offset = texelSpacing * sampleOffsets[i];\n\
+        sum += (texture2D(inputImageTexture, textureCoordinate + offset).r +\n\
+                texture2D(inputImageTexture, textureCoordinate - offset).r) *\n\
+               sampleWeights[i];\n\
+      }\n\
+      gl_FragColor = vec4(sum, sum, sum, 1.0);\n\
+      }",
+      kMaxParametricRadius / 2, kMaxParametricRadius / 2,
+      kMaxParametricRadius / 2);
+#elif defined(GPUPIXEL_GL_SHADER)
+  return Util::StringFormat(
+      "\
+      uniform sampler2D inputImageTexture;\n\
+      uniform float texelWidthOffset;\n\
+      uniform float texelHeightOffset;\n\
+      uniform float centerWeight;\n\
+      uniform float sampleOffsets[%d];\n\
+      uniform float sampleWeights[%d];\n\
+      uniform int sampleCount;\n\
+      varying vec2 textureCoordinate;\n\
+      void main()\n\
+      {\n\
+      vec2 texelSpacing = vec2(texelWidthOffset, texelHeightOffset);\n\
+      float sum = texture2D(inputImageTexture, textureCoordinate).r *\n\
+                  centerWeight;\n\
+      for (int i = 0; i < %d; i++) {\n\
+        if (i >= sampleCount) {\n\
+          break;\n\
+        }\n\
+        vec2 offset = texelSpacing * sampleOffsets[i];\n\
+        sum += (texture2D(inputImageTexture, textureCoordinate + offset).r +\n\
+                texture2D(inputImageTexture, textureCoordinate - offset).r) *\n\
+               sampleWeights[i];\n\
+      }\n\
+      gl_FragColor = vec4(sum, sum, sum, 1.0);\n\
+      }",
+      kMaxParametricRadius / 2, kMaxParametricRadius / 2,
+      kMaxParametricRadius / 2);
+#endif
+}
+
 }  // namespace gpupixel
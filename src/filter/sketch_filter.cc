@@ -10,6 +10,7 @@
 #include "utils/util.h"
 namespace gpupixel {
 
+#if defined(GPUPIXEL_GLES_SHADER)
 const std::string kSketchFilterFragmentShaderString = R"(
     precision mediump float; uniform sampler2D inputImageTexture;
     uniform float edgeStrength;
@@ -47,6 +48,45 @@ const std::string kSketchFilterFragmentShaderString = R"(
       float mag = 1.0 - length(vec2(h, v)) * edgeStrength;
       gl_FragColor = vec4(vec3(mag), 1.0);
     })";
+#elif defined(GPUPIXEL_GL_SHADER)
+const std::string kSketchFilterFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture;
+    uniform float edgeStrength;
+
+    varying vec2 textureCoordinate;
+    varying vec2 vLeftTexCoord;
+    varying vec2 vRightTexCoord;
+
+    varying vec2 vTopTexCoord;
+    varying vec2 vTopLeftTexCoord;
+    varying vec2 vTopRightTexCoord;
+
+    varying vec2 vBottomTexCoord;
+    varying vec2 vBottomLeftTexCoord;
+    varying vec2 vBottomRightTexCoord;
+
+    void main() {
+      float bottomLeftIntensity =
+          texture2D(inputImageTexture, vBottomLeftTexCoord).r;
+      float topRightIntensity =
+          texture2D(inputImageTexture, vTopRightTexCoord).r;
+      float topLeftIntensity = texture2D(inputImageTexture, vTopLeftTexCoord).r;
+      float bottomRightIntensity =
+          texture2D(inputImageTexture, vBottomRightTexCoord).r;
+      float leftIntensity = texture2D(inputImageTexture, vLeftTexCoord).r;
+      float rightIntensity = texture2D(inputImageTexture, vRightTexCoord).r;
+      float bottomIntensity = texture2D(inputImageTexture, vBottomTexCoord).r;
+      float topIntensity = texture2D(inputImageTexture, vTopTexCoord).r;
+      float h = -topLeftIntensity - 2.0 * topIntensity - topRightIntensity +
+                bottomLeftIntensity + 2.0 * bottomIntensity +
+                bottomRightIntensity;
+      float v = -bottomLeftIntensity - 2.0 * leftIntensity - topLeftIntensity +
+                bottomRightIntensity + 2.0 * rightIntensity + topRightIntensity;
+
+      float mag = 1.0 - length(vec2(h, v)) * edgeStrength;
+      gl_FragColor = vec4(vec3(mag), 1.0);
+    })";
+#endif
 
 SketchFilter::SketchFilter() : grayscale_filter_(0), sketch_filter_(0) {}
 
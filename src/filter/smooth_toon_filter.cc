@@ -30,6 +30,9 @@ bool SmoothToonFilter::Init() {
   }
   gaussian_blur_filter_ = GaussianBlurFilter::Create();
   toon_filter_ = ToonFilter::Create();
+  if (!gaussian_blur_filter_ || !toon_filter_) {
+    return false;
+  }
   gaussian_blur_filter_->AddSink(toon_filter_);
   AddFilter(gaussian_blur_filter_);
 
@@ -52,6 +55,12 @@ bool SmoothToonFilter::Init() {
                      setToonQuantizationLevels(toonQuantizationLevels);
                    });
 
+  RegisterProperty("blurBackend", (int)GaussianBlurFilter::SEPARABLE,
+                   "0 for separable passes, 1 for a downsampling pyramid",
+                   [this](int& blurBackend) {
+                     SetBlurBackend((GaussianBlurFilter::Backend)blurBackend);
+                   });
+
   return true;
 }
 
@@ -60,6 +69,10 @@ void SmoothToonFilter::setBlurRadius(int blurRadius) {
   gaussian_blur_filter_->SetRadius(blur_radius_);
 }
 
+void SmoothToonFilter::SetBlurBackend(GaussianBlurFilter::Backend backend) {
+  gaussian_blur_filter_->SetBackend(backend);
+}
+
 void SmoothToonFilter::setToonThreshold(float toonThreshold) {
   toon_threshold_ = toonThreshold;
   toon_filter_->setThreshold(toon_threshold_);
@@ -78,6 +78,12 @@ const std::string kSphereRefractionShaderString = R"(
 )";
 #endif
 
+SphereRefractionFilter::SphereRefractionFilter() {
+  // The shader writes transparent black outside the sphere, so the cleared
+  // background can stand in for it there
+  background_color_.a = 0.0;
+}
+
 std::shared_ptr<SphereRefractionFilter> SphereRefractionFilter::Create() {
   auto ret =
       std::shared_ptr<SphereRefractionFilter>(new SphereRefractionFilter());
@@ -133,6 +139,14 @@ bool SphereRefractionFilter::DoRender(bool updateSinks) {
                 (float)(firstInputFramebuffer->GetWidth());
   filter_program_->SetUniformValue("aspectRatio", aspectRatio);
 
+  // Only the sphere's bounding box needs shading
+  if (input_framebuffers_.begin()->second.rotation_mode == NoRotation) {
+    float y1 = (position_.y - radius_ - 0.5f) / aspectRatio + 0.5f;
+    float y2 = (position_.y + radius_ - 0.5f) / aspectRatio + 0.5f;
+    SetRenderBounds(2 * (position_.x - radius_) - 1, 2 * y1 - 1,
+                    2 * (position_.x + radius_) - 1, 2 * y2 - 1);
+  }
+
   return Filter::DoRender(updateSinks);
 }
 
@@ -0,0 +1,275 @@
+/*
+ * GPUPixel
+ *
+ * Created by PixPark on 2021/6/24.
+ * Copyright © 2021 PixPark. All rights reserved.
+ */
+
+#include "gpupixel/filter/summed_area_table_blur_filter.h"
+#include <cmath>
+#include "core/gpupixel_context.h"
+#include "utils/logging.h"
+
+namespace gpupixel {
+
+namespace {
+
+const float kTableVertices[] = {
+    -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
+};
+
+#if defined(GPUPIXEL_GLES_SHADER)
+const std::string kPrefixSumFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture;
+    uniform highp vec2 sampleStep;
+    uniform highp float stride;
+    uniform highp vec2 axis;
+    uniform highp float bias;
+    varying highp vec2 textureCoordinate;
+
+    void main() {
+      // Texels before the start of the row or column add nothing
+      highp float position = dot(floor(gl_FragCoord.xy), axis);
+      highp vec3 inside = step(vec3(1.0, 2.0, 3.0) * stride, vec3(position));
+      highp vec4 sum = texture2D(inputImageTexture, textureCoordinate) + bias;
+      sum += (texture2D(inputImageTexture, textureCoordinate - sampleStep) +
+              bias) *
+             inside.x;
+      sum += (texture2D(inputImageTexture,
+                        textureCoordinate - sampleStep * 2.0) +
+              bias) *
+             inside.y;
+      sum += (texture2D(inputImageTexture,
+                        textureCoordinate - sampleStep * 3.0) +
+              bias) *
+             inside.z;
+      gl_FragColor = sum;
+    })";
+
+const std::string kBoxAverageFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture;
+    uniform highp vec2 tableSize;
+    uniform highp float radius;
+    varying highp vec2 textureCoordinate;
+
+    highp vec4 tableAt(highp vec2 position) {
+      return texture2D(inputImageTexture, (position + 0.5) / tableSize);
+    }
+
+    void main() {
+      highp vec2 position = floor(gl_FragCoord.xy);
+      highp vec2 high = min(position + radius, tableSize - 1.0);
+      highp vec2 low = position - radius - 1.0;
+      // Corners before the first row or column sum to nothing
+      highp vec2 inside = step(0.0, low);
+      low = max(low, -1.0);
+      highp vec2 count = high - low;
+      highp vec4 sum = tableAt(high) -
+                       tableAt(vec2(low.x, high.y)) * inside.x -
+                       tableAt(vec2(high.x, low.y)) * inside.y +
+                       tableAt(low) * inside.x * inside.y;
+      gl_FragColor = sum / (count.x * count.y) + 0.5;
+    })";
+#elif defined(GPUPIXEL_GL_SHADER)
+const std::string kPrefixSumFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture; uniform vec2 sampleStep;
+    uniform float stride; uniform vec2 axis; uniform float bias;
+    varying vec2 textureCoordinate;
+
+    void main() {
+      // Texels before the start of the row or column add nothing
+      float position = dot(floor(gl_FragCoord.xy), axis);
+      vec3 inside = step(vec3(1.0, 2.0, 3.0) * stride, vec3(position));
+      vec4 sum = texture2D(inputImageTexture, textureCoordinate) + bias;
+      sum += (texture2D(inputImageTexture, textureCoordinate - sampleStep) +
+              bias) *
+             inside.x;
+      sum += (texture2D(inputImageTexture,
+                        textureCoordinate - sampleStep * 2.0) +
+              bias) *
+             inside.y;
+      sum += (texture2D(inputImageTexture,
+                        textureCoordinate - sampleStep * 3.0) +
+              bias) *
+             inside.z;
+      gl_FragColor = sum;
+    })";
+
+const std::string kBoxAverageFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture; uniform vec2 tableSize;
+    uniform float radius;
+    varying vec2 textureCoordinate;
+
+    vec4 tableAt(vec2 position) {
+      return texture2D(inputImageTexture, (position + 0.5) / tableSize);
+    }
+
+    void main() {
+      vec2 position = floor(gl_FragCoord.xy);
+      vec2 high = min(position + radius, tableSize - 1.0);
+      vec2 low = position - radius - 1.0;
+      // Corners before the first row or column sum to nothing
+      vec2 inside = step(0.0, low);
+      low = max(low, -1.0);
+      vec2 count = high - low;
+      vec4 sum = tableAt(high) - tableAt(vec2(low.x, high.y)) * inside.x -
+                 tableAt(vec2(high.x, low.y)) * inside.y +
+                 tableAt(low) * inside.x * inside.y;
+      gl_FragColor = sum / (count.x * count.y) + 0.5;
+    })";
+#endif
+
+}  // namespace
+
+SummedAreaTableBlurFilter::SummedAreaTableBlurFilter()
+    : radius_(4.0), prefix_program_(0), table_index_(0) {}
+
+SummedAreaTableBlurFilter::~SummedAreaTableBlurFilter() {
+  if (prefix_program_) {
+    delete prefix_program_;
+    prefix_program_ = 0;
+  }
+}
+
+std::shared_ptr<SummedAreaTableBlurFilter> SummedAreaTableBlurFilter::Create(
+    float radius /* = 4.0*/) {
+  auto ret = std::shared_ptr<SummedAreaTableBlurFilter>(
+      new SummedAreaTableBlurFilter());
+  gpupixel::GPUPixelContext::GetInstance()->SyncRunWithContext([&] {
+    if (ret && !ret->Init(radius)) {
+      ret.reset();
+    }
+  });
+  return ret;
+}
+
+bool SummedAreaTableBlurFilter::Init(float radius) {
+  if (!GPUPixelContext::GetInstance()->SupportsFloatFramebuffers()) {
+    LOG_WARN("SummedAreaTableBlurFilter: float framebuffers are unsupported");
+    return false;
+  }
+  // The box average reads the table through Filter::DoRender
+  if (!InitWithFragmentShaderString(kBoxAverageFragmentShaderString)) {
+    return false;
+  }
+  prefix_program_ = GPUPixelGLProgram::CreateWithShaderString(
+      kDefaultVertexShader, kPrefixSumFragmentShaderString);
+  if (!prefix_program_) {
+    return false;
+  }
+
+  SetRadius(radius);
+  RegisterProperty("radius", radius_,
+                   "Half width in pixels of the box to average",
+                   [this](float& radius) { SetRadius(radius); });
+  return true;
+}
+
+void SummedAreaTableBlurFilter::SetRadius(float radius) {
+  if (radius == radius_) {
+    return;
+  }
+  radius_ = radius;
+  MarkDirty();
+}
+
+bool SummedAreaTableBlurFilter::DoRender(bool updateSinks) {
+  InputFrameBufferInfo& input = input_framebuffers_.begin()->second;
+  int width = framebuffer_->GetWidth();
+  int height = framebuffer_->GetHeight();
+
+  bool resized = false;
+  for (auto& table : tables_) {
+    if (!table || table->GetWidth() != width ||
+        table->GetHeight() != height) {
+      table = GPUPixelContext::GetInstance()
+                  ->GetFramebufferFactory()
+                  ->CreateFramebuffer(
+                      width, height, false,
+                      GPUPixelFramebuffer::float_texture_attributes);
+      resized = true;
+    }
+  }
+
+  // A new radius only needs the last pass
+  std::vector<uint64_t> signature = {input.frame_buffer->GetContentVersion(),
+                                     (uint64_t)input.rotation_mode};
+  if (resized || signature != table_signature_) {
+    // Rows, then columns. The first pass also centers the input around 0,
+    // which keeps more precision in the large sums.
+    RenderPrefixPass(input.frame_buffer, input.rotation_mode, tables_[0],
+                     false, 1, -0.5);
+    int current = 0;
+    for (int stride = 4; stride < width; stride *= 4) {
+      RenderPrefixPass(tables_[current], NoRotation, tables_[1 - current],
+                       false, stride, 0.0);
+      current = 1 - current;
+    }
+    for (int stride = 1; stride < height; stride *= 4) {
+      RenderPrefixPass(tables_[current], NoRotation, tables_[1 - current],
+                       true, stride, 0.0);
+      current = 1 - current;
+    }
+    table_index_ = current;
+    table_signature_ = signature;
+  }
+
+  // The box average reads the table in place of the input while it draws
+  InputFrameBufferInfo original_input = input;
+  input.frame_buffer = tables_[table_index_];
+  input.rotation_mode = NoRotation;
+  filter_program_->SetUniformValue("tableSize", Vector2(width, height));
+  filter_program_->SetUniformValue("radius", std::floor(radius_ + 0.5f));
+  // The sinks run last, as they may release the input
+  Filter::DoRender(false);
+  input = original_input;
+  return Source::DoRender(updateSinks);
+}
+
+void SummedAreaTableBlurFilter::RenderPrefixPass(
+    const std::shared_ptr<GPUPixelFramebuffer>& source,
+    RotationMode rotation,
+    const std::shared_ptr<GPUPixelFramebuffer>& target,
+    bool vertical,
+    int stride,
+    float bias) {
+  const float* texture_coordinate = GetTextureCoordinate(rotation);
+  // Texture space offset of one target texel along the axis, which the
+  // rotation may turn
+  Vector2 texel_step =
+      vertical ? Vector2((texture_coordinate[4] - texture_coordinate[0]) /
+                             target->GetHeight(),
+                         (texture_coordinate[5] - texture_coordinate[1]) /
+                             target->GetHeight())
+               : Vector2((texture_coordinate[2] - texture_coordinate[0]) /
+                             target->GetWidth(),
+                         (texture_coordinate[3] - texture_coordinate[1]) /
+                             target->GetWidth());
+
+  GPUPixelContext::GetInstance()->SetActiveGlProgram(prefix_program_);
+  target->Activate();
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  gl_state->BindTexture(GL_TEXTURE0, source->GetTexture());
+  prefix_program_->SetUniformValue(prefix_program_->GetInputTextureUniform(0),
+                                   0);
+  prefix_program_->SetUniformValue(
+      "sampleStep", Vector2(texel_step.x * stride, texel_step.y * stride));
+  prefix_program_->SetUniformValue("stride", (float)stride);
+  prefix_program_->SetUniformValue(
+      "axis", vertical ? Vector2(0.0, 1.0) : Vector2(1.0, 0.0));
+  prefix_program_->SetUniformValue("bias", bias);
+
+  uint32_t position_attribute = prefix_program_->GetAttribLocation("position");
+  uint32_t tex_coord_attribute = prefix_program_->GetInputTexCoordAttribute(0);
+  gl_state->EnableVertexAttribArray(position_attribute);
+  gl_state->EnableVertexAttribArray(tex_coord_attribute);
+  GL_CALL(glVertexAttribPointer(position_attribute, 2, GL_FLOAT, 0, 0,
+                                kTableVertices));
+  GL_CALL(glVertexAttribPointer(tex_coord_attribute, 2, GL_FLOAT, 0, 0,
+                                texture_coordinate));
+  GL_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+  target->Deactivate();
+  GPUPixelContext::GetInstance()->CountPass(false);
+}
+
+}  // namespace gpupixel
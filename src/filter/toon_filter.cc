@@ -9,6 +9,7 @@
 #include "core/gpupixel_context.h"
 namespace gpupixel {
 
+#if defined(GPUPIXEL_GLES_SHADER)
 const std::string kToonFragmentShaderString = R"(
     precision mediump float; uniform sampler2D inputImageTexture;
     uniform float threshold;
@@ -54,6 +55,53 @@ const std::string kToonFragmentShaderString = R"(
 
       gl_FragColor = vec4(posterizedImageColor * thresholdTest, color.a);
     })";
+#elif defined(GPUPIXEL_GL_SHADER)
+const std::string kToonFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture;
+    uniform float threshold;
+    uniform float quantizationLevels;
+
+    varying vec2 textureCoordinate;
+    varying vec2 vLeftTexCoord;
+    varying vec2 vRightTexCoord;
+
+    varying vec2 vTopTexCoord;
+    varying vec2 vTopLeftTexCoord;
+    varying vec2 vTopRightTexCoord;
+
+    varying vec2 vBottomTexCoord;
+    varying vec2 vBottomLeftTexCoord;
+    varying vec2 vBottomRightTexCoord;
+
+    void main() {
+      float bottomLeftIntensity =
+          texture2D(inputImageTexture, vBottomLeftTexCoord).r;
+      float topRightIntensity =
+          texture2D(inputImageTexture, vTopRightTexCoord).r;
+      float topLeftIntensity = texture2D(inputImageTexture, vTopLeftTexCoord).r;
+      float bottomRightIntensity =
+          texture2D(inputImageTexture, vBottomRightTexCoord).r;
+      float leftIntensity = texture2D(inputImageTexture, vLeftTexCoord).r;
+      float rightIntensity = texture2D(inputImageTexture, vRightTexCoord).r;
+      float bottomIntensity = texture2D(inputImageTexture, vBottomTexCoord).r;
+      float topIntensity = texture2D(inputImageTexture, vTopTexCoord).r;
+      float h = -topLeftIntensity - 2.0 * topIntensity - topRightIntensity +
+                bottomLeftIntensity + 2.0 * bottomIntensity +
+                bottomRightIntensity;
+      float v = -bottomLeftIntensity - 2.0 * leftIntensity - topLeftIntensity +
+                bottomRightIntensity + 2.0 * rightIntensity + topRightIntensity;
+
+      float mag = length(vec2(h, v));
+
+      vec4 color = texture2D(inputImageTexture, textureCoordinate);
+      vec3 posterizedImageColor =
+          (floor(color.rgb * quantizationLevels) + 0.5) / quantizationLevels;
+
+      float thresholdTest = 1.0 - step(threshold, mag);
+
+      gl_FragColor = vec4(posterizedImageColor * thresholdTest, color.a);
+    })";
+#endif
 
 std::shared_ptr<ToonFilter> ToonFilter::Create() {
   auto ret = std::shared_ptr<ToonFilter>(new ToonFilter());
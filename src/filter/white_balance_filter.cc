@@ -9,6 +9,7 @@
 #include "core/gpupixel_context.h"
 namespace gpupixel {
 
+#if defined(GPUPIXEL_GLES_SHADER)
 const std::string kWhiteBalanceFragmentShaderString = R"(
     uniform sampler2D inputImageTexture; uniform lowp float temperature;
     uniform lowp float tint;
@@ -40,6 +41,39 @@ const std::string kWhiteBalanceFragmentShaderString = R"(
 
       gl_FragColor = vec4(mix(rgb, processed, temperature), color.a);
     })";
+#elif defined(GPUPIXEL_GL_SHADER)
+const std::string kWhiteBalanceFragmentShaderString = R"(
+    uniform sampler2D inputImageTexture; uniform float temperature;
+    uniform float tint;
+    varying vec2 textureCoordinate;
+    const vec3 warmFilter = vec3(0.93, 0.54, 0.0);
+    const mat3 RGBtoYIQ =
+        mat3(0.299, 0.587, 0.114,
+             0.596, -0.274, -0.322,
+             0.212, -0.523, 0.311);
+    const mat3 YIQtoRGB =
+        mat3(1.0, 0.956, 0.621,
+             1.0, -0.272, -0.647,
+             1.0, -1.105, 1.702);
+
+    void main() {
+      vec4 color = texture2D(inputImageTexture, textureCoordinate);
+      vec3 yiq = RGBtoYIQ * color.rgb;  // adjusting tint
+      yiq.b = clamp(yiq.b + tint * 0.5226 * 0.1, -0.5226, 0.5226);
+      vec3 rgb = YIQtoRGB * yiq;
+      vec3 processed = vec3(
+          (rgb.r < 0.5
+               ? (2.0 * rgb.r * warmFilter.r)
+               : (1.0 - 2.0 * (1.0 - rgb.r) *
+                            (1.0 - warmFilter.r))),  // adjusting temperature
+          (rgb.g < 0.5 ? (2.0 * rgb.g * warmFilter.g)
+                       : (1.0 - 2.0 * (1.0 - rgb.g) * (1.0 - warmFilter.g))),
+          (rgb.b < 0.5 ? (2.0 * rgb.b * warmFilter.b)
+                       : (1.0 - 2.0 * (1.0 - rgb.b) * (1.0 - warmFilter.b))));
+
+      gl_FragColor = vec4(mix(rgb, processed, temperature), color.a);
+    })";
+#endif
 
 std::shared_ptr<WhiteBalanceFilter> WhiteBalanceFilter::Create() {
   auto ret = std::shared_ptr<WhiteBalanceFilter>(new WhiteBalanceFilter());
@@ -87,4 +121,30 @@ bool WhiteBalanceFilter::DoRender(bool updateSinks) {
   return Filter::DoRender(updateSinks);
 }
 
+bool WhiteBalanceFilter::GetColorStage(ColorStage& stage) const {
+  stage.uniforms = R"(
+      uniform float $temperature; uniform float $tint;)";
+  stage.code = R"(
+      const vec3 warmFilter = vec3(0.93, 0.54, 0.0);
+      const mat3 RGBtoYIQ = mat3(0.299, 0.587, 0.114, 0.596, -0.274, -0.322,
+                                 0.212, -0.523, 0.311);
+      const mat3 YIQtoRGB = mat3(1.0, 0.956, 0.621, 1.0, -0.272, -0.647,
+                                 1.0, -1.105, 1.702);
+
+      vec3 yiq = RGBtoYIQ * color.rgb;
+      yiq.b = clamp(yiq.b + $tint * 0.5226 * 0.1, -0.5226, 0.5226);
+      vec3 rgb = YIQtoRGB * yiq;
+      vec3 processed = mix(2.0 * rgb * warmFilter,
+                           1.0 - 2.0 * (1.0 - rgb) * (1.0 - warmFilter),
+                           step(0.5, rgb));
+      color.rgb = mix(rgb, processed, $temperature);)";
+  return true;
+}
+
+void WhiteBalanceFilter::SetColorStageUniforms(GPUPixelGLProgram* program,
+                                               const std::string& prefix) {
+  program->SetUniformValue(prefix + "temperature", temperature_);
+  program->SetUniformValue(prefix + "tint", tint_);
+}
+
 }  // namespace gpupixel
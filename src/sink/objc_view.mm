@@ -102,8 +102,10 @@ using namespace gpupixel;
 
     gpupixel::GPUPixelContext::GetInstance()->SetActiveGlProgram(
         displayProgram);
-    glEnableVertexAttribArray(positionAttribLocation);
-    glEnableVertexAttribArray(texCoordAttribLocation);
+    gpupixel::GLStateCache* glState =
+        gpupixel::GPUPixelContext::GetInstance()->GetGlStateCache();
+    glState->EnableVertexAttribArray(positionAttribLocation);
+    glState->EnableVertexAttribArray(texCoordAttribLocation);
 
     [self setBackgroundColorRed:0.0 green:0.0 blue:0.0 alpha:0.0];
     _fillMode = gpupixel::SinkRender::FillMode::PreserveAspectRatio;
@@ -162,7 +164,9 @@ using namespace gpupixel;
     lastBoundsSize = currentFrame.size;
 
     glGenFramebuffers(1, &displayFramebuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, displayFramebuffer);
+    gpupixel::GPUPixelContext::GetInstance()
+        ->GetGlStateCache()
+        ->BindFramebuffer(displayFramebuffer);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
                               GL_RENDERBUFFER, displayRenderbuffer);
 
@@ -189,6 +193,9 @@ using namespace gpupixel;
   gpupixel::GPUPixelContext::GetInstance()->SyncRunWithContext([&] {
 #if defined(GPUPIXEL_IOS)
     if (displayFramebuffer) {
+      gpupixel::GPUPixelContext::GetInstance()
+          ->GetGlStateCache()
+          ->OnFramebufferDeleted(displayFramebuffer);
       glDeleteFramebuffers(1, &displayFramebuffer);
       displayFramebuffer = 0;
     }
@@ -211,14 +218,18 @@ using namespace gpupixel;
   }
 
   gpupixel::GPUPixelContext::GetInstance()->SyncRunWithContext([&] {
-      glBindFramebuffer(GL_FRAMEBUFFER, displayFramebuffer);
-      glViewport(0, 0, framebufferWidth, framebufferHeight);
+    gpupixel::GLStateCache* glState =
+        gpupixel::GPUPixelContext::GetInstance()->GetGlStateCache();
+    glState->BindFramebuffer(displayFramebuffer);
+    glState->Viewport(0, 0, framebufferWidth, framebufferHeight);
   });
 #else
   gpupixel::GPUPixelContext::GetInstance()->SyncRunWithContext([&] {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    gpupixel::GLStateCache* glState =
+        gpupixel::GPUPixelContext::GetInstance()->GetGlStateCache();
+    glState->BindFramebuffer(0);
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
-    glViewport(0, 0, self.sizeInPixels.width, self.sizeInPixels.height);
+    glState->Viewport(0, 0, self.sizeInPixels.width, self.sizeInPixels.height);
   });
 #endif
 }
@@ -250,16 +261,17 @@ using namespace gpupixel;
     gpupixel::GPUPixelContext::GetInstance()->SetActiveGlProgram(
         displayProgram);
     [self setDisplayFramebuffer];
-    glClearColor(backgroundColorRed, backgroundColorGreen, backgroundColorBlue,
-                 backgroundColorAlpha);
+    gpupixel::GLStateCache* glState =
+        gpupixel::GPUPixelContext::GetInstance()->GetGlStateCache();
+    glState->ClearColor(backgroundColorRed, backgroundColorGreen,
+                        backgroundColorBlue, backgroundColorAlpha);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 #if defined(GPUPIXEL_MAC)
     // Re-render onscreen, flipped to a normal orientation
-    GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    glState->BindFramebuffer(0);
     GL_CALL(glBindRenderbuffer(GL_RENDERBUFFER, 0));
 #endif
-    GL_CALL(glActiveTexture(GL_TEXTURE0));
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, inputFramebuffer->GetTexture()));
+    glState->BindTexture(GL_TEXTURE0, inputFramebuffer->GetTexture());
     GL_CALL(glUniform1i(colorMapUniformLocation, 0));
 
     GL_CALL(glVertexAttribPointer(positionAttribLocation, 2, GL_FLOAT, 0, 0,
@@ -274,7 +286,7 @@ using namespace gpupixel;
     [[self openGLContext] makeCurrentContext];
     GL_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
     [self presentFramebuffer];
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+    glState->BindTexture(0);
 #endif
   });
 }
@@ -6,11 +6,15 @@
  */
 
 #include "gpupixel/sink/sink.h"
+#include "core/gpupixel_context.h"
 #include "utils/util.h"
 
 namespace gpupixel {
 
-Sink::Sink(int input_number /* = 1*/) : input_count_(input_number) {}
+Sink::Sink(int input_number /* = 1*/)
+    : input_count_(input_number),
+      input_timestamp_(0),
+      context_(GPUPixelContext::GetInstance()) {}
 
 Sink::~Sink() {
   for (auto it = input_framebuffers_.begin(); it != input_framebuffers_.end();
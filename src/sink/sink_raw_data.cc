@@ -7,6 +7,7 @@
 //
 
 #include "gpupixel/sink/sink_raw_data.h"
+#include <algorithm>
 #include <cstring>
 #include "core/gpupixel_context.h"
 #include "libyuv.h"
@@ -14,6 +15,21 @@
 
 namespace gpupixel {
 
+// Asynchronous readback needs pixel pack buffers, glMapBufferRange and fences
+#if defined(GPUPIXEL_WIN) || defined(GPUPIXEL_LINUX)
+#define GPUPIXEL_ASYNC_READBACK 1
+#endif
+
+namespace {
+bool SupportsAsyncReadback() {
+#if defined(GPUPIXEL_ASYNC_READBACK)
+  return GLAD_GL_VERSION_3_2;
+#else
+  return false;
+#endif
+}
+}  // namespace
+
 const std::string kRGBToI420VertexShaderString = R"(
     attribute vec4 position;
     attribute vec4 inputTextureCoordinate;
@@ -53,6 +69,9 @@ SinkRawData::SinkRawData() {
 }
 
 SinkRawData::~SinkRawData() {
+  // Outstanding readbacks are dropped
+  context_->SyncRunWithContext([&] { ReleaseReadbacks(); });
+
   // Clean up RGBA frame buffer
   if (rgba_buffer_ != nullptr) {
     delete[] rgba_buffer_;
@@ -74,6 +93,9 @@ void SinkRawData::Render() {
   int width = input_framebuffers_[0].frame_buffer->GetWidth();
   int height = input_framebuffers_[0].frame_buffer->GetHeight();
   if (width_ != width || height_ != height) {
+    // pending readbacks still refer to the old size
+    DeliverReadbacks(true);
+    ReleaseReadbacks();
     width_ = width;
     height_ = height;
     InitFramebuffer(width, height);
@@ -83,9 +105,10 @@ void SinkRawData::Render() {
   GPUPixelContext::GetInstance()->SetActiveGlProgram(shader_program_);
   framebuffer_->Activate();
 
-  GL_CALL(glViewport(0, 0, width_, height_));
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  gl_state->Viewport(0, 0, width_, height_);
 
-  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+  gl_state->ClearColor(0.0f, 0.0f, 0.0f, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
   float image_vertices[] = {
@@ -99,23 +122,150 @@ void SinkRawData::Render() {
       0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f,
   };
 
-  GL_CALL(glEnableVertexAttribArray(position_attribute_));
+  gl_state->EnableVertexAttribArray(position_attribute_);
   GL_CALL(glVertexAttribPointer(position_attribute_, 2, GL_FLOAT, 0, 0,
                                 image_vertices));
 
-  GL_CALL(glEnableVertexAttribArray(tex_coord_attribute_));
+  gl_state->EnableVertexAttribArray(tex_coord_attribute_);
   GL_CALL(glVertexAttribPointer(tex_coord_attribute_, 2, GL_FLOAT, 0, 0,
                                 texture_vertices));
 
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D,
-                input_framebuffers_[0].frame_buffer->GetTexture());
+  gl_state->BindTexture(GL_TEXTURE0,
+                        input_framebuffers_[0].frame_buffer->GetTexture());
 
   GL_CALL(shader_program_->SetUniformValue("sTexture", 0));
   // Draw frame buffer
   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
   framebuffer_->Deactivate();
+
+  if (rgba_callback_ || i420_callback_) {
+    ReadbackFrame();
+  }
+}
+
+void SinkRawData::SetRgbaCallback(FrameCallback callback) {
+  context_->SyncRunWithContext([&] { rgba_callback_ = callback; });
+}
+
+void SinkRawData::SetI420Callback(FrameCallback callback) {
+  context_->SyncRunWithContext([&] { i420_callback_ = callback; });
+}
+
+void SinkRawData::SetPipelineDepth(int depth) {
+  depth = std::max(1, std::min(depth, 3));
+  context_->SyncRunWithContext([&] {
+    DeliverReadbacks(true);
+    ReleaseReadbacks();
+    pipeline_depth_ = depth;
+  });
+}
+
+void SinkRawData::Flush() {
+  context_->SyncRunWithContext([&] { DeliverReadbacks(true); });
+}
+
+void SinkRawData::ReadbackFrame() {
+  if (pipeline_depth_ <= 1 || !SupportsAsyncReadback()) {
+    RenderToOutput();
+    DeliverFrame(rgba_buffer_, input_timestamp_);
+    return;
+  }
+
+#if defined(GPUPIXEL_ASYNC_READBACK)
+  if (readbacks_.empty()) {
+    readbacks_.resize(pipeline_depth_);
+    for (auto& readback : readbacks_) {
+      GL_CALL(glGenBuffers(1, &readback.pbo));
+      GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo));
+      GL_CALL(glBufferData(GL_PIXEL_PACK_BUFFER, width_ * height_ * 4,
+                           nullptr, GL_STREAM_READ));
+    }
+    GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    next_readback_ = 0;
+  }
+
+  // hand out what has completed; if the ring is full, wait for the oldest
+  DeliverReadbacks(false);
+  Readback& readback = readbacks_[next_readback_];
+  if (readback.fence) {
+    GLsync fence = (GLsync)readback.fence;
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) ==
+           GL_TIMEOUT_EXPIRED) {
+    }
+    DeliverReadbacks(false);
+  }
+
+  framebuffer_->Activate();
+  GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo));
+  GL_CALL(glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, 0));
+  GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+  framebuffer_->Deactivate();
+
+  readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  readback.timestamp = input_timestamp_;
+  next_readback_ = (next_readback_ + 1) % readbacks_.size();
+  glFlush();
+#endif
+}
+
+void SinkRawData::DeliverReadbacks(bool wait) {
+#if defined(GPUPIXEL_ASYNC_READBACK)
+  // oldest first, stopping at the first one still in flight to keep order
+  for (size_t i = 0; i < readbacks_.size(); i++) {
+    Readback& readback =
+        readbacks_[(next_readback_ + i) % readbacks_.size()];
+    if (!readback.fence) {
+      continue;
+    }
+    GLsync fence = (GLsync)readback.fence;
+    GLenum status;
+    do {
+      status = glClientWaitSync(fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                wait ? 1000000000 : 0);
+    } while (wait && status == GL_TIMEOUT_EXPIRED);
+    if (status == GL_TIMEOUT_EXPIRED) {
+      break;
+    }
+    glDeleteSync(fence);
+    readback.fence = nullptr;
+
+    GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo));
+    const uint8_t* pixels = (const uint8_t*)glMapBufferRange(
+        GL_PIXEL_PACK_BUFFER, 0, width_ * height_ * 4, GL_MAP_READ_BIT);
+    if (pixels) {
+      DeliverFrame(pixels, readback.timestamp);
+      GL_CALL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+    }
+    GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+  }
+#endif
+}
+
+void SinkRawData::DeliverFrame(const uint8_t* rgba, int64_t timestamp) {
+  if (rgba_callback_) {
+    rgba_callback_(rgba, width_, height_, timestamp);
+  }
+  if (i420_callback_) {
+    libyuv::ARGBToI420(rgba, width_ * 4, yuv_buffer_, width_,
+                       yuv_buffer_ + width_ * height_, width_ / 2,
+                       yuv_buffer_ + width_ * height_ * 5 / 4, width_ / 2,
+                       width_, height_);
+    i420_callback_(yuv_buffer_, width_, height_, timestamp);
+  }
+}
+
+void SinkRawData::ReleaseReadbacks() {
+#if defined(GPUPIXEL_ASYNC_READBACK)
+  for (auto& readback : readbacks_) {
+    if (readback.fence) {
+      glDeleteSync((GLsync)readback.fence);
+    }
+    GL_CALL(glDeleteBuffers(1, &readback.pbo));
+  }
+#endif
+  readbacks_.clear();
+  next_readback_ = 0;
 }
 
 bool SinkRawData::InitWithShaderString(
@@ -143,14 +293,12 @@ int SinkRawData::RenderToOutput() {
 }
 
 const uint8_t* SinkRawData::GetRgbaBuffer() {
-  gpupixel::GPUPixelContext::GetInstance()->SyncRunWithContext(
-      [&] { RenderToOutput(); });
+  context_->SyncRunWithContext([&] { RenderToOutput(); });
   return rgba_buffer_;
 }
 
 const uint8_t* SinkRawData::GetI420Buffer() {
-  gpupixel::GPUPixelContext::GetInstance()->SyncRunWithContext(
-      [=] { RenderToOutput(); });
+  context_->SyncRunWithContext([=] { RenderToOutput(); });
 
   // Convert RGBA to I420 format
   libyuv::ARGBToI420(rgba_buffer_, width_ * 4, yuv_buffer_, width_,
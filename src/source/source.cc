@@ -14,7 +14,10 @@ namespace gpupixel {
 Source::Source()
     : framebuffer_(0),
       output_rotation_(RotationMode::NoRotation),
-      framebuffer_scale_(1.0) {}
+      framebuffer_scale_(1.0),
+      transient_output_(false),
+      timestamp_(0),
+      context_(GPUPixelContext::GetInstance()) {}
 
 Source::~Source() {
   RemoveAllSinks();
@@ -61,12 +64,33 @@ bool Source::DoRender(bool updateSinks) {
 }
 
 void Source::DoUpdateSinks() {
+  if (transient_output_) {
+    // Hand the output to every sink before any of them renders, then keep
+    // no reference here, so it is released as soon as the last one has drawn
+    for (auto& it : sinks_) {
+      it.first->SetInputFramebuffer(framebuffer_, output_rotation_, it.second);
+    }
+    framebuffer_.reset();
+  }
+
   for (auto& it : sinks_) {
     auto sink = it.first;
-    sink->SetInputFramebuffer(framebuffer_, output_rotation_, sinks_[sink]);
+    if (!transient_output_) {
+      sink->SetInputFramebuffer(framebuffer_, output_rotation_, sinks_[sink]);
+    }
+    sink->SetInputTimestamp(timestamp_);
     if (sink->IsReady()) {
-      sink->Render();
-      sink->ResetAndClean();
+      GPUPixelContext* sink_context = sink->GetContext();
+      if (sink_context && sink_context != GPUPixelContext::GetInstance()) {
+        // sink lives on another context of the share group
+        sink_context->SyncRunWithFence([sink] {
+          sink->Render();
+          sink->ResetAndClean();
+        });
+      } else {
+        sink->Render();
+        sink->ResetAndClean();
+      }
     }
   }
 }
@@ -106,6 +130,10 @@ std::shared_ptr<GPUPixelFramebuffer> Source::GetFramebuffer() const {
   return framebuffer_;
 }
 
-void Source::ReleaseFramebuffer(bool returnToCache /* = true*/) {}
+void Source::ReleaseFramebuffer(bool /*returnToCache*/) {
+  // The last reference returns it to the context's framebuffer cache, which
+  // deletes it once over budget, so returnToCache makes no difference
+  framebuffer_.reset();
+}
 
 }  // namespace gpupixel
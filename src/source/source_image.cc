@@ -65,18 +65,19 @@ void SourceImage::Init(int width,
                        ->CreateFramebuffer(width, height, true);
   }
   this->SetFramebuffer(framebuffer_);
-  GL_CALL(glBindTexture(GL_TEXTURE_2D, this->GetFramebuffer()->GetTexture()));
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  gl_state->BindTexture(this->GetFramebuffer()->GetTexture());
 
   GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
                        GL_UNSIGNED_BYTE, pixels));
   image_bytes_.assign(pixels, pixels + width * height * 4);
+  framebuffer_->MarkModified();
 
-  GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+  gl_state->BindTexture(0);
 }
 
 void SourceImage::Render() {
-  gpupixel::GPUPixelContext::GetInstance()->SyncRunWithContext(
-      [&] { Source::DoRender(); });
+  context_->SyncRunWithContext([&] { Source::DoRender(); });
 }
 
 const unsigned char* SourceImage::GetRgbaImageBuffer() const {
@@ -6,6 +6,7 @@
  */
 
 #include "gpupixel/source/source_raw_data.h"
+#include <algorithm>
 #include "core/gpupixel_context.h"
 #include "utils/util.h"
 
@@ -52,8 +53,12 @@ std::shared_ptr<SourceRawData> SourceRawData::Create() {
 SourceRawData::SourceRawData() {}
 
 SourceRawData::~SourceRawData() {
-  GPUPixelContext::GetInstance()->SyncRunWithContext(
-      [=] { glDeleteTextures(1, &texture_); });
+  // Frames still queued are not rendered: their tasks no longer reach this
+  // source, and none runs meanwhile as a running task holds a reference
+  context_->SyncRunWithContext([=] {
+    context_->GetGlStateCache()->OnTextureDeleted(texture_);
+    glDeleteTextures(1, &texture_);
+  });
 }
 
 bool SourceRawData::Init() {
@@ -70,7 +75,8 @@ bool SourceRawData::Init() {
     glGenTextures(1, &texture_);
   }
 
-  glBindTexture(GL_TEXTURE_2D, texture_);
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  gl_state->BindTexture(texture_);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -85,20 +91,169 @@ void SourceRawData::SetRotation(RotationMode rotation) {
   rotation_ = rotation;
 }
 
+void SourceRawData::SetPipelineDepth(int depth) {
+  depth = std::max(1, std::min(depth, 3));
+  Flush();
+  std::unique_lock<std::mutex> lock(pipeline_mutex_);
+  pipeline_depth_ = depth;
+  pending_frames_.resize(depth > 1 ? depth : 0);
+  free_frames_.clear();
+  for (int i = 0; i < (int)pending_frames_.size(); i++) {
+    free_frames_.push_back(i);
+  }
+  dropped_frames_ = 0;
+}
+
+void SourceRawData::Flush() {
+  std::unique_lock<std::mutex> lock(pipeline_mutex_);
+  pipeline_cv_.wait(lock, [this] { return frames_in_flight_ == 0; });
+}
+
+void SourceRawData::SetFramePolicy(GPUPIXEL_FRAME_POLICY policy) {
+  std::unique_lock<std::mutex> lock(pipeline_mutex_);
+  frame_policy_ = policy;
+}
+
+void SourceRawData::SetFrameBudget(int64_t budget_us,
+                                   FrameBudgetCallback callback) {
+  std::unique_lock<std::mutex> lock(pipeline_mutex_);
+  frame_budget_us_ = budget_us;
+  frame_budget_callback_ = callback;
+}
+
+uint64_t SourceRawData::GetDroppedFrameCount() const {
+  std::unique_lock<std::mutex> lock(pipeline_mutex_);
+  return dropped_frames_;
+}
+
+int SourceRawData::GetQueuedFrameCount() const {
+  std::unique_lock<std::mutex> lock(pipeline_mutex_);
+  return (int)queued_frames_.size();
+}
+
 void SourceRawData::ProcessData(const uint8_t* data,
                                 int width,
                                 int height,
                                 int stride,
-                                GPUPIXEL_FRAME_TYPE type) {
-  GPUPixelContext::GetInstance()->SyncRunWithContext(
-      [=] { GenerateTextureWithPixels(data, width, height, stride, type); });
+                                GPUPIXEL_FRAME_TYPE type,
+                                int64_t timestamp /* = 0*/) {
+  auto submit_time = std::chrono::steady_clock::now();
+  bool pipelined = pipeline_depth_ > 1;
+#if defined(GPUPIXEL_IOS) || defined(GPUPIXEL_MAC)
+  // queued tasks are dropped while the app is inactive, so would never
+  // release their slot
+  pipelined = pipelined && Util::IsAppleAppActive();
+#endif
+  if (!pipelined) {
+    context_->SyncRunWithContext([=] {
+      GenerateTextureWithPixels(data, width, height, stride, type, timestamp);
+      CheckFrameBudget(timestamp, submit_time);
+    });
+    return;
+  }
+
+  int index;
+  {
+    std::unique_lock<std::mutex> lock(pipeline_mutex_);
+    if (frame_policy_ == GPUPIXEL_FRAME_POLICY_LATEST_WINS) {
+      DropQueuedFrames(queued_frames_.size());
+    } else if (frame_policy_ == GPUPIXEL_FRAME_POLICY_DROP_OLDEST &&
+               free_frames_.empty()) {
+      DropQueuedFrames(1);
+    }
+    pipeline_cv_.wait(lock, [this] { return !free_frames_.empty(); });
+    index = free_frames_.back();
+    free_frames_.pop_back();
+    frames_in_flight_++;
+  }
+
+  PendingFrame& frame = pending_frames_[index];
+  frame.pixels.assign(data, data + (size_t)stride * height);
+  frame.width = width;
+  frame.height = height;
+  frame.stride = stride;
+  frame.type = type;
+  frame.timestamp = timestamp;
+  frame.submit_time = submit_time;
+
+  {
+    std::unique_lock<std::mutex> lock(pipeline_mutex_);
+    queued_frames_.push_back(index);
+  }
+  // The task may run after the source is released
+  std::weak_ptr<SourceRawData> weak_this = weak_from_this();
+  context_->AsyncRunWithContext([weak_this] {
+    if (auto self = weak_this.lock()) {
+      self->RenderQueuedFrame();
+    }
+  });
+}
+
+void SourceRawData::RenderQueuedFrame() {
+  int index;
+  {
+    std::unique_lock<std::mutex> lock(pipeline_mutex_);
+    if (queued_frames_.empty()) {
+      return;
+    }
+    index = queued_frames_.front();
+    queued_frames_.pop_front();
+  }
+
+  PendingFrame& frame = pending_frames_[index];
+  GenerateTextureWithPixels(frame.pixels.data(), frame.width, frame.height,
+                            frame.stride, frame.type, frame.timestamp);
+  int64_t timestamp = frame.timestamp;
+  auto submit_time = frame.submit_time;
+
+  {
+    std::unique_lock<std::mutex> lock(pipeline_mutex_);
+    free_frames_.push_back(index);
+    frames_in_flight_--;
+    pipeline_cv_.notify_all();
+  }
+  CheckFrameBudget(timestamp, submit_time);
+}
+
+// Called with pipeline_mutex_ held
+void SourceRawData::DropQueuedFrames(size_t count) {
+  count = std::min(count, queued_frames_.size());
+  for (size_t i = 0; i < count; i++) {
+    free_frames_.push_back(queued_frames_.front());
+    queued_frames_.pop_front();
+  }
+  frames_in_flight_ -= (int)count;
+  dropped_frames_ += count;
+  if (count > 0) {
+    pipeline_cv_.notify_all();
+  }
+}
+
+void SourceRawData::CheckFrameBudget(
+    int64_t timestamp,
+    std::chrono::steady_clock::time_point submit_time) {
+  int64_t latency_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - submit_time)
+                           .count();
+  FrameBudgetCallback callback;
+  {
+    std::unique_lock<std::mutex> lock(pipeline_mutex_);
+    if (frame_budget_us_ <= 0 || latency_us <= frame_budget_us_) {
+      return;
+    }
+    callback = frame_budget_callback_;
+  }
+  if (callback) {
+    callback(timestamp, latency_us);
+  }
 }
 
 int SourceRawData::GenerateTextureWithPixels(const uint8_t* pixels,
                                              int width,
                                              int height,
                                              int stride,
-                                             GPUPIXEL_FRAME_TYPE type) {
+                                             GPUPIXEL_FRAME_TYPE type,
+                                             int64_t timestamp) {
   if (!framebuffer_ || (framebuffer_->GetWidth() != stride / 4 ||
                         framebuffer_->GetHeight() != height)) {
     framebuffer_ = GPUPixelContext::GetInstance()
@@ -106,8 +261,10 @@ int SourceRawData::GenerateTextureWithPixels(const uint8_t* pixels,
                        ->CreateFramebuffer(stride / 4, height);
   }
   this->SetFramebuffer(framebuffer_, NoRotation);
+  timestamp_ = timestamp;
 
-  GL_CALL(glBindTexture(GL_TEXTURE_2D, texture_));
+  GLStateCache* gl_state = GPUPixelContext::GetInstance()->GetGlStateCache();
+  gl_state->BindTexture(texture_);
 
   if (type == GPUPIXEL_FRAME_TYPE_BGRA) {
 #if defined(GPUPIXEL_IOS) || defined(GPUPIXEL_MAC)
@@ -126,16 +283,15 @@ int SourceRawData::GenerateTextureWithPixels(const uint8_t* pixels,
       -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
   };
 
-  GL_CALL(glEnableVertexAttribArray(filter_position_attribute_));
+  gl_state->EnableVertexAttribArray(filter_position_attribute_);
   GL_CALL(glVertexAttribPointer(filter_position_attribute_, 2, GL_FLOAT, 0, 0,
                                 imageVertices));
 
-  GL_CALL(glEnableVertexAttribArray(filter_tex_coord_attribute_));
+  gl_state->EnableVertexAttribArray(filter_tex_coord_attribute_);
   GL_CALL(glVertexAttribPointer(filter_tex_coord_attribute_, 2, GL_FLOAT, 0, 0,
                                 GetTextureCoordinate(rotation_)));
 
-  GL_CALL(glActiveTexture(GL_TEXTURE0));
-  GL_CALL(glBindTexture(GL_TEXTURE_2D, texture_));
+  gl_state->BindTexture(GL_TEXTURE0, texture_);
   filter_program_->SetUniformValue("inputImageTexture", 0);
 
   // draw frame buffer
@@ -1,24 +1,67 @@
 #include "utils/dispatch_queue.h"
 
-DispatchQueue::DispatchQueue() : running(true) {
-  worker = std::thread([this]() {
-    workerId = std::this_thread::get_id();
-    while (running) {
-      std::function<void()> task;
-      {
-        std::unique_lock<std::mutex> lk(m);
-        cv.wait(lk, [this]() { return !taskQueue.empty() || !running; });
-
-        if (!running && taskQueue.empty()) {
-          return;
-        }
-
-        task = taskQueue.front();
-        taskQueue.pop();
-      }
-      task();
-    }
-  });
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace {
+
+// Backoff before parking: a short busy spin keeps latency low when tasks
+// arrive back to back, a few yields cover producers that are just preempted.
+// Spinning is pointless without a second core to make progress meanwhile.
+const int kSpinCount = std::thread::hardware_concurrency() > 1 ? 128 : 0;
+constexpr int kYieldCount = 16;
+
+inline void CpuRelax() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  __asm__ __volatile__("yield");
+#endif
+}
+
+// Returns false once the caller should park
+inline bool Backoff(int& round) {
+  if (round < kSpinCount) {
+    CpuRelax();
+  } else if (round < kSpinCount + kYieldCount) {
+    std::this_thread::yield();
+  } else {
+    return false;
+  }
+  round++;
+  return true;
+}
+
+// Set on the worker threads of all queues, which must not block on a full ring
+thread_local bool tls_is_dispatch_worker = false;
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+}  // namespace
+
+DispatchQueue::DispatchQueue(size_t capacity /* = kDefaultCapacity*/)
+    : enqueuePos(0),
+      dequeuePos(0),
+      foreignPending(0),
+      workerParked(false),
+      producersParked(0),
+      running(true) {
+  size_t size = RoundUpToPowerOfTwo(capacity > 1 ? capacity : 2);
+  cells.reset(new Cell[size]);
+  for (size_t i = 0; i < size; i++) {
+    cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  mask = size - 1;
+  worker = std::thread([this]() { workerLoop(); });
 }
 
 DispatchQueue::~DispatchQueue() {
@@ -26,53 +69,236 @@ DispatchQueue::~DispatchQueue() {
 }
 
 void DispatchQueue::stop() {
+  running.store(false);
   {
-    std::unique_lock<std::mutex> lk(m);
-    running = false;
+    std::unique_lock<std::mutex> lk(parkMutex);
   }
-  cv.notify_one();
+  workerCv.notify_one();
   if (worker.joinable()) {
     worker.join();
   }
 }
 
 bool DispatchQueue::isWorkerThread() const {
-  return std::this_thread::get_id() == workerId;
+  return std::this_thread::get_id() ==
+         workerId.load(std::memory_order_relaxed);
 }
 
-void DispatchQueue::runTask(std::function<void()> task) {
-  // If current thread is the worker thread, execute the task directly to avoid
-  // deadlock
-  if (isWorkerThread()) {
-    task();
-    return;
+bool DispatchQueue::tryPush(DispatchTask& task) {
+  size_t pos = enqueuePos.load(std::memory_order_relaxed);
+  Cell* cell;
+  while (true) {
+    cell = &cells[pos & mask];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+    if (diff == 0) {
+      if (enqueuePos.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return false;  // full
+    } else {
+      pos = enqueuePos.load(std::memory_order_relaxed);
+    }
   }
+  cell->task = std::move(task);
+  cell->sequence.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+bool DispatchQueue::tryPop(DispatchTask& task) {
+  Cell& cell = cells[dequeuePos & mask];
+  if (cell.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+    return false;
+  }
+  task = std::move(cell.task);
+  cell.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+  dequeuePos++;
+  return true;
+}
 
-  // Create a promise and future for synchronization
-  std::promise<void> promise;
-  std::future<void> future = promise.get_future();
+bool DispatchQueue::hasPending() const {
+  const Cell& cell = cells[dequeuePos & mask];
+  return cell.sequence.load(std::memory_order_acquire) == dequeuePos + 1;
+}
+
+bool DispatchQueue::hasFreeSlot() const {
+  size_t pos = enqueuePos.load(std::memory_order_relaxed);
+  const Cell& cell = cells[pos & mask];
+  return (intptr_t)cell.sequence.load(std::memory_order_acquire) -
+             (intptr_t)pos >=
+         0;
+}
 
-  // Wrap the original task to set the promise when completed
-  auto wrappedTask = [task, &promise]() {
+void DispatchQueue::pushForeign(DispatchTask& task) {
+  std::unique_lock<std::mutex> lk(foreignMutex);
+  // Behind earlier tasks of the same producer that are still waiting here
+  if (foreignOverflow.empty() && tryPush(task)) {
+    return;
+  }
+  foreignOverflow.push_back(std::move(task));
+  foreignPending.store(foreignOverflow.size(), std::memory_order_release);
+}
+
+bool DispatchQueue::runForeign() {
+  if (foreignPending.load(std::memory_order_acquire) == 0) {
+    return false;
+  }
+  std::deque<DispatchTask> tasks;
+  {
+    std::unique_lock<std::mutex> lk(foreignMutex);
+    tasks.swap(foreignOverflow);
+    foreignPending.store(0, std::memory_order_release);
+  }
+  // Run them all before the ring, where their producers queue next
+  for (auto& task : tasks) {
     try {
       task();
-      promise.set_value();
     } catch (...) {
+      // Asynchronous tasks have nobody to report to; keep the worker alive
+    }
+  }
+  return true;
+}
+
+void DispatchQueue::wakeWorker() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (workerParked.load(std::memory_order_relaxed)) {
+    {
+      std::unique_lock<std::mutex> lk(parkMutex);
+    }
+    workerCv.notify_one();
+  }
+}
+
+void DispatchQueue::wakeProducers() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (producersParked.load(std::memory_order_relaxed) > 0) {
+    {
+      std::unique_lock<std::mutex> lk(parkMutex);
+    }
+    producerCv.notify_one();
+  }
+}
+
+void DispatchQueue::workerLoop() {
+  workerId.store(std::this_thread::get_id(), std::memory_order_relaxed);
+  tls_is_dispatch_worker = true;
+  DispatchTask task;
+  int round = 0;
+  while (true) {
+    if (runForeign()) {
+      round = 0;
+      continue;
+    }
+
+    if (tryPop(task)) {
+      round = 0;
+      wakeProducers();
+      while (!overflow.empty() && tryPush(overflow.front())) {
+        overflow.pop_front();
+      }
       try {
-        promise.set_exception(std::current_exception());
+        task();
       } catch (...) {
-        // Ignore exceptions when the promise is already set
+        // Asynchronous tasks have nobody to report to; keep the worker alive
       }
+      task.reset();
+      continue;
     }
-  };
 
-  // Add the wrapped task to the queue
-  {
-    std::unique_lock<std::mutex> lk(m);
-    taskQueue.push(wrappedTask);
+    if (!overflow.empty()) {
+      // the ring is empty, so this always makes progress
+      tryPush(overflow.front());
+      overflow.pop_front();
+      continue;
+    }
+
+    if (!running.load(std::memory_order_acquire)) {
+      return;
+    }
+
+    if (Backoff(round)) {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lk(parkMutex);
+    workerParked.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    workerCv.wait(lk, [this]() {
+      return hasPending() ||
+             foreignPending.load(std::memory_order_acquire) > 0 ||
+             !running.load(std::memory_order_acquire);
+    });
+    workerParked.store(false, std::memory_order_relaxed);
+    round = 0;
   }
-  cv.notify_one();
+}
+
+void DispatchQueue::enqueue(DispatchTask task) {
+  if (isWorkerThread()) {
+    // The worker must never wait on itself; keep its order behind any
+    // earlier overflow.
+    if (!overflow.empty() || !tryPush(task)) {
+      overflow.push_back(std::move(task));
+    }
+    return;
+  }
+
+  if (tls_is_dispatch_worker) {
+    // Waiting here could close a cycle with a worker waiting on this one
+    pushForeign(task);
+    wakeWorker();
+    return;
+  }
+
+  int round = 0;
+  while (!tryPush(task)) {
+    if (Backoff(round)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lk(parkMutex);
+    producersParked.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    producerCv.wait(lk, [this]() { return hasFreeSlot(); });
+    producersParked.fetch_sub(1, std::memory_order_relaxed);
+    round = 0;
+  }
+  wakeWorker();
+}
+
+void DispatchQueue::runAndWait(DispatchTask task) {
+  // Completion state lives on this stack frame; the caller spins briefly and
+  // then sleeps until the worker signals it
+  struct Completion {
+    std::atomic<bool> done{false};
+    std::mutex m;
+    std::condition_variable cv;
+  } completion;
+
+  enqueue(DispatchTask([&task, &completion]() {
+    try {
+      task();
+    } catch (...) {
+      // Ignore exceptions, the caller only waits for completion
+    }
+    std::unique_lock<std::mutex> lk(completion.m);
+    completion.done.store(true, std::memory_order_release);
+    completion.cv.notify_one();
+  }));
 
   // Wait for the task to complete
-  future.wait();
+  int round = 0;
+  while (!completion.done.load(std::memory_order_acquire)) {
+    if (!Backoff(round)) {
+      std::unique_lock<std::mutex> lk(completion.m);
+      completion.cv.wait(lk, [&completion]() {
+        return completion.done.load(std::memory_order_acquire);
+      });
+      break;
+    }
+  }
+  // make sure the worker has released the completion before it goes away
+  std::unique_lock<std::mutex> lk(completion.m);
 }
@@ -1,34 +1,193 @@
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <future>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <new>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+/**
+ * @brief Move-only callable with inline storage.
+ *
+ * Callables up to kInlineSize bytes are stored in place, so queueing them does
+ * not allocate. Larger callables fall back to a heap copy.
+ */
+class DispatchTask {
+ public:
+  static constexpr size_t kInlineSize = 64;
+
+  DispatchTask() noexcept : ops_(nullptr) {}
+
+  template <typename F,
+            typename Fn = typename std::decay<F>::type,
+            typename = typename std::enable_if<
+                !std::is_same<Fn, DispatchTask>::value>::type>
+  DispatchTask(F&& func) : ops_(nullptr) {
+    if constexpr (sizeof(Fn) <= kInlineSize &&
+                  alignof(Fn) <= alignof(std::max_align_t) &&
+                  std::is_nothrow_move_constructible<Fn>::value) {
+      new (storage_) Fn(std::forward<F>(func));
+      ops_ = &InlineOps<Fn>::ops;
+    } else {
+      *reinterpret_cast<Fn**>(storage_) = new Fn(std::forward<F>(func));
+      ops_ = &HeapOps<Fn>::ops;
+    }
+  }
+
+  DispatchTask(DispatchTask&& other) noexcept : ops_(nullptr) {
+    *this = std::move(other);
+  }
+
+  DispatchTask& operator=(DispatchTask&& other) noexcept {
+    if (this != &other) {
+      reset();
+      if (other.ops_) {
+        other.ops_->move(storage_, other.storage_);
+        ops_ = other.ops_;
+        other.ops_ = nullptr;
+      }
+    }
+    return *this;
+  }
+
+  DispatchTask(const DispatchTask&) = delete;
+  DispatchTask& operator=(const DispatchTask&) = delete;
+
+  ~DispatchTask() { reset(); }
+
+  void operator()() { ops_->invoke(storage_); }
+
+  explicit operator bool() const { return ops_ != nullptr; }
+
+  void reset() {
+    if (ops_) {
+      ops_->destroy(storage_);
+      ops_ = nullptr;
+    }
+  }
+
+ private:
+  struct Ops {
+    void (*invoke)(void* storage);
+    // move-constructs into dst and destroys src
+    void (*move)(void* dst, void* src);
+    void (*destroy)(void* storage);
+  };
+
+  template <typename Fn>
+  struct InlineOps {
+    static void Invoke(void* storage) { (*static_cast<Fn*>(storage))(); }
+    static void Move(void* dst, void* src) {
+      new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+      static_cast<Fn*>(src)->~Fn();
+    }
+    static void Destroy(void* storage) { static_cast<Fn*>(storage)->~Fn(); }
+    static constexpr Ops ops = {&Invoke, &Move, &Destroy};
+  };
+
+  template <typename Fn>
+  struct HeapOps {
+    static void Invoke(void* storage) { (**static_cast<Fn**>(storage))(); }
+    static void Move(void* dst, void* src) {
+      *static_cast<Fn**>(dst) = *static_cast<Fn**>(src);
+    }
+    static void Destroy(void* storage) { delete *static_cast<Fn**>(storage); }
+    static constexpr Ops ops = {&Invoke, &Move, &Destroy};
+  };
+
+  alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+  const Ops* ops_;
+};
+
+template <typename Fn>
+constexpr DispatchTask::Ops DispatchTask::InlineOps<Fn>::ops;
+template <typename Fn>
+constexpr DispatchTask::Ops DispatchTask::HeapOps<Fn>::ops;
+
 /**
  * @brief Task queue that is executed on a background thread.
  *
- * Tasks are automatically processed by a background thread.
- * The thread waits when the queue is empty and is notified when new tasks are
- * added.
+ * Tasks are stored in a fixed-capacity lock-free multi-producer
+ * single-consumer ring, so submitting a task takes no lock and, for small
+ * callables, no allocation. The worker spins briefly when the ring runs dry
+ * and then parks until a producer wakes it. Producers that find the ring full
+ * back off the same way, except worker threads, which are never blocked: the
+ * queue's own worker keeps its overflow in order behind the ring, and the
+ * workers of other queues append to an unbounded, locked overflow, so two
+ * workers posting to each other's full queues cannot deadlock.
  */
 class DispatchQueue {
  protected:
-  std::queue<std::function<void()>> taskQueue;
-  std::mutex m;
-  std::condition_variable cv;
+  struct alignas(64) Cell {
+    std::atomic<size_t> sequence;
+    DispatchTask task;
+  };
+
+  std::unique_ptr<Cell[]> cells;
+  size_t mask;
+  alignas(64) std::atomic<size_t> enqueuePos;
+  alignas(64) size_t dequeuePos;
+
+  // Tasks queued by the worker while the ring was full; only the worker
+  // touches this and moves them into the ring in order as slots free up
+  std::deque<DispatchTask> overflow;
+
+  // Tasks queued by the workers of other queues while the ring was full, or
+  // while earlier ones are still waiting here
+  std::mutex foreignMutex;
+  std::deque<DispatchTask> foreignOverflow;
+  std::atomic<size_t> foreignPending;
+
+  // Parking: the flags are read by the other side after a full fence, so the
+  // mutexes are only taken when somebody is actually asleep
+  std::mutex parkMutex;
+  std::condition_variable workerCv;
+  std::condition_variable producerCv;
+  std::atomic<bool> workerParked;
+  std::atomic<int> producersParked;
+
+  std::atomic<bool> running;
   std::thread worker;
-  bool running;
-  std::thread::id workerId;
+  std::atomic<std::thread::id> workerId;
+
+  bool tryPush(DispatchTask& task);
+  bool tryPop(DispatchTask& task);
+  bool hasPending() const;
+  bool hasFreeSlot() const;
+  void pushForeign(DispatchTask& task);
+  bool runForeign();
+  void wakeWorker();
+  void wakeProducers();
+  void workerLoop();
+
+  /**
+   * Push a task, waiting for a free slot when called off a worker thread
+   */
+  void enqueue(DispatchTask task);
+
+  /**
+   * Queue a task from another thread and wait until it has run
+   */
+  void runAndWait(DispatchTask task);
 
  public:
+  static constexpr size_t kDefaultCapacity = 64;
+
   /**
    * Constructor starts the worker thread
+   * @param capacity Maximum number of pending tasks, rounded up to a power of
+   * two
    */
-  DispatchQueue();
+  explicit DispatchQueue(size_t capacity = kDefaultCapacity);
 
   /**
    * Destructor stops the worker thread
@@ -39,10 +198,50 @@ class DispatchQueue {
    * Execute a task synchronously
    * @param task The function to execute
    */
-  void runTask(std::function<void()> task);
+  template <typename F>
+  void runTask(F&& task) {
+    // If current thread is the worker thread, execute the task directly to
+    // avoid deadlock
+    if (isWorkerThread()) {
+      task();
+      return;
+    }
+    // the caller's frame outlives the task, so only a reference is queued
+    runAndWait(DispatchTask([&task]() { task(); }));
+  }
+
+  /**
+   * Queue a task and return without waiting for it. Exceptions thrown by the
+   * task are discarded.
+   * @param task The function to execute
+   */
+  template <typename F>
+  void runTaskAsync(F&& task) {
+    enqueue(DispatchTask(std::forward<F>(task)));
+  }
+
+  /**
+   * Queue a task and return a future for its result. Exceptions thrown by the
+   * task are rethrown from future::get(). Called on the worker thread the task
+   * runs inline, so the future is already ready.
+   * @param task The function to execute
+   */
+  template <typename F>
+  auto submitTask(F&& task) -> std::future<decltype(task())> {
+    using Result = decltype(task());
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(
+        std::forward<F>(task));
+    std::future<Result> future = packaged->get_future();
+    if (isWorkerThread()) {
+      (*packaged)();
+    } else {
+      enqueue(DispatchTask([packaged]() { (*packaged)(); }));
+    }
+    return future;
+  }
 
   /**
-   * Stop the worker thread
+   * Stop the worker thread after the pending tasks have run
    */
   void stop();
 